@@ -0,0 +1,451 @@
+/*
+ * Geoclue
+ * gc-disk-cache.c - Persistent key-value cache for web service responses
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Providers are started on demand and exit when their last client
+ * leaves, so anything cached in memory is lost between activations.
+ * GcDiskCache keeps responses in $XDG_CACHE_HOME/geoclue/<name>.cache.
+ *
+ * The file is a header followed by an append-only log of records:
+ * a GcDiskCacheRecord, the key and the value. A later record for the
+ * same key replaces an earlier one. The file is memory-mapped for
+ * reading and an index of the valid records is built when it is
+ * opened. Each record is written with a single write() and carries
+ * a checksum, so a record torn by a crash is detected on the next
+ * load and cut off along with anything after it. When more than half
+ * of the file is expired or replaced records it is rewritten
+ * atomically with only the live ones.
+ */
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "gc-disk-cache.h"
+
+#define GC_DISK_CACHE_MAGIC "GCDC"
+#define GC_DISK_CACHE_VERSION 1
+#define GC_DISK_CACHE_RECORD_MAGIC 0x52434447
+#define GC_DISK_CACHE_CHECKSUM_INIT 2166136261u
+#define GC_DISK_CACHE_COMPACT_MIN_SIZE (64 * 1024)
+
+typedef struct _GcDiskCacheHeader {
+	gchar magic[4];
+	guint32 version;
+} GcDiskCacheHeader;
+
+/* Followed by key_length bytes of key (not terminated) and
+ * value_length bytes of value. Host byte order: cache files are
+ * never shared between machines. */
+typedef struct _GcDiskCacheRecord {
+	guint32 magic;
+	guint32 checksum;     /* of key and value */
+	guint32 key_length;
+	guint32 value_length;
+	gint64 expires;       /* seconds since the epoch */
+} GcDiskCacheRecord;
+
+typedef struct _GcDiskCacheEntry {
+	gsize offset;         /* of the GcDiskCacheRecord */
+	guint32 key_length;
+	guint32 value_length;
+	gint64 expires;
+} GcDiskCacheEntry;
+
+struct _GcDiskCache {
+	guint ref_count;
+	gchar *name;
+	gchar *path;
+
+	int fd;               /* for appending, -1 if not writable */
+	GMappedFile *map;
+	gsize file_size;      /* up to the end of the last valid record */
+	gsize live_size;      /* size of the records in index */
+	GHashTable *index;    /* key -> GcDiskCacheEntry */
+};
+
+/* open caches by name */
+static GHashTable *caches = NULL;
+
+static gint64
+gc_disk_cache_now (void)
+{
+	GTimeVal now;
+
+	g_get_current_time (&now);
+	return now.tv_sec;
+}
+
+/* FNV-1a */
+static guint32
+gc_disk_cache_checksum (guint32 hash, const guchar *data, gsize length)
+{
+	gsize i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+#define RECORD_SIZE(entry) \
+	(sizeof (GcDiskCacheRecord) + (entry)->key_length + (entry)->value_length)
+
+/* Add a record to the index, replacing any older record for the key */
+static void
+gc_disk_cache_index (GcDiskCache *cache,
+                     gchar       *key,
+                     gsize        offset,
+                     guint32      value_length,
+                     gint64       expires,
+                     gint64       now)
+{
+	GcDiskCacheEntry *entry;
+
+	entry = g_hash_table_lookup (cache->index, key);
+	if (entry) {
+		cache->live_size -= RECORD_SIZE (entry);
+		g_hash_table_remove (cache->index, key);
+	}
+
+	if (expires <= now) {
+		g_free (key);
+		return;
+	}
+
+	entry = g_new (GcDiskCacheEntry, 1);
+	entry->offset = offset;
+	entry->key_length = strlen (key);
+	entry->value_length = value_length;
+	entry->expires = expires;
+	g_hash_table_insert (cache->index, key, entry);
+	cache->live_size += RECORD_SIZE (entry);
+}
+
+/* Map the file and index all valid, unexpired records */
+static void
+gc_disk_cache_load (GcDiskCache *cache)
+{
+	GError *error = NULL;
+	GcDiskCacheHeader header;
+	GcDiskCacheRecord record;
+	const guchar *data, *key;
+	gsize length, offset;
+	gint64 now = gc_disk_cache_now ();
+
+	g_hash_table_remove_all (cache->index);
+	cache->live_size = 0;
+	cache->file_size = 0;
+	if (cache->map) {
+		g_mapped_file_unref (cache->map);
+		cache->map = NULL;
+	}
+
+	if (!g_file_test (cache->path, G_FILE_TEST_EXISTS)) {
+		return;
+	}
+	cache->map = g_mapped_file_new (cache->path, FALSE, &error);
+	if (!cache->map) {
+		g_warning ("Could not read cache %s: %s", cache->path, error->message);
+		g_error_free (error);
+		return;
+	}
+	data = (const guchar *)g_mapped_file_get_contents (cache->map);
+	length = g_mapped_file_get_length (cache->map);
+
+	if (length < sizeof (header)) {
+		return;
+	}
+	memcpy (&header, data, sizeof (header));
+	if (memcmp (header.magic, GC_DISK_CACHE_MAGIC, 4) != 0 ||
+	    header.version != GC_DISK_CACHE_VERSION) {
+		return;
+	}
+
+	offset = sizeof (header);
+	while (length - offset >= sizeof (record)) {
+		memcpy (&record, data + offset, sizeof (record));
+		if (record.magic != GC_DISK_CACHE_RECORD_MAGIC ||
+		    (gsize)record.key_length + record.value_length >
+		    length - offset - sizeof (record)) {
+			break;
+		}
+		key = data + offset + sizeof (record);
+		if (gc_disk_cache_checksum (GC_DISK_CACHE_CHECKSUM_INIT, key,
+		                            record.key_length + record.value_length) != record.checksum) {
+			break;
+		}
+
+		gc_disk_cache_index (cache,
+		                     g_strndup ((const gchar *)key, record.key_length),
+		                     offset, record.value_length,
+		                     record.expires, now);
+		offset += sizeof (record) + record.key_length + record.value_length;
+	}
+	cache->file_size = offset;
+}
+
+static gboolean
+gc_disk_cache_needs_compaction (GcDiskCache *cache)
+{
+	return (cache->file_size > GC_DISK_CACHE_COMPACT_MIN_SIZE &&
+	        cache->live_size < cache->file_size / 2);
+}
+
+/* Rewrite the file with only the indexed records */
+static void
+gc_disk_cache_compact (GcDiskCache *cache)
+{
+	GError *error = NULL;
+	GHashTableIter iter;
+	GcDiskCacheEntry *entry;
+	GcDiskCacheHeader header;
+	GByteArray *buf;
+	const guchar *data;
+
+	memcpy (header.magic, GC_DISK_CACHE_MAGIC, 4);
+	header.version = GC_DISK_CACHE_VERSION;
+
+	buf = g_byte_array_sized_new (sizeof (header) + cache->live_size);
+	g_byte_array_append (buf, (const guint8 *)&header, sizeof (header));
+
+	data = (const guchar *)g_mapped_file_get_contents (cache->map);
+	g_hash_table_iter_init (&iter, cache->index);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&entry)) {
+		g_byte_array_append (buf, data + entry->offset, RECORD_SIZE (entry));
+	}
+
+	/* written to a temporary file and renamed over the old one */
+	if (!g_file_set_contents (cache->path, (const gchar *)buf->data,
+	                          buf->len, &error)) {
+		g_warning ("Could not compact cache %s: %s",
+		           cache->path, error->message);
+		g_error_free (error);
+	}
+	g_byte_array_free (buf, TRUE);
+
+	gc_disk_cache_load (cache);
+}
+
+/* (Re)load the file and open it for appending */
+static void
+gc_disk_cache_reopen (GcDiskCache *cache)
+{
+	GcDiskCacheHeader header;
+
+	if (cache->fd >= 0) {
+		close (cache->fd);
+		cache->fd = -1;
+	}
+
+	gc_disk_cache_load (cache);
+	if (gc_disk_cache_needs_compaction (cache)) {
+		gc_disk_cache_compact (cache);
+	}
+
+	cache->fd = g_open (cache->path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+	if (cache->fd < 0) {
+		g_warning ("Could not open cache %s for writing", cache->path);
+		return;
+	}
+
+	/* cut off records torn by a crash */
+	if (ftruncate (cache->fd, cache->file_size) != 0) {
+		g_warning ("Could not truncate cache %s", cache->path);
+		close (cache->fd);
+		cache->fd = -1;
+		return;
+	}
+
+	if (cache->file_size == 0) {
+		memcpy (header.magic, GC_DISK_CACHE_MAGIC, 4);
+		header.version = GC_DISK_CACHE_VERSION;
+		if (write (cache->fd, &header, sizeof (header)) != sizeof (header)) {
+			g_warning ("Could not write cache %s", cache->path);
+			close (cache->fd);
+			cache->fd = -1;
+			return;
+		}
+		cache->file_size = sizeof (header);
+	}
+}
+
+/* Returns the cache called name, opening the file if it is not open
+ * yet. NULL if the cache directory can't be created. */
+GcDiskCache *
+gc_disk_cache_open (const gchar *name)
+{
+	GcDiskCache *cache;
+	gchar *dir, *filename;
+
+	if (!caches) {
+		caches = g_hash_table_new (g_str_hash, g_str_equal);
+	}
+
+	cache = g_hash_table_lookup (caches, name);
+	if (cache) {
+		cache->ref_count++;
+		return cache;
+	}
+
+	dir = g_build_filename (g_get_user_cache_dir (), "geoclue", NULL);
+	if (g_mkdir_with_parents (dir, 0700) != 0) {
+		g_warning ("Could not create cache directory %s", dir);
+		g_free (dir);
+		return NULL;
+	}
+
+	cache = g_new0 (GcDiskCache, 1);
+	cache->ref_count = 1;
+	cache->name = g_strdup (name);
+	filename = g_strconcat (name, ".cache", NULL);
+	cache->path = g_build_filename (dir, filename, NULL);
+	g_free (filename);
+	g_free (dir);
+
+	cache->fd = -1;
+	cache->index = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                      g_free, g_free);
+	gc_disk_cache_reopen (cache);
+
+	g_hash_table_insert (caches, cache->name, cache);
+	return cache;
+}
+
+void
+gc_disk_cache_unref (GcDiskCache *cache)
+{
+	if (--cache->ref_count > 0) {
+		return;
+	}
+
+	g_hash_table_remove (caches, cache->name);
+
+	if (cache->fd >= 0) {
+		close (cache->fd);
+	}
+	if (cache->map) {
+		g_mapped_file_unref (cache->map);
+	}
+	g_hash_table_destroy (cache->index);
+	g_free (cache->name);
+	g_free (cache->path);
+	g_free (cache);
+}
+
+/* Copy of the unexpired value for key. @max_age is set to the
+ * remaining lifetime in seconds. */
+gboolean
+gc_disk_cache_lookup (GcDiskCache  *cache,
+                      const gchar  *key,
+                      guchar      **value,
+                      gsize        *length,
+                      glong        *max_age)
+{
+	GError *error = NULL;
+	GcDiskCacheEntry *entry;
+	gint64 now = gc_disk_cache_now ();
+
+	entry = g_hash_table_lookup (cache->index, key);
+	if (!entry || entry->expires <= now) {
+		return FALSE;
+	}
+
+	/* map again to see records appended since the last mapping */
+	if (!cache->map ||
+	    entry->offset + RECORD_SIZE (entry) > g_mapped_file_get_length (cache->map)) {
+		if (cache->map) {
+			g_mapped_file_unref (cache->map);
+		}
+		cache->map = g_mapped_file_new (cache->path, FALSE, &error);
+		if (!cache->map) {
+			g_warning ("Could not read cache %s: %s",
+			           cache->path, error->message);
+			g_error_free (error);
+			return FALSE;
+		}
+		if (entry->offset + RECORD_SIZE (entry) > g_mapped_file_get_length (cache->map)) {
+			return FALSE;
+		}
+	}
+
+	*value = g_memdup (g_mapped_file_get_contents (cache->map) +
+	                   entry->offset + sizeof (GcDiskCacheRecord) + entry->key_length,
+	                   entry->value_length);
+	*length = entry->value_length;
+	*max_age = entry->expires - now;
+	return TRUE;
+}
+
+/* Append a record for key, valid for ttl seconds */
+void
+gc_disk_cache_store (GcDiskCache  *cache,
+                     const gchar  *key,
+                     const guchar *value,
+                     gsize         length,
+                     guint         ttl)
+{
+	GcDiskCacheRecord record;
+	GByteArray *buf;
+	gint64 now = gc_disk_cache_now ();
+
+	if (cache->fd < 0 || ttl == 0 || length > G_MAXUINT32) {
+		return;
+	}
+
+	record.magic = GC_DISK_CACHE_RECORD_MAGIC;
+	record.key_length = strlen (key);
+	record.value_length = length;
+	record.expires = now + ttl;
+	record.checksum = gc_disk_cache_checksum (GC_DISK_CACHE_CHECKSUM_INIT,
+	                                          (const guchar *)key,
+	                                          record.key_length);
+	record.checksum = gc_disk_cache_checksum (record.checksum, value, length);
+
+	buf = g_byte_array_sized_new (sizeof (record) + record.key_length + length);
+	g_byte_array_append (buf, (const guint8 *)&record, sizeof (record));
+	g_byte_array_append (buf, (const guint8 *)key, record.key_length);
+	g_byte_array_append (buf, value, length);
+
+	if (write (cache->fd, buf->data, buf->len) != (gssize)buf->len) {
+		g_warning ("Could not write cache %s", cache->path);
+		/* later records must not end up behind a partial one */
+		if (ftruncate (cache->fd, cache->file_size) != 0) {
+			close (cache->fd);
+			cache->fd = -1;
+		}
+	} else {
+		gc_disk_cache_index (cache, g_strdup (key), cache->file_size,
+		                     record.value_length, record.expires, now);
+		cache->file_size += buf->len;
+	}
+	g_byte_array_free (buf, TRUE);
+
+	if (gc_disk_cache_needs_compaction (cache)) {
+		gc_disk_cache_reopen (cache);
+	}
+}
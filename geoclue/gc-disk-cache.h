@@ -0,0 +1,49 @@
+/*
+ * Geoclue
+ * gc-disk-cache.h - Persistent key-value cache for web service responses
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* Private to libgeoclue, used by GcWebService. Not installed. */
+
+#ifndef GC_DISK_CACHE_H
+#define GC_DISK_CACHE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GcDiskCache GcDiskCache;
+
+GcDiskCache *gc_disk_cache_open (const gchar *name);
+void gc_disk_cache_unref (GcDiskCache *cache);
+
+gboolean gc_disk_cache_lookup (GcDiskCache  *cache,
+                               const gchar  *key,
+                               guchar      **value,
+                               gsize        *length,
+                               glong        *max_age);
+void gc_disk_cache_store (GcDiskCache  *cache,
+                          const gchar  *key,
+                          const guchar *value,
+                          gsize         length,
+                          guint         ttl);
+
+G_END_DECLS
+
+#endif /* GC_DISK_CACHE_H */
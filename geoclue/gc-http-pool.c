@@ -0,0 +1,857 @@
+/*
+ * Geoclue
+ * gc-http-pool.c - Minimal HTTP/1.1 client with a keep-alive connection pool
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * libxml nanohttp speaks HTTP/1.0 and closes the connection after every
+ * request. This is a small blocking HTTP/1.1 GET client that keeps
+ * connections open and reuses them: idle connections are kept per
+ * host ("host[:port]") for idle_timeout seconds and at most
+ * max_connections connections to a single host are open at a time.
+ * The pool is shared by all GcWebService objects in the process and
+ * may be used from the worker threads of gc_web_service_query_async().
+ *
+ * Proxies come from the default GProxyResolver, so http_proxy and
+ * no_proxy (or the desktop proxy settings) are honoured. Requests for
+ * an http proxy are sent to it with the absolute url and connections
+ * to it are pooled like those to any other host; other kinds of proxy
+ * are left to GSocketClient.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "gc-http-pool.h"
+#include "geoclue-error.h"
+
+#define GC_HTTP_POOL_MAX_REDIRECTS 10
+#define GC_HTTP_POOL_SOCKET_TIMEOUT 60
+/* how often a query waiting for a connection checks its cancellable */
+#define GC_HTTP_POOL_CANCEL_CHECK_INTERVAL 500 /* milliseconds */
+#define GC_HTTP_POOL_USER_AGENT "geoclue/" PACKAGE_VERSION
+
+typedef struct _GcHttpHost {
+	gchar *name;
+	GQueue idle;   /* GcHttpConnections, most recently used first */
+	guint n_open;  /* both idle and busy connections */
+} GcHttpHost;
+
+typedef struct _GcHttpConnection {
+	GcHttpHost *host;
+	GSocketConnection *connection;
+	GDataInputStream *input;
+	glong idle_since;
+	gboolean reused;
+} GcHttpConnection;
+
+static GMutex *pool_mutex = NULL;
+static GCond *pool_cond = NULL;
+static GHashTable *hosts = NULL;
+static guint max_connections = GC_HTTP_POOL_DEFAULT_MAX_CONNECTIONS;
+static guint idle_timeout = GC_HTTP_POOL_DEFAULT_IDLE_TIMEOUT;
+static guint reaper_id = 0;
+
+static glong
+gc_http_pool_now (void)
+{
+	GTimeVal now;
+
+	g_get_current_time (&now);
+	return now.tv_sec;
+}
+
+static void
+gc_http_connection_free (GcHttpConnection *conn)
+{
+	g_io_stream_close (G_IO_STREAM (conn->connection), NULL, NULL);
+	g_object_unref (conn->input);
+	g_object_unref (conn->connection);
+	g_slice_free (GcHttpConnection, conn);
+}
+
+/* GSourceFunc, closes connections that have been idle too long.
+ * Runs in the default main context */
+static gboolean
+gc_http_pool_reap (gpointer data)
+{
+	GHashTableIter iter;
+	GcHttpHost *host;
+	glong now = gc_http_pool_now ();
+	guint n_idle = 0;
+
+	g_mutex_lock (pool_mutex);
+	g_hash_table_iter_init (&iter, hosts);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&host)) {
+		/* oldest connections are at the tail */
+		while (!g_queue_is_empty (&host->idle)) {
+			GcHttpConnection *conn = g_queue_peek_tail (&host->idle);
+
+			if (now - conn->idle_since < (glong)idle_timeout) {
+				break;
+			}
+			g_queue_pop_tail (&host->idle);
+			host->n_open--;
+			gc_http_connection_free (conn);
+		}
+		n_idle += g_queue_get_length (&host->idle);
+	}
+	if (n_idle == 0) {
+		reaper_id = 0;
+	}
+	g_cond_broadcast (pool_cond);
+	g_mutex_unlock (pool_mutex);
+
+	return (n_idle > 0);
+}
+
+/* Get an idle connection to host_name or open a new one. Blocks if
+ * max_connections connections to the host are already in use, until
+ * one is released or cancellable is cancelled.
+ * is_proxy: host_name is an http proxy, connect to it directly. */
+static GcHttpConnection *
+gc_http_pool_checkout (const gchar   *host_name,
+                       gboolean       is_proxy,
+                       GCancellable  *cancellable,
+                       GError       **error)
+{
+	GcHttpHost *host;
+	GcHttpConnection *conn = NULL;
+	GSocketClient *client;
+	GSocketConnection *connection;
+	GError *tmp_error = NULL;
+	GTimeVal wait_until;
+	glong now = gc_http_pool_now ();
+
+	g_mutex_lock (pool_mutex);
+	host = g_hash_table_lookup (hosts, host_name);
+	if (!host) {
+		host = g_slice_new0 (GcHttpHost);
+		host->name = g_strdup (host_name);
+		g_queue_init (&host->idle);
+		g_hash_table_insert (hosts, host->name, host);
+	}
+
+	while (TRUE) {
+		if (!g_queue_is_empty (&host->idle)) {
+			conn = g_queue_pop_head (&host->idle);
+			if (now - conn->idle_since < (glong)idle_timeout) {
+				conn->reused = TRUE;
+				break;
+			}
+			host->n_open--;
+			gc_http_connection_free (conn);
+			conn = NULL;
+		} else if (max_connections == 0 || host->n_open < max_connections) {
+			host->n_open++;
+			break;
+		} else if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			g_mutex_unlock (pool_mutex);
+			return NULL;
+		} else {
+			/* the cancellable can't wake us, so don't wait
+			 * for ever */
+			g_get_current_time (&wait_until);
+			g_time_val_add (&wait_until,
+			                GC_HTTP_POOL_CANCEL_CHECK_INTERVAL * 1000);
+			g_cond_timed_wait (pool_cond, pool_mutex, &wait_until);
+		}
+	}
+	g_mutex_unlock (pool_mutex);
+
+	if (conn) {
+		return conn;
+	}
+
+	client = g_socket_client_new ();
+	g_socket_client_set_timeout (client, GC_HTTP_POOL_SOCKET_TIMEOUT);
+	g_socket_client_set_enable_proxy (client, !is_proxy);
+	connection = g_socket_client_connect_to_host (client, host_name, 80,
+	                                              cancellable, &tmp_error);
+	g_object_unref (client);
+
+	if (!connection) {
+		g_mutex_lock (pool_mutex);
+		host->n_open--;
+		g_cond_broadcast (pool_cond);
+		g_mutex_unlock (pool_mutex);
+
+		g_set_error (error, GEOCLUE_ERROR,
+		             GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "Could not connect to %s: %s",
+		             host_name, tmp_error->message);
+		g_error_free (tmp_error);
+		return NULL;
+	}
+
+	conn = g_slice_new0 (GcHttpConnection);
+	conn->host = host;
+	conn->connection = connection;
+	conn->input = g_data_input_stream_new
+		(g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	g_data_input_stream_set_newline_type (conn->input,
+	                                      G_DATA_STREAM_NEWLINE_TYPE_LF);
+	return conn;
+}
+
+/* Return a connection to the pool, or close it if it can't be reused */
+static void
+gc_http_pool_release (GcHttpConnection *conn, gboolean keep_alive)
+{
+	GcHttpHost *host = conn->host;
+
+	g_mutex_lock (pool_mutex);
+	if (keep_alive && idle_timeout > 0) {
+		conn->idle_since = gc_http_pool_now ();
+		g_queue_push_head (&host->idle, conn);
+		if (reaper_id == 0) {
+			reaper_id = g_timeout_add_seconds (idle_timeout,
+			                                   gc_http_pool_reap,
+			                                   NULL);
+		}
+	} else {
+		host->n_open--;
+		gc_http_connection_free (conn);
+	}
+	g_cond_broadcast (pool_cond);
+	g_mutex_unlock (pool_mutex);
+}
+
+static void
+gc_http_set_closed_error (GError **error)
+{
+	g_set_error_literal (error, GEOCLUE_ERROR,
+	                     GEOCLUE_ERROR_NOT_AVAILABLE,
+	                     "Connection closed before end of response");
+}
+
+/* Read a line, strip the line ending. Returns NULL on error or EOF */
+static gchar *
+gc_http_read_line (GDataInputStream *input,
+                   GCancellable     *cancellable,
+                   GError          **error)
+{
+	gchar *line;
+	gsize length;
+
+	line = g_data_input_stream_read_line (input, &length,
+	                                      cancellable, error);
+	if (line && length > 0 && line[length - 1] == '\r') {
+		line[length - 1] = '\0';
+	}
+	return line;
+}
+
+/* Read header lines up to the empty line. Headers are added to
+ * @headers (if not NULL) with lower case names */
+static gboolean
+gc_http_read_headers (GDataInputStream *input,
+                      GHashTable       *headers,
+                      GCancellable     *cancellable,
+                      GError          **error)
+{
+	gchar *line, *colon, *name, *value, *old_value;
+
+	while (TRUE) {
+		line = gc_http_read_line (input, cancellable, error);
+		if (!line) {
+			if (error && !*error) {
+				gc_http_set_closed_error (error);
+			}
+			return FALSE;
+		}
+		if (line[0] == '\0') {
+			g_free (line);
+			return TRUE;
+		}
+
+		colon = strchr (line, ':');
+		if (headers && colon) {
+			*colon = '\0';
+			name = g_ascii_strdown (g_strstrip (line), -1);
+			value = g_strstrip (colon + 1);
+
+			old_value = g_hash_table_lookup (headers, name);
+			if (old_value) {
+				value = g_strconcat (old_value, ", ", value, NULL);
+			} else {
+				value = g_strdup (value);
+			}
+			g_hash_table_insert (headers, name, value);
+		}
+		g_free (line);
+	}
+}
+
+/* TRUE if the comma separated header value contains token */
+static gboolean
+gc_http_header_has_token (const gchar *value, const gchar *token)
+{
+	gchar **tokens;
+	gboolean found = FALSE;
+	int i;
+
+	if (!value) {
+		return FALSE;
+	}
+
+	tokens = g_strsplit (value, ",", 0);
+	for (i = 0; tokens[i] && !found; i++) {
+		found = (g_ascii_strcasecmp (g_strstrip (tokens[i]), token) == 0);
+	}
+	g_strfreev (tokens);
+	return found;
+}
+
+/* Where a response body goes: to func if set, otherwise into body */
+typedef struct _GcHttpSink {
+	GByteArray *body;
+	GcHttpBodyFunc func;
+	gpointer user_data;
+} GcHttpSink;
+
+static gboolean
+gc_http_sink_write (GcHttpSink   *sink,
+                    const guchar *data,
+                    gsize         length,
+                    GError      **error)
+{
+	if (sink->func) {
+		return sink->func (data, length, sink->user_data, error);
+	}
+	g_byte_array_append (sink->body, data, length);
+	return TRUE;
+}
+
+static gboolean
+gc_http_read_bytes (GDataInputStream *input,
+                    GcHttpSink       *sink,
+                    guint64           count,
+                    GCancellable     *cancellable,
+                    GError          **error)
+{
+	guchar buf[4096];
+	gsize bytes_read;
+
+	while (count > 0) {
+		if (!g_input_stream_read_all (G_INPUT_STREAM (input), buf,
+		                              MIN (count, sizeof (buf)),
+		                              &bytes_read,
+		                              cancellable, error)) {
+			return FALSE;
+		}
+		if (bytes_read == 0) {
+			gc_http_set_closed_error (error);
+			return FALSE;
+		}
+		if (!gc_http_sink_write (sink, buf, bytes_read, error)) {
+			return FALSE;
+		}
+		count -= bytes_read;
+	}
+	return TRUE;
+}
+
+static gboolean
+gc_http_read_to_eof (GDataInputStream *input,
+                     GcHttpSink       *sink,
+                     GCancellable     *cancellable,
+                     GError          **error)
+{
+	guchar buf[4096];
+	gssize bytes_read;
+
+	while ((bytes_read = g_input_stream_read (G_INPUT_STREAM (input),
+	                                          buf, sizeof (buf),
+	                                          cancellable, error)) > 0) {
+		if (!gc_http_sink_write (sink, buf, bytes_read, error)) {
+			return FALSE;
+		}
+	}
+	return (bytes_read == 0);
+}
+
+static gboolean
+gc_http_read_chunked (GDataInputStream *input,
+                      GcHttpSink       *sink,
+                      GCancellable     *cancellable,
+                      GError          **error)
+{
+	gchar *line;
+	guint64 size;
+
+	while (TRUE) {
+		/* chunk size in hex, possibly followed by extensions */
+		line = gc_http_read_line (input, cancellable, error);
+		if (!line) {
+			if (error && !*error) {
+				gc_http_set_closed_error (error);
+			}
+			return FALSE;
+		}
+		size = g_ascii_strtoull (line, NULL, 16);
+		g_free (line);
+
+		if (size == 0) {
+			break;
+		}
+		if (!gc_http_read_bytes (input, sink, size, cancellable, error)) {
+			return FALSE;
+		}
+
+		/* CRLF after chunk data */
+		line = gc_http_read_line (input, cancellable, error);
+		if (!line) {
+			if (error && !*error) {
+				gc_http_set_closed_error (error);
+			}
+			return FALSE;
+		}
+		g_free (line);
+	}
+
+	/* trailers */
+	return gc_http_read_headers (input, NULL, cancellable, error);
+}
+
+/* Send a GET request for target (the path, or the absolute url when
+ * conn is to a proxy) on conn and read the response. @retry is set if
+ * the request failed on a reused connection before any response was
+ * read: the server has most likely closed the idle connection. */
+static gboolean
+gc_http_pool_request (GcHttpConnection *conn,
+                      const gchar      *host_name,
+                      const gchar      *target,
+                      GcHttpResponse   *response,
+                      GcHttpBodyFunc    body_func,
+                      gpointer          user_data,
+                      gboolean         *keep_alive,
+                      gboolean         *retry,
+                      GCancellable     *cancellable,
+                      GError          **error)
+{
+	GOutputStream *output;
+	GcHttpSink sink;
+	gchar *request, *line;
+	const gchar *value;
+	guint minor = 0;
+	gboolean ok;
+
+	*keep_alive = FALSE;
+	*retry = FALSE;
+
+	request = g_strdup_printf ("GET %s HTTP/1.1\r\n"
+	                           "Host: %s\r\n"
+	                           "User-Agent: " GC_HTTP_POOL_USER_AGENT "\r\n"
+	                           "Accept-Encoding: identity\r\n"
+	                           "Connection: keep-alive\r\n"
+	                           "\r\n",
+	                           target, host_name);
+	output = g_io_stream_get_output_stream (G_IO_STREAM (conn->connection));
+	ok = g_output_stream_write_all (output, request, strlen (request),
+	                                NULL, cancellable, error);
+	g_free (request);
+	if (!ok) {
+		*retry = conn->reused;
+		return FALSE;
+	}
+
+	/* status line, skipping any informational 1xx responses */
+	do {
+		line = gc_http_read_line (conn->input, cancellable, error);
+		if (!line) {
+			*retry = conn->reused;
+			if (error && !*error) {
+				gc_http_set_closed_error (error);
+			}
+			return FALSE;
+		}
+		if (sscanf (line, "HTTP/1.%u %u", &minor, &response->status) != 2) {
+			g_set_error (error, GEOCLUE_ERROR,
+			             GEOCLUE_ERROR_FAILED,
+			             "Malformed HTTP response from %s", host_name);
+			g_free (line);
+			return FALSE;
+		}
+		g_free (line);
+
+		g_hash_table_remove_all (response->headers);
+		if (!gc_http_read_headers (conn->input, response->headers,
+		                           cancellable, error)) {
+			return FALSE;
+		}
+	} while (response->status >= 100 && response->status < 200);
+
+	value = g_hash_table_lookup (response->headers, "connection");
+	if (minor >= 1) {
+		*keep_alive = !gc_http_header_has_token (value, "close");
+	} else {
+		*keep_alive = gc_http_header_has_token (value, "keep-alive");
+	}
+
+	/* only the body of a successful response is streamed */
+	sink.body = g_byte_array_new ();
+	sink.func = (response->status == 200) ? body_func : NULL;
+	sink.user_data = user_data;
+	if (response->status == 204 || response->status == 304) {
+		ok = TRUE;
+	} else if (gc_http_header_has_token (g_hash_table_lookup (response->headers,
+	                                                          "transfer-encoding"),
+	                                     "chunked")) {
+		ok = gc_http_read_chunked (conn->input, &sink, cancellable, error);
+	} else if ((value = g_hash_table_lookup (response->headers, "content-length"))) {
+		ok = gc_http_read_bytes (conn->input, &sink,
+		                         g_ascii_strtoull (value, NULL, 10),
+		                         cancellable, error);
+	} else {
+		/* body is delimited by the end of the connection */
+		ok = gc_http_read_to_eof (conn->input, &sink, cancellable, error);
+		*keep_alive = FALSE;
+	}
+
+	if (!ok) {
+		*keep_alive = FALSE;
+		g_byte_array_free (sink.body, TRUE);
+		return FALSE;
+	}
+
+	response->length = sink.body->len;
+	response->body = g_byte_array_free (sink.body, FALSE);
+	return TRUE;
+}
+
+/* One request-response exchange, retried on a fresh connection if a
+ * pooled one turns out to be closed. The request for "http://"
+ * host_name path goes to proxy if it is set. */
+static gboolean
+gc_http_pool_fetch (const gchar     *host_name,
+                    const gchar     *path,
+                    const gchar     *proxy,
+                    GcHttpResponse  *response,
+                    GcHttpBodyFunc   body_func,
+                    gpointer         user_data,
+                    GCancellable    *cancellable,
+                    GError         **error)
+{
+	GcHttpConnection *conn;
+	GError *tmp_error = NULL;
+	gchar *target = NULL;
+	gboolean keep_alive, retry, success;
+
+	if (proxy) {
+		target = g_strconcat ("http://", host_name, path, NULL);
+	}
+
+	do {
+		conn = gc_http_pool_checkout (proxy ? proxy : host_name,
+		                              proxy != NULL,
+		                              cancellable, error);
+		if (!conn) {
+			g_free (target);
+			return FALSE;
+		}
+
+		gc_http_response_clear (response);
+		response->headers = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                           g_free, g_free);
+		success = gc_http_pool_request (conn, host_name,
+		                                target ? target : path, response,
+		                                body_func, user_data,
+		                                &keep_alive, &retry,
+		                                cancellable, &tmp_error);
+		gc_http_pool_release (conn, success && keep_alive);
+
+		if (!success) {
+			if (retry && !g_cancellable_is_cancelled (cancellable)) {
+				g_clear_error (&tmp_error);
+			} else {
+				retry = FALSE;
+				g_propagate_error (error, tmp_error);
+			}
+		}
+	} while (!success && retry);
+
+	g_free (target);
+	return success;
+}
+
+/* Split "http://host[:port]/path?query" into "host[:port]" and
+ * "/path?query". Other schemes are not supported. */
+static gboolean
+gc_http_parse_url (const gchar *url, gchar **host_name, gchar **path)
+{
+	const gchar *authority, *end;
+	gchar *fragment;
+
+	if (g_ascii_strncasecmp (url, "http://", 7) != 0) {
+		return FALSE;
+	}
+	authority = url + 7;
+	end = authority + strcspn (authority, "/?#");
+	if (end == authority) {
+		return FALSE;
+	}
+
+	*host_name = g_strndup (authority, end - authority);
+	if (*end == '/') {
+		*path = g_strdup (end);
+	} else if (*end == '?') {
+		*path = g_strconcat ("/", end, NULL);
+	} else {
+		*path = g_strdup ("/");
+	}
+
+	fragment = strchr (*path, '#');
+	if (fragment) {
+		*fragment = '\0';
+	}
+	return TRUE;
+}
+
+/* The http proxy to use for url as "host[:port]", NULL if the
+ * connection is direct or through another kind of proxy */
+static gchar *
+gc_http_get_proxy (const gchar *url, GCancellable *cancellable)
+{
+	gchar **proxies;
+	gchar *proxy = NULL, *path;
+
+	proxies = g_proxy_resolver_lookup (g_proxy_resolver_get_default (),
+	                                   url, cancellable, NULL);
+	if (proxies && proxies[0] &&
+	    gc_http_parse_url (proxies[0], &proxy, &path)) {
+		g_free (path);
+	}
+	g_strfreev (proxies);
+	return proxy;
+}
+
+/* Absolute url for a Location header, NULL if we can't follow it */
+static gchar *
+gc_http_resolve_location (const gchar *host_name, const gchar *location)
+{
+	if (g_ascii_strncasecmp (location, "http://", 7) == 0) {
+		return g_strdup (location);
+	} else if (location[0] == '/') {
+		return g_strdup_printf ("http://%s%s", host_name, location);
+	}
+	return NULL;
+}
+
+void
+gc_http_pool_init (void)
+{
+	if (pool_mutex) {
+		return;
+	}
+
+#if !GLIB_CHECK_VERSION (2, 32, 0)
+	/* pool is used from the gc_web_service_query_async() thread pool */
+	if (!g_thread_supported ()) {
+		g_thread_init (NULL);
+	}
+#endif
+	pool_mutex = g_mutex_new ();
+	pool_cond = g_cond_new ();
+	hosts = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+/* max_connections: per host, 0 for unlimited.
+ * idle_timeout: seconds, 0 disables keep-alive */
+void
+gc_http_pool_set_limits (guint new_max_connections, guint new_idle_timeout)
+{
+	gc_http_pool_init ();
+
+	g_mutex_lock (pool_mutex);
+	max_connections = new_max_connections;
+	idle_timeout = new_idle_timeout;
+	g_cond_broadcast (pool_cond);
+	g_mutex_unlock (pool_mutex);
+}
+
+/* Fetch url, following redirects. On success @response must be
+ * freed with gc_http_response_clear(). If body_func is set, the body
+ * of a 200 response is passed to it as it arrives instead of being
+ * stored in @response. */
+gboolean
+gc_http_pool_get (const gchar    *url,
+                  GcHttpResponse *response,
+                  GcHttpBodyFunc  body_func,
+                  gpointer        user_data,
+                  GCancellable   *cancellable,
+                  GError        **error)
+{
+	gchar *current_url, *next_url, *host_name, *path, *proxy;
+	const gchar *location;
+	guint redirects = 0;
+	gboolean success = FALSE;
+
+	g_assert (pool_mutex);
+
+	memset (response, 0, sizeof (GcHttpResponse));
+	current_url = g_strdup (url);
+
+	while (TRUE) {
+		if (!gc_http_parse_url (current_url, &host_name, &path)) {
+			g_set_error (error, GEOCLUE_ERROR,
+			             GEOCLUE_ERROR_NOT_AVAILABLE,
+			             "Unsupported url %s", current_url);
+			success = FALSE;
+			break;
+		}
+
+		proxy = gc_http_get_proxy (current_url, cancellable);
+		success = gc_http_pool_fetch (host_name, path, proxy, response,
+		                              body_func, user_data,
+		                              cancellable, error);
+		g_free (proxy);
+		next_url = NULL;
+		if (success &&
+		    (response->status == 301 || response->status == 302 ||
+		     response->status == 303 || response->status == 307) &&
+		    redirects < GC_HTTP_POOL_MAX_REDIRECTS) {
+			location = g_hash_table_lookup (response->headers, "location");
+			if (location) {
+				next_url = gc_http_resolve_location (host_name, location);
+			}
+		}
+		g_free (host_name);
+		g_free (path);
+
+		if (!next_url) {
+			break;
+		}
+		redirects++;
+		g_free (current_url);
+		current_url = next_url;
+	}
+	g_free (current_url);
+
+	if (!success) {
+		gc_http_response_clear (response);
+	}
+	return success;
+}
+
+static const gchar *gc_http_months[] = {
+	"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+	"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/* Parse an RFC 1123 date ("Sun, 06 Nov 1994 08:49:37 GMT") to seconds
+ * since the epoch, -1 on failure. The obsolete formats are not
+ * supported. */
+static glong
+gc_http_parse_date (const gchar *value)
+{
+	GDate *epoch, *date;
+	gchar month_name[4];
+	gint day, month, year, hour, minute, second;
+	glong days;
+	const gchar *comma;
+
+	comma = strchr (value, ',');
+	if (!comma ||
+	    sscanf (comma + 1, " %2d %3s %4d %2d:%2d:%2d",
+	            &day, month_name, &year, &hour, &minute, &second) != 6) {
+		return -1;
+	}
+	for (month = 0; month < 12; month++) {
+		if (g_ascii_strcasecmp (month_name, gc_http_months[month]) == 0) {
+			break;
+		}
+	}
+	if (month == 12 || !g_date_valid_dmy (day, month + 1, year)) {
+		return -1;
+	}
+
+	epoch = g_date_new_dmy (1, G_DATE_JANUARY, 1970);
+	date = g_date_new_dmy (day, month + 1, year);
+	days = g_date_days_between (epoch, date);
+	g_date_free (epoch);
+	g_date_free (date);
+
+	return ((days * 24 + hour) * 60 + minute) * 60 + second;
+}
+
+/* Seconds the response may be cached according to Cache-Control and
+ * Expires headers: 0 if it must not be cached, -1 if the server did 
+ * not say. */
+glong
+gc_http_response_get_max_age (GcHttpResponse *response)
+{
+	const gchar *value;
+	gchar **directives;
+	glong max_age = -1, expires, date;
+	int i;
+
+	value = g_hash_table_lookup (response->headers, "cache-control");
+	if (value) {
+		directives = g_strsplit (value, ",", 0);
+		for (i = 0; directives[i]; i++) {
+			gchar *directive = g_strstrip (directives[i]);
+
+			if (g_ascii_strcasecmp (directive, "no-store") == 0 ||
+			    g_ascii_strcasecmp (directive, "no-cache") == 0) {
+				max_age = 0;
+				break;
+			} else if (g_ascii_strncasecmp (directive, "max-age=", 8) == 0) {
+				max_age = MAX (strtol (directive + 8, NULL, 10), 0);
+			}
+		}
+		g_strfreev (directives);
+		if (max_age >= 0) {
+			return max_age;
+		}
+	}
+
+	value = g_hash_table_lookup (response->headers, "expires");
+	if (value) {
+		/* invalid dates (e.g. "0") mean already expired */
+		expires = gc_http_parse_date (value);
+		if (expires < 0) {
+			return 0;
+		}
+		value = g_hash_table_lookup (response->headers, "date");
+		date = value ? gc_http_parse_date (value) : -1;
+		if (date < 0) {
+			date = gc_http_pool_now ();
+		}
+		return MAX (expires - date, 0);
+	}
+
+	return -1;
+}
+
+void
+gc_http_response_clear (GcHttpResponse *response)
+{
+	if (response->headers) {
+		g_hash_table_destroy (response->headers);
+	}
+	g_free (response->body);
+	memset (response, 0, sizeof (GcHttpResponse));
+}
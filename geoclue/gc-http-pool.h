@@ -0,0 +1,62 @@
+/*
+ * Geoclue
+ * gc-http-pool.h - Minimal HTTP/1.1 client with a keep-alive connection pool
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* Private to libgeoclue, used by GcWebService. Not installed. */
+
+#ifndef GC_HTTP_POOL_H
+#define GC_HTTP_POOL_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GC_HTTP_POOL_DEFAULT_MAX_CONNECTIONS 4
+#define GC_HTTP_POOL_DEFAULT_IDLE_TIMEOUT 30
+
+typedef struct _GcHttpResponse {
+	guint status;
+	GHashTable *headers; /* lower case header name -> value */
+	guchar *body;
+	gsize length;
+} GcHttpResponse;
+
+/* Receives a response body piece by piece, returns FALSE on error */
+typedef gboolean (*GcHttpBodyFunc) (const guchar *data,
+                                    gsize         length,
+                                    gpointer      user_data,
+                                    GError      **error);
+
+void gc_http_pool_init (void);
+void gc_http_pool_set_limits (guint max_connections, guint idle_timeout);
+
+gboolean gc_http_pool_get (const gchar    *url,
+                           GcHttpResponse *response,
+                           GcHttpBodyFunc  body_func,
+                           gpointer        user_data,
+                           GCancellable   *cancellable,
+                           GError        **error);
+
+glong gc_http_response_get_max_age (GcHttpResponse *response);
+void gc_http_response_clear (GcHttpResponse *response);
+
+G_END_DECLS
+
+#endif /* GC_HTTP_POOL_H */
@@ -36,12 +36,9 @@ enum {
 
 static guint signals[LAST_SIGNAL] = {0};
 
-static gboolean 
-gc_iface_address_get_address (GcIfaceAddress   *gc,
-			      int              *timestamp,
-			      GHashTable      **address,
-			      GeoclueAccuracy **accuracy,
-			      GError          **error);
+static void 
+gc_iface_address_get_address (GcIfaceAddress        *gc,
+			      DBusGMethodInvocation *context);
 #include "gc-iface-address-glue.h"
 
 static void
@@ -86,15 +83,39 @@ gc_iface_address_get_type (void)
 	return type;
 }
 
-static gboolean 
-gc_iface_address_get_address (GcIfaceAddress   *gc,
-			      int              *timestamp,
-			      GHashTable      **address,
-			      GeoclueAccuracy **accuracy,
-			      GError          **error)
+static void 
+gc_iface_address_get_address (GcIfaceAddress        *gc,
+			      DBusGMethodInvocation *context)
 {
-	return GC_IFACE_ADDRESS_GET_CLASS (gc)->get_address 
-		(gc, timestamp, address, accuracy, error);
+	GcIfaceAddressClass *klass = GC_IFACE_ADDRESS_GET_CLASS (gc);
+	int timestamp = 0;
+	GHashTable *address = NULL;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+	
+	if (klass->get_address_async) {
+		klass->get_address_async (gc, context);
+		return;
+	}
+	
+	if (!klass->get_address (gc, &timestamp, &address, 
+				 &accuracy, &error)) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+	
+	if (!address) {
+		address = geoclue_address_details_new ();
+	}
+	if (!accuracy) {
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+						 0.0, 0.0);
+	}
+	dbus_g_method_return (context, timestamp, address, accuracy);
+	/* the implementation may share address with others */
+	g_hash_table_unref (address);
+	geoclue_accuracy_free (accuracy);
 }
 
 void
@@ -56,6 +56,11 @@ struct _GcIfaceAddressClass {
 				 GHashTable      **address,
 				 GeoclueAccuracy **accuracy,
 				 GError          **error);
+
+	/* Optional non-blocking version of get_address, see 
+	 * GcIfacePositionClass::get_position_async */
+	void (*get_address_async) (GcIfaceAddress        *gc,
+				   DBusGMethodInvocation *context);
 };
 
 GType gc_iface_address_get_type (void);
@@ -0,0 +1,104 @@
+/*
+ * Geoclue
+ * gc-iface-fix.c - GInterface for org.freedesktop.Geoclue.Fix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <glib.h>
+
+#include <dbus/dbus-glib.h>
+#include <geoclue/gc-iface-fix.h>
+#include <geoclue/geoclue-marshal.h>
+#include <geoclue/geoclue-accuracy.h>
+
+enum {
+	POSITION_AND_VELOCITY_CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = {0};
+
+#include "gc-iface-fix-glue.h"
+
+static void
+gc_iface_fix_base_init (gpointer klass)
+{
+	static gboolean initialized = FALSE;
+
+	if (initialized) {
+		return;
+	}
+	initialized = TRUE;
+
+	signals[POSITION_AND_VELOCITY_CHANGED] = g_signal_new ("position-and-velocity-changed",
+							       G_OBJECT_CLASS_TYPE (klass),
+							       G_SIGNAL_RUN_LAST, 0,
+							       NULL, NULL,
+							       geoclue_marshal_VOID__INT_INT_INT_DOUBLE_DOUBLE_DOUBLE_DOUBLE_DOUBLE_DOUBLE_BOXED,
+							       G_TYPE_NONE, 10,
+							       G_TYPE_INT,
+							       G_TYPE_INT,
+							       G_TYPE_INT,
+							       G_TYPE_DOUBLE,
+							       G_TYPE_DOUBLE,
+							       G_TYPE_DOUBLE,
+							       G_TYPE_DOUBLE,
+							       G_TYPE_DOUBLE,
+							       G_TYPE_DOUBLE,
+							       GEOCLUE_ACCURACY_TYPE);
+	dbus_g_object_type_install_info (gc_iface_fix_get_type (),
+					 &dbus_glib_gc_iface_fix_object_info);
+}
+
+GType
+gc_iface_fix_get_type (void)
+{
+	static GType type = 0;
+
+	if (!type) {
+		const GTypeInfo info = {
+			sizeof (GcIfaceFixClass),
+			gc_iface_fix_base_init,
+			NULL,
+		};
+
+		type = g_type_register_static (G_TYPE_INTERFACE,
+					       "GcIfaceFix", &info, 0);
+	}
+
+	return type;
+}
+
+void
+gc_iface_fix_emit_position_and_velocity_changed (GcIfaceFix           *gc,
+						 GeocluePositionFields position_fields,
+						 GeoclueVelocityFields velocity_fields,
+						 int                   timestamp,
+						 double                latitude,
+						 double                longitude,
+						 double                altitude,
+						 double                speed,
+						 double                direction,
+						 double                climb,
+						 GeoclueAccuracy      *accuracy)
+{
+	g_signal_emit (gc, signals[POSITION_AND_VELOCITY_CHANGED], 0,
+		       position_fields, velocity_fields, timestamp,
+		       latitude, longitude, altitude,
+		       speed, direction, climb, accuracy);
+}
@@ -0,0 +1,78 @@
+/*
+ * Geoclue
+ * gc-iface-fix.h - GInterface for org.freedesktop.Geoclue.Fix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _GC_IFACE_FIX_H
+#define _GC_IFACE_FIX_H
+
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+G_BEGIN_DECLS
+
+#define GC_TYPE_IFACE_FIX (gc_iface_fix_get_type ())
+#define GC_IFACE_FIX(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GC_TYPE_IFACE_FIX, GcIfaceFix))
+#define GC_IFACE_FIX_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST ((klass), GC_TYPE_IFACE_FIX, GcIfaceFixClass))
+#define GC_IS_IFACE_FIX(obj) (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GC_TYPE_IFACE_FIX))
+#define GC_IS_IFACE_FIX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GC_TYPE_IFACE_FIX))
+#define GC_IFACE_FIX_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_INTERFACE ((obj), GC_TYPE_IFACE_FIX, GcIfaceFixClass))
+
+typedef struct _GcIfaceFix GcIfaceFix; /* Dummy typedef */
+typedef struct _GcIfaceFixClass GcIfaceFixClass;
+
+/* Optional interface for providers that implement both GcIfacePosition
+ * and GcIfaceVelocity. It only has a signal, so there is no vtable. */
+struct _GcIfaceFixClass {
+	GTypeInterface base_iface;
+
+	/* signals */
+	void (* position_and_velocity_changed) (GcIfaceFix           *gc,
+						GeocluePositionFields position_fields,
+						GeoclueVelocityFields velocity_fields,
+						int                   timestamp,
+						double                latitude,
+						double                longitude,
+						double                altitude,
+						double                speed,
+						double                direction,
+						double                climb,
+						GeoclueAccuracy      *accuracy);
+};
+
+GType gc_iface_fix_get_type (void);
+
+/* Emits a whole fix in one D-Bus message to the clients of the Fix
+ * interface. Emit PositionChanged and VelocityChanged as well for the
+ * clients of those interfaces: they do not receive this signal. */
+void gc_iface_fix_emit_position_and_velocity_changed (GcIfaceFix           *gc,
+						      GeocluePositionFields position_fields,
+						      GeoclueVelocityFields velocity_fields,
+						      int                   timestamp,
+						      double                latitude,
+						      double                longitude,
+						      double                altitude,
+						      double                speed,
+						      double                direction,
+						      double                climb,
+						      GeoclueAccuracy      *accuracy);
+
+G_END_DECLS
+
+#endif
@@ -33,27 +33,37 @@
 #include <geoclue/geoclue-accuracy.h>
 #include <geoclue/gc-iface-geocode.h>
 
-static gboolean 
-gc_iface_geocode_address_to_position (GcIfaceGeocode   *gc,
-				      GHashTable       *address,
-				      int              *fields,
-				      double           *latitude,
-				      double           *longitude,
-				      double           *altitude,
-				      GeoclueAccuracy **accuracy,
-				      GError          **error);
-
-static gboolean
-gc_iface_geocode_freeform_address_to_position (GcIfaceGeocode   *gc,
-                                               const char       *address,
-                                               int              *fields,
-                                               double           *latitude,
-                                               double           *longitude,
-                                               double           *altitude,
-                                               GeoclueAccuracy **accuracy,
-                                               GError          **error);
+static void 
+gc_iface_geocode_address_to_position (GcIfaceGeocode        *gc,
+				      GHashTable            *address,
+				      DBusGMethodInvocation *context);
+
+static void
+gc_iface_geocode_freeform_address_to_position (GcIfaceGeocode        *gc,
+                                               const char            *address,
+                                               DBusGMethodInvocation *context);
+
+static void
+gc_iface_geocode_addresses_to_positions (GcIfaceGeocode        *gc,
+                                         GPtrArray             *addresses,
+                                         DBusGMethodInvocation *context);
 #include "gc-iface-geocode-glue.h"
 
+/* One (fields, latitude, longitude, altitude, accuracy) result */
+#define GEOCODE_RESULT_TYPE (dbus_g_type_get_struct ("GValueArray", G_TYPE_INT, G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE, GEOCLUE_ACCURACY_TYPE, G_TYPE_INVALID))
+
+struct _GcIfaceGeocodeBatch {
+	GcIfaceGeocode *gc;
+	DBusGMethodInvocation *context;
+
+	GPtrArray *addresses;
+	GPtrArray *results;
+
+	guint next;
+	guint pending;
+	gboolean running;
+};
+
 static void
 gc_iface_geocode_base_init (gpointer klass)
 {
@@ -87,32 +97,266 @@ gc_iface_geocode_get_type (void)
 	return type;
 }
 
-static gboolean 
-gc_iface_geocode_address_to_position (GcIfaceGeocode   *gc,
-				      GHashTable       *address,
-				      int              *fields,
-				      double           *latitude,
-				      double           *longitude,
-				      double           *altitude,
-				      GeoclueAccuracy **accuracy,
-				      GError          **error)
+/* Complete a synchronous geocode call */
+static void
+gc_iface_geocode_return (DBusGMethodInvocation *context,
+                         gboolean               success,
+                         GeocluePositionFields  fields,
+                         double                 latitude,
+                         double                 longitude,
+                         double                 altitude,
+                         GeoclueAccuracy       *accuracy,
+                         GError                *error)
+{
+	if (!success) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+	
+	if (!accuracy) {
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+		                                 0.0, 0.0);
+	}
+	dbus_g_method_return (context, fields,
+	                      latitude, longitude, altitude, accuracy);
+	geoclue_accuracy_free (accuracy);
+}
+
+static void 
+gc_iface_geocode_address_to_position (GcIfaceGeocode        *gc,
+				      GHashTable            *address,
+				      DBusGMethodInvocation *context)
+{
+	GcIfaceGeocodeClass *klass = GC_IFACE_GEOCODE_GET_CLASS (gc);
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double latitude = 0.0, longitude = 0.0, altitude = 0.0;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+	gboolean success;
+	
+	if (klass->address_to_position_async) {
+		klass->address_to_position_async (gc, address, context);
+		return;
+	}
+	
+	success = klass->address_to_position (gc, address, &fields,
+	                                      &latitude, &longitude, &altitude,
+	                                      &accuracy, &error);
+	gc_iface_geocode_return (context, success, fields,
+	                         latitude, longitude, altitude,
+	                         accuracy, error);
+}
+
+static void
+gc_iface_geocode_freeform_address_to_position (GcIfaceGeocode        *gc,
+                                               const char            *address,
+                                               DBusGMethodInvocation *context)
+{
+	GcIfaceGeocodeClass *klass = GC_IFACE_GEOCODE_GET_CLASS (gc);
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double latitude = 0.0, longitude = 0.0, altitude = 0.0;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+	gboolean success;
+	
+	if (klass->freeform_address_to_position_async) {
+		klass->freeform_address_to_position_async (gc, address, context);
+		return;
+	}
+	
+	success = klass->freeform_address_to_position (gc, address, &fields,
+	                                               &latitude, &longitude,
+	                                               &altitude, &accuracy,
+	                                               &error);
+	gc_iface_geocode_return (context, success, fields,
+	                         latitude, longitude, altitude,
+	                         accuracy, error);
+}
+
+static GValueArray *
+geocode_result_new (GeocluePositionFields  fields,
+                    double                 latitude,
+                    double                 longitude,
+                    double                 altitude,
+                    GeoclueAccuracy       *accuracy)
+{
+	GValue result_struct = {0, };
+	GeoclueAccuracy *none = NULL;
+
+	if (!accuracy) {
+		none = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+		                             0.0, 0.0);
+		accuracy = none;
+	}
+
+	g_value_init (&result_struct, GEOCODE_RESULT_TYPE);
+	g_value_take_boxed (&result_struct,
+	                    dbus_g_type_specialized_construct
+	                    (GEOCODE_RESULT_TYPE));
+
+	/* accuracy is copied */
+	dbus_g_type_struct_set (&result_struct,
+	                        0, fields,
+	                        1, latitude,
+	                        2, longitude,
+	                        3, altitude,
+	                        4, accuracy,
+	                        G_MAXUINT);
+
+	geoclue_accuracy_free (none);
+	return (GValueArray *) g_value_get_boxed (&result_struct);
+}
+
+static void
+geocode_results_free (GPtrArray *results)
+{
+	guint i;
+
+	for (i = 0; i < results->len; i++) {
+		if (results->pdata[i]) {
+			g_boxed_free (GEOCODE_RESULT_TYPE, results->pdata[i]);
+		}
+	}
+	g_ptr_array_free (results, TRUE);
+}
+
+static void
+gc_iface_geocode_batch_free (GcIfaceGeocodeBatch *batch)
+{
+	guint i;
+
+	for (i = 0; i < batch->addresses->len; i++) {
+		g_hash_table_unref (batch->addresses->pdata[i]);
+	}
+	g_ptr_array_free (batch->addresses, TRUE);
+	geocode_results_free (batch->results);
+	g_object_unref (batch->gc);
+	g_free (batch);
+}
+
+/* Starts geocoding addresses until GC_IFACE_GEOCODE_BATCH_MAX_PENDING
+ * are in progress, and replies once all have returned. The implementation
+ * may call gc_iface_geocode_batch_return() from within 
+ * batch_address_to_position(): 'running' makes sure this loop is the only
+ * place that starts new addresses or frees the batch */
+static void
+gc_iface_geocode_batch_run (GcIfaceGeocodeBatch *batch)
+{
+	GcIfaceGeocodeClass *klass = GC_IFACE_GEOCODE_GET_CLASS (batch->gc);
+	guint index;
+
+	batch->running = TRUE;
+	while (batch->pending < GC_IFACE_GEOCODE_BATCH_MAX_PENDING &&
+	       batch->next < batch->addresses->len) {
+		index = batch->next++;
+		batch->pending++;
+		klass->batch_address_to_position (batch->gc,
+		                                  batch->addresses->pdata[index],
+		                                  batch, index);
+	}
+	batch->running = FALSE;
+
+	if (batch->pending == 0 && batch->next == batch->addresses->len) {
+		dbus_g_method_return (batch->context, batch->results);
+		gc_iface_geocode_batch_free (batch);
+	}
+}
+
+/**
+ * gc_iface_geocode_batch_return:
+ * @batch: The #GcIfaceGeocodeBatch given to batch_address_to_position()
+ * @index: The index given to batch_address_to_position()
+ * @fields: A #GeocluePositionFields bitfield, %GEOCLUE_POSITION_FIELDS_NONE if the address could not be geocoded
+ * @latitude: Latitude in degrees
+ * @longitude: Longitude in degrees
+ * @altitude: Altitude in meters
+ * @accuracy: A #GeoclueAccuracy or %NULL. It is copied
+ *
+ * Sets the result for one address of an AddressesToPositions batch. 
+ * The D-Bus reply is sent once every address has a result.
+ */
+void
+gc_iface_geocode_batch_return (GcIfaceGeocodeBatch   *batch,
+                               guint                  index,
+                               GeocluePositionFields  fields,
+                               double                 latitude,
+                               double                 longitude,
+                               double                 altitude,
+                               GeoclueAccuracy       *accuracy)
 {
-	return GC_IFACE_GEOCODE_GET_CLASS (gc)->address_to_position 
-		(gc, address, (GeocluePositionFields *) fields,
-		 latitude, longitude, altitude, accuracy, error);
+	g_return_if_fail (batch != NULL);
+	g_return_if_fail (index < batch->next);
+	g_return_if_fail (batch->results->pdata[index] == NULL);
+
+	batch->results->pdata[index] = geocode_result_new (fields,
+	                                                   latitude,
+	                                                   longitude,
+	                                                   altitude,
+	                                                   accuracy);
+	batch->pending--;
+
+	if (!batch->running) {
+		gc_iface_geocode_batch_run (batch);
+	}
 }
 
-static gboolean
-gc_iface_geocode_freeform_address_to_position (GcIfaceGeocode   *gc,
-                                               const char       *address,
-                                               int              *fields,
-                                               double           *latitude,
-                                               double           *longitude,
-                                               double           *altitude,
-                                               GeoclueAccuracy **accuracy,
-                                               GError          **error)
+static void
+gc_iface_geocode_addresses_to_positions (GcIfaceGeocode        *gc,
+                                         GPtrArray             *addresses,
+                                         DBusGMethodInvocation *context)
 {
-	return GC_IFACE_GEOCODE_GET_CLASS (gc)->freeform_address_to_position
-		(gc, address, (GeocluePositionFields *) fields,
-		 latitude, longitude, altitude, accuracy, error);
+	GcIfaceGeocodeClass *klass = GC_IFACE_GEOCODE_GET_CLASS (gc);
+	GcIfaceGeocodeBatch *batch;
+	GPtrArray *results;
+	guint i;
+
+	if (klass->batch_address_to_position) {
+		/* dbus-glib frees the arguments when this returns */
+		batch = g_new0 (GcIfaceGeocodeBatch, 1);
+		batch->gc = g_object_ref (gc);
+		batch->context = context;
+		batch->addresses = g_ptr_array_sized_new (addresses->len);
+		batch->results = g_ptr_array_sized_new (addresses->len);
+		for (i = 0; i < addresses->len; i++) {
+			g_ptr_array_add (batch->addresses,
+			                 g_hash_table_ref (addresses->pdata[i]));
+			g_ptr_array_add (batch->results, NULL);
+		}
+
+		gc_iface_geocode_batch_run (batch);
+		return;
+	}
+
+	if (!klass->address_to_position) {
+		GError *error = g_error_new (GEOCLUE_ERROR,
+		                             GEOCLUE_ERROR_NOT_IMPLEMENTED,
+		                             "Batch geocoding is not supported");
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+
+	results = g_ptr_array_sized_new (addresses->len);
+	for (i = 0; i < addresses->len; i++) {
+		GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+		double latitude = 0.0, longitude = 0.0, altitude = 0.0;
+		GeoclueAccuracy *accuracy = NULL;
+		GError *error = NULL;
+
+		if (!klass->address_to_position (gc, addresses->pdata[i],
+		                                 &fields, &latitude,
+		                                 &longitude, &altitude,
+		                                 &accuracy, &error)) {
+			fields = GEOCLUE_POSITION_FIELDS_NONE;
+			g_clear_error (&error);
+		}
+		g_ptr_array_add (results,
+		                 geocode_result_new (fields, latitude, longitude,
+		                                     altitude, accuracy));
+		geoclue_accuracy_free (accuracy);
+	}
+
+	dbus_g_method_return (context, results);
+	geocode_results_free (results);
 }
@@ -39,6 +39,11 @@ G_BEGIN_DECLS
 
 typedef struct _GcIfaceGeocode GcIfaceGeocode; /* Dummy typedef */
 typedef struct _GcIfaceGeocodeClass GcIfaceGeocodeClass;
+typedef struct _GcIfaceGeocodeBatch GcIfaceGeocodeBatch;
+
+/* Number of batch_address_to_position() calls that may be in progress
+ * at once for a single AddressesToPositions call */
+#define GC_IFACE_GEOCODE_BATCH_MAX_PENDING 4
 
 struct _GcIfaceGeocodeClass {
 	GTypeInterface base_iface;
@@ -61,10 +66,39 @@ struct _GcIfaceGeocodeClass {
 	                                          double                *altitude,
 	                                          GeoclueAccuracy      **accuracy,
 	                                          GError               **error);
+
+	/* Optional non-blocking versions of the methods above. If set,
+	 * they are used instead and the implementation must complete 
+	 * @context with dbus_g_method_return() or 
+	 * dbus_g_method_return_error() */
+	void (*address_to_position_async) (GcIfaceGeocode        *gc,
+	                                   GHashTable            *address,
+	                                   DBusGMethodInvocation *context);
+
+	void (*freeform_address_to_position_async) (GcIfaceGeocode        *gc,
+	                                            const char            *address,
+	                                            DBusGMethodInvocation *context);
+
+	/* Optional: geocodes one address of an AddressesToPositions batch.
+	 * The implementation must eventually call 
+	 * gc_iface_geocode_batch_return() with @batch and @index. If not 
+	 * set, address_to_position() is called for each address in turn */
+	void (*batch_address_to_position) (GcIfaceGeocode      *gc,
+	                                   GHashTable          *address,
+	                                   GcIfaceGeocodeBatch *batch,
+	                                   guint                index);
 };
 
 GType gc_iface_geocode_get_type (void);
 
+void gc_iface_geocode_batch_return (GcIfaceGeocodeBatch   *batch,
+                                    guint                  index,
+                                    GeocluePositionFields  fields,
+                                    double                 latitude,
+                                    double                 longitude,
+                                    double                 altitude,
+                                    GeoclueAccuracy       *accuracy);
+
 G_END_DECLS
 
 #endif
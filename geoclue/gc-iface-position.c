@@ -36,15 +36,9 @@ enum {
 
 static guint signals[LAST_SIGNAL] = {0};
 
-static gboolean 
+static void 
 gc_iface_position_get_position (GcIfacePosition       *position,
-				int                   *fields,
-				int                   *timestamp,
-				double                *latitude,
-				double                *longitude,
-				double                *altitude,
-				GeoclueAccuracy      **accuracy,
-				GError               **error);
+				DBusGMethodInvocation *context);
 
 #include "gc-iface-position-glue.h"
 
@@ -94,19 +88,37 @@ gc_iface_position_get_type (void)
 	return type;
 }
 
-static gboolean 
-gc_iface_position_get_position (GcIfacePosition  *gc,
-				int              *fields,
-				int              *timestamp,
-				double           *latitude,
-				double           *longitude,
-				double           *altitude,
-				GeoclueAccuracy **accuracy,
-				GError          **error)
+static void 
+gc_iface_position_get_position (GcIfacePosition       *gc,
+				DBusGMethodInvocation *context)
 {
-	return GC_IFACE_POSITION_GET_CLASS (gc)->get_position 
-		(gc, (GeocluePositionFields *) fields, timestamp,
-		 latitude, longitude, altitude, accuracy, error);
+	GcIfacePositionClass *klass = GC_IFACE_POSITION_GET_CLASS (gc);
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	int timestamp = 0;
+	double latitude = 0.0, longitude = 0.0, altitude = 0.0;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+	
+	if (klass->get_position_async) {
+		klass->get_position_async (gc, context);
+		return;
+	}
+	
+	if (!klass->get_position (gc, &fields, &timestamp,
+				  &latitude, &longitude, &altitude,
+				  &accuracy, &error)) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+	
+	if (!accuracy) {
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+						 0.0, 0.0);
+	}
+	dbus_g_method_return (context, fields, timestamp,
+			      latitude, longitude, altitude, accuracy);
+	geoclue_accuracy_free (accuracy);
 }
 
 void
@@ -61,6 +61,13 @@ struct _GcIfacePositionClass {
 				   double                *altitude,
 				   GeoclueAccuracy      **accuracy,
 				   GError               **error);
+
+	/* Optional non-blocking version of get_position. If set, it is
+	 * used instead of get_position and the implementation must 
+	 * complete @context with dbus_g_method_return() or 
+	 * dbus_g_method_return_error() */
+	void (* get_position_async) (GcIfacePosition       *gc,
+				     DBusGMethodInvocation *context);
 };
 
 GType gc_iface_position_get_type (void);
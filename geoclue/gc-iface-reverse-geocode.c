@@ -22,23 +22,58 @@
  *
  */
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <dbus/dbus-glib.h>
 
 #include <geoclue/geoclue-accuracy.h>
+#include <geoclue/geoclue-address-details.h>
 #include <geoclue/gc-iface-reverse-geocode.h>
 
-static gboolean 
+static void 
 gc_iface_reverse_geocode_position_to_address (GcIfaceReverseGeocode  *gc,
 					      double                  latitude,
 					      double                  longitude,
 					      GeoclueAccuracy        *position_accuracy,
-					      GHashTable            **address,
-					      GeoclueAccuracy       **address_accuracy,
-					      GError                **error);
+					      DBusGMethodInvocation  *context);
+
+static void
+gc_iface_reverse_geocode_positions_to_addresses (GcIfaceReverseGeocode  *gc,
+						 GPtrArray              *positions,
+						 GeoclueAccuracy        *position_accuracy,
+						 DBusGMethodInvocation  *context);
 #include "gc-iface-reverse-geocode-glue.h"
 
+/* One (address, address_accuracy) result */
+#define ADDRESS_RESULT_TYPE (dbus_g_type_get_struct ("GValueArray", DBUS_TYPE_G_STRING_STRING_HASHTABLE, GEOCLUE_ACCURACY_TYPE, G_TYPE_INVALID))
+
+/* A position. In the deduplication table it is the centre of a grid
+ * cell, in the batch the first input position that fell into the cell:
+ * all positions in the cell share the address of that one */
+typedef struct _GcReverseGeocodeCell {
+	double latitude;
+	double longitude;
+} GcReverseGeocodeCell;
+
+struct _GcIfaceReverseGeocodeBatch {
+	GcIfaceReverseGeocode *gc;
+	DBusGMethodInvocation *context;
+	GeoclueAccuracy *position_accuracy;
+
+	GArray *cells;
+	GPtrArray *cell_results;
+
+	/* index into cells for each input position */
+	guint *position_cells;
+	guint n_positions;
+
+	guint next;
+	guint pending;
+	gboolean running;
+};
+
 static void
 gc_iface_reverse_geocode_base_init (gpointer klass)
 {
@@ -72,16 +107,334 @@ gc_iface_reverse_geocode_get_type (void)
 	return type;
 }
 
-static gboolean 
+static void 
 gc_iface_reverse_geocode_position_to_address (GcIfaceReverseGeocode  *gc,
 					      double                  latitude,
 					      double                  longitude,
 					      GeoclueAccuracy        *position_accuracy,
-					      GHashTable            **address,
-					      GeoclueAccuracy       **address_accuracy,
-					      GError                **error)
+					      DBusGMethodInvocation  *context)
+{
+	GcIfaceReverseGeocodeClass *klass = GC_IFACE_REVERSE_GEOCODE_GET_CLASS (gc);
+	GHashTable *address = NULL;
+	GeoclueAccuracy *address_accuracy = NULL;
+	GError *error = NULL;
+	
+	if (klass->position_to_address_async) {
+		klass->position_to_address_async (gc, latitude, longitude,
+						  position_accuracy, context);
+		return;
+	}
+	
+	if (!klass->position_to_address (gc, latitude, longitude, 
+					 position_accuracy, &address,
+					 &address_accuracy, &error)) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+	
+	if (!address) {
+		address = geoclue_address_details_new ();
+	}
+	if (!address_accuracy) {
+		address_accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+							 0.0, 0.0);
+	}
+	dbus_g_method_return (context, address, address_accuracy);
+	g_hash_table_destroy (address);
+	geoclue_accuracy_free (address_accuracy);
+}
+
+/* Grid cell size in degrees for the position accuracy level: positions
+ * that are indistinguishable at that level are only looked up once.
+ * 0 means only identical positions are merged */
+static double
+get_cell_size (GeoclueAccuracyLevel level)
 {
-	return GC_IFACE_REVERSE_GEOCODE_GET_CLASS (gc)->position_to_address 
-		(gc, latitude, longitude, position_accuracy, 
-		 address, address_accuracy, error);
+	switch (level) {
+	case GEOCLUE_ACCURACY_LEVEL_DETAILED:
+		return 0.0;
+	case GEOCLUE_ACCURACY_LEVEL_STREET:
+		return 0.0005;	/* ~50 m */
+	case GEOCLUE_ACCURACY_LEVEL_POSTALCODE:
+		return 0.005;	/* ~500 m */
+	case GEOCLUE_ACCURACY_LEVEL_LOCALITY:
+		return 0.02;	/* ~2 km */
+	case GEOCLUE_ACCURACY_LEVEL_REGION:
+		return 0.2;
+	default:
+		return 1.0;
+	}
+}
+
+/* Centre of the grid cell containing value */
+static double
+snap_to_cell (double value, double cell_size)
+{
+	gint64 n = (gint64) (value / cell_size);
+
+	/* the cast rounds towards zero */
+	if (n * cell_size > value) {
+		n--;
+	}
+	return (n + 0.5) * cell_size;
+}
+
+static guint
+cell_hash (gconstpointer key)
+{
+	const GcReverseGeocodeCell *cell = key;
+	guint64 lat_bits, lon_bits;
+
+	memcpy (&lat_bits, &cell->latitude, sizeof (lat_bits));
+	memcpy (&lon_bits, &cell->longitude, sizeof (lon_bits));
+	return (guint) (lat_bits ^ (lat_bits >> 32)) * 31 + 
+	       (guint) (lon_bits ^ (lon_bits >> 32));
+}
+
+static gboolean
+cell_equal (gconstpointer a, gconstpointer b)
+{
+	const GcReverseGeocodeCell *cell_a = a;
+	const GcReverseGeocodeCell *cell_b = b;
+
+	return cell_a->latitude == cell_b->latitude &&
+	       cell_a->longitude == cell_b->longitude;
+}
+
+static GValueArray *
+address_result_new (GHashTable      *address,
+		    GeoclueAccuracy *address_accuracy)
+{
+	GValue result_struct = {0, };
+	GHashTable *empty = NULL;
+	GeoclueAccuracy *none = NULL;
+
+	if (!address) {
+		empty = geoclue_address_details_new ();
+		address = empty;
+	}
+	if (!address_accuracy) {
+		none = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+					     0.0, 0.0);
+		address_accuracy = none;
+	}
+
+	g_value_init (&result_struct, ADDRESS_RESULT_TYPE);
+	g_value_take_boxed (&result_struct,
+			    dbus_g_type_specialized_construct
+			    (ADDRESS_RESULT_TYPE));
+
+	/* address and accuracy are copied */
+	dbus_g_type_struct_set (&result_struct,
+				0, address,
+				1, address_accuracy,
+				G_MAXUINT);
+
+	if (empty) {
+		g_hash_table_destroy (empty);
+	}
+	geoclue_accuracy_free (none);
+	return (GValueArray *) g_value_get_boxed (&result_struct);
+}
+
+static void
+gc_iface_reverse_geocode_batch_free (GcIfaceReverseGeocodeBatch *batch)
+{
+	guint i;
+
+	for (i = 0; i < batch->cell_results->len; i++) {
+		if (batch->cell_results->pdata[i]) {
+			g_boxed_free (ADDRESS_RESULT_TYPE,
+				      batch->cell_results->pdata[i]);
+		}
+	}
+	g_ptr_array_free (batch->cell_results, TRUE);
+	g_array_free (batch->cells, TRUE);
+	g_free (batch->position_cells);
+	geoclue_accuracy_free (batch->position_accuracy);
+	g_object_unref (batch->gc);
+	g_free (batch);
+}
+
+/* Every position gets the result of its cell. The results are not
+ * copied: the reply array points to the same cell result many times */
+static void
+gc_iface_reverse_geocode_batch_reply (GcIfaceReverseGeocodeBatch *batch)
+{
+	GPtrArray *results;
+	guint i;
+
+	results = g_ptr_array_sized_new (batch->n_positions);
+	for (i = 0; i < batch->n_positions; i++) {
+		g_ptr_array_add (results,
+				 batch->cell_results->pdata[batch->position_cells[i]]);
+	}
+	dbus_g_method_return (batch->context, results);
+	g_ptr_array_free (results, TRUE);
+}
+
+/* Starts looking up cells until GC_IFACE_REVERSE_GEOCODE_BATCH_MAX_PENDING
+ * are in progress, and replies once all have returned. 'running' makes
+ * sure this loop is the only place that starts new cells or frees the
+ * batch, even if results are returned synchronously */
+static void
+gc_iface_reverse_geocode_batch_run (GcIfaceReverseGeocodeBatch *batch)
+{
+	GcIfaceReverseGeocodeClass *klass = GC_IFACE_REVERSE_GEOCODE_GET_CLASS (batch->gc);
+	GcReverseGeocodeCell *cell;
+	guint index;
+
+	batch->running = TRUE;
+	while (batch->pending < GC_IFACE_REVERSE_GEOCODE_BATCH_MAX_PENDING &&
+	       batch->next < batch->cells->len) {
+		index = batch->next++;
+		batch->pending++;
+		cell = &g_array_index (batch->cells, GcReverseGeocodeCell, index);
+
+		if (klass->batch_position_to_address) {
+			klass->batch_position_to_address (batch->gc,
+							  cell->latitude,
+							  cell->longitude,
+							  batch->position_accuracy,
+							  batch, index);
+		} else {
+			GHashTable *address = NULL;
+			GeoclueAccuracy *address_accuracy = NULL;
+			GError *error = NULL;
+
+			if (!klass->position_to_address (batch->gc,
+							 cell->latitude,
+							 cell->longitude,
+							 batch->position_accuracy,
+							 &address,
+							 &address_accuracy,
+							 &error)) {
+				g_clear_error (&error);
+			}
+			gc_iface_reverse_geocode_batch_return (batch, index,
+							       address,
+							       address_accuracy);
+			if (address) {
+				g_hash_table_destroy (address);
+			}
+			geoclue_accuracy_free (address_accuracy);
+		}
+	}
+	batch->running = FALSE;
+
+	if (batch->pending == 0 && batch->next == batch->cells->len) {
+		gc_iface_reverse_geocode_batch_reply (batch);
+		gc_iface_reverse_geocode_batch_free (batch);
+	}
+}
+
+/**
+ * gc_iface_reverse_geocode_batch_return:
+ * @batch: The #GcIfaceReverseGeocodeBatch given to batch_position_to_address()
+ * @index: The index given to batch_position_to_address()
+ * @address: Address details or %NULL if the position could not be reverse geocoded. It is copied
+ * @address_accuracy: Accuracy of @address or %NULL. It is copied
+ *
+ * Sets the result for one grid cell of a PositionsToAddresses batch. 
+ * The D-Bus reply is sent once every cell has a result.
+ */
+void
+gc_iface_reverse_geocode_batch_return (GcIfaceReverseGeocodeBatch *batch,
+				       guint                       index,
+				       GHashTable                 *address,
+				       GeoclueAccuracy            *address_accuracy)
+{
+	g_return_if_fail (batch != NULL);
+	g_return_if_fail (index < batch->next);
+	g_return_if_fail (batch->cell_results->pdata[index] == NULL);
+
+	batch->cell_results->pdata[index] = address_result_new (address,
+								address_accuracy);
+	batch->pending--;
+
+	if (!batch->running) {
+		gc_iface_reverse_geocode_batch_run (batch);
+	}
+}
+
+static void
+gc_iface_reverse_geocode_positions_to_addresses (GcIfaceReverseGeocode  *gc,
+						 GPtrArray              *positions,
+						 GeoclueAccuracy        *position_accuracy,
+						 DBusGMethodInvocation  *context)
+{
+	GcIfaceReverseGeocodeClass *klass = GC_IFACE_REVERSE_GEOCODE_GET_CLASS (gc);
+	GcIfaceReverseGeocodeBatch *batch;
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_DETAILED;
+	GHashTable *cell_indices;
+	double cell_size;
+	guint i;
+
+	if (!klass->batch_position_to_address && !klass->position_to_address) {
+		GError *error = g_error_new (GEOCLUE_ERROR,
+		                             GEOCLUE_ERROR_NOT_IMPLEMENTED,
+		                             "Batch reverse geocoding is not supported");
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+
+	if (position_accuracy) {
+		geoclue_accuracy_get_details (position_accuracy, &level, NULL, NULL);
+	}
+	cell_size = get_cell_size (level);
+
+	/* dbus-glib frees the arguments when this returns */
+	batch = g_new0 (GcIfaceReverseGeocodeBatch, 1);
+	batch->gc = g_object_ref (gc);
+	batch->context = context;
+	if (position_accuracy) {
+		batch->position_accuracy = geoclue_accuracy_copy (position_accuracy);
+	} else {
+		batch->position_accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
+	}
+	batch->cells = g_array_new (FALSE, FALSE, sizeof (GcReverseGeocodeCell));
+	batch->n_positions = positions->len;
+	batch->position_cells = g_new (guint, positions->len);
+
+	/* Snap positions to the grid and collect the distinct cells.
+	 * cell_indices maps a cell to its index in batch->cells plus one.
+	 * The grid is only used as the key: a cell is looked up at its
+	 * first input position, as the centre of a large cell may be far
+	 * from every input position (or in the sea) */
+	cell_indices = g_hash_table_new_full (cell_hash, cell_equal, 
+					      g_free, NULL);
+	for (i = 0; i < positions->len; i++) {
+		GValueArray *vals = positions->pdata[i];
+		GcReverseGeocodeCell position, cell;
+		gpointer found;
+
+		position.latitude = g_value_get_double (g_value_array_get_nth (vals, 0));
+		position.longitude = g_value_get_double (g_value_array_get_nth (vals, 1));
+		cell = position;
+		if (cell_size > 0.0) {
+			cell.latitude = snap_to_cell (cell.latitude, cell_size);
+			cell.longitude = snap_to_cell (cell.longitude, cell_size);
+		}
+
+		found = g_hash_table_lookup (cell_indices, &cell);
+		if (found) {
+			batch->position_cells[i] = GPOINTER_TO_UINT (found) - 1;
+		} else {
+			g_array_append_val (batch->cells, position);
+			batch->position_cells[i] = batch->cells->len - 1;
+			g_hash_table_insert (cell_indices,
+					     g_memdup (&cell, sizeof (cell)),
+					     GUINT_TO_POINTER (batch->cells->len));
+		}
+	}
+	g_hash_table_destroy (cell_indices);
+
+	batch->cell_results = g_ptr_array_sized_new (batch->cells->len);
+	for (i = 0; i < batch->cells->len; i++) {
+		g_ptr_array_add (batch->cell_results, NULL);
+	}
+
+	gc_iface_reverse_geocode_batch_run (batch);
 }
@@ -39,6 +39,11 @@ G_BEGIN_DECLS
 
 typedef struct _GcIfaceReverseGeocode GcIfaceReverseGeocode; /* Dummy typedef */
 typedef struct _GcIfaceReverseGeocodeClass GcIfaceReverseGeocodeClass;
+typedef struct _GcIfaceReverseGeocodeBatch GcIfaceReverseGeocodeBatch;
+
+/* Number of batch_position_to_address() calls that may be in progress
+ * at once for a single PositionsToAddresses call */
+#define GC_IFACE_REVERSE_GEOCODE_BATCH_MAX_PENDING 4
 
 struct _GcIfaceReverseGeocodeClass {
 	GTypeInterface base_iface;
@@ -51,10 +56,37 @@ struct _GcIfaceReverseGeocodeClass {
 					 GHashTable            **address,
 					 GeoclueAccuracy       **address_accuracy,
 					 GError                **error);
+
+	/* Optional non-blocking version of position_to_address. If set,
+	 * it is used instead and the implementation must complete 
+	 * @context with dbus_g_method_return() or 
+	 * dbus_g_method_return_error() */
+	void (*position_to_address_async) (GcIfaceReverseGeocode  *gc,
+					   double                  latitude,
+					   double                  longitude,
+					   GeoclueAccuracy        *position_accuracy,
+					   DBusGMethodInvocation  *context);
+
+	/* Optional: reverse geocodes one grid cell of a PositionsToAddresses
+	 * batch, given as the first input position in the cell. The
+	 * implementation must eventually call
+	 * gc_iface_reverse_geocode_batch_return() with @batch and @index.
+	 * If not set, position_to_address() is called for each cell in turn */
+	void (*batch_position_to_address) (GcIfaceReverseGeocode      *gc,
+					   double                      latitude,
+					   double                      longitude,
+					   GeoclueAccuracy            *position_accuracy,
+					   GcIfaceReverseGeocodeBatch *batch,
+					   guint                       index);
 };
 
 GType gc_iface_reverse_geocode_get_type (void);
 
+void gc_iface_reverse_geocode_batch_return (GcIfaceReverseGeocodeBatch *batch,
+					    guint                       index,
+					    GHashTable                 *address,
+					    GeoclueAccuracy            *address_accuracy);
+
 G_END_DECLS
 
 #endif
@@ -35,14 +35,9 @@ enum {
 
 static guint signals[LAST_SIGNAL] = {0};
 
-static gboolean 
-gc_iface_velocity_get_velocity (GcIfaceVelocity       *velocity,
-				int                   *fields,
-				int                   *timestamp,
-				double                *latitude,
-				double                *longitude,
-				double                *altitude,
-				GError               **error);
+static void 
+gc_iface_velocity_get_velocity (GcIfaceVelocity       *gc,
+				DBusGMethodInvocation *context);
 
 #include "gc-iface-velocity-glue.h"
 
@@ -90,18 +85,31 @@ gc_iface_velocity_get_type (void)
 	return type;
 }
 
-static gboolean 
-gc_iface_velocity_get_velocity (GcIfaceVelocity *gc,
-				int             *fields,
-				int             *timestamp,
-				double          *speed,
-				double          *direction,
-				double          *climb,
-				GError         **error)
+static void 
+gc_iface_velocity_get_velocity (GcIfaceVelocity       *gc,
+				DBusGMethodInvocation *context)
 {
-	return GC_IFACE_VELOCITY_GET_CLASS (gc)->get_velocity 
-		(gc, (GeoclueVelocityFields *) fields, timestamp,
-		 speed, direction, climb, error);
+	GcIfaceVelocityClass *klass = GC_IFACE_VELOCITY_GET_CLASS (gc);
+	GeoclueVelocityFields fields = GEOCLUE_VELOCITY_FIELDS_NONE;
+	int timestamp = 0;
+	double speed = 0.0, direction = 0.0, climb = 0.0;
+	GError *error = NULL;
+	
+	if (klass->get_velocity_async) {
+		klass->get_velocity_async (gc, context);
+		return;
+	}
+	
+	if (!klass->get_velocity (gc, &fields, &timestamp,
+				  &speed, &direction, &climb,
+				  &error)) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+	
+	dbus_g_method_return (context, fields, timestamp,
+			      speed, direction, climb);
 }
 
 void
@@ -25,6 +25,7 @@
 #ifndef _GC_IFACE_VELOCITY_H
 #define _GC_IFACE_VELOCITY_H
 
+#include <dbus/dbus-glib.h>
 #include <geoclue/geoclue-types.h>
 
 G_BEGIN_DECLS
@@ -58,6 +59,11 @@ struct _GcIfaceVelocityClass {
 				   double                *direction,
 				   double                *climb,
 				   GError               **error);
+
+	/* Optional non-blocking version of get_velocity, see 
+	 * GcIfacePositionClass::get_position_async */
+	void (* get_velocity_async) (GcIfaceVelocity       *gc,
+				     DBusGMethodInvocation *context);
 };
 
 GType gc_iface_velocity_get_type (void);
@@ -76,16 +76,29 @@
  * g_object_unref (G_OBJECT (web_service));
  * </programlisting>
  * </informalexample>
+ * 
+ * gc_web_service_query() blocks until the whole document has been 
+ * fetched. Providers that should keep serving D-Bus requests in the 
+ * meantime can use gc_web_service_query_async() and read the data in 
+ * the callback after gc_web_service_query_finish().
+ *
+ * HTTP connections are kept open and reused between queries to the
+ * same host. The pool is shared by all #GcWebService objects in the 
+ * process, its limits can be changed with 
+ * gc_web_service_set_connection_limits().
  */
 
 #include <stdarg.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
-#include <libxml/nanohttp.h>
 #include <libxml/xpathInternals.h>
 #include <libxml/uri.h>      /* for xmlURIEscapeStr */
 
 #include "gc-web-service.h"
+#include "gc-http-pool.h"
+#include "gc-disk-cache.h"
+#include "gc-xml-stream.h"
 #include "geoclue-error.h"
 
 G_DEFINE_TYPE (GcWebService, gc_web_service, G_TYPE_OBJECT)
@@ -126,6 +139,39 @@ gc_web_service_register_namespaces (GcWebService *self)
 	g_list_foreach (self->namespaces, (GFunc)gc_web_service_register_ns, self);
 }
 
+/* Prefix -> uri table of self->namespaces for GcXmlStream */
+static GHashTable *
+gc_web_service_get_namespace_table (GcWebService *self)
+{
+	GHashTable *table;
+	GList *l;
+	
+	table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	/* most recently added first */
+	for (l = self->namespaces; l; l = l->next) {
+		XmlNamespace *ns = (XmlNamespace *)l->data;
+		
+		if (!g_hash_table_lookup (table, ns->name)) {
+			g_hash_table_insert (table, g_strdup (ns->name), g_strdup (ns->uri));
+		}
+	}
+	return table;
+}
+
+static void
+gc_web_service_free_values (gchar **values, guint n_values)
+{
+	guint i;
+	
+	if (!values) {
+		return;
+	}
+	for (i = 0; i < n_values; i++) {
+		g_free (values[i]);
+	}
+	g_free (values);
+}
+
 static void
 gc_web_service_reset (GcWebService *self)
 {
@@ -133,6 +179,10 @@ gc_web_service_reset (GcWebService *self)
 	self->response = NULL;
 	self->response_length = 0;
 	
+	gc_web_service_free_values (self->stream_values, self->n_stream_values);
+	self->stream_values = NULL;
+	self->n_stream_values = 0;
+	
 	if (self->xpath_ctx) {
 		if (self->xpath_ctx->doc) {
 			xmlFreeDoc (self->xpath_ctx->doc);
@@ -174,64 +224,706 @@ gc_web_service_build_xpath_context (GcWebService *self)
 	return TRUE;
 }
 
-/* fetch data from url, save into self->response */
+/* fetch data from url into a newly allocated buffer. Does not touch
+ * any GcWebService state so it can be run from a worker thread. */
 static gboolean
-gc_web_service_fetch (GcWebService *self, gchar *url, GError **error)
+gc_web_service_fetch_url (const gchar  *url,
+                          guchar      **response,
+                          gint         *response_length,
+                          glong        *max_age,
+                          GCancellable *cancellable,
+                          GError      **error)
 {
-	void* ctxt = NULL;
-	gint len;
-	xmlChar buf[1024];
-	xmlBuffer *output;
+	GcHttpResponse http_response;
 	
 	g_assert (url);
 	
-	gc_web_service_reset (self);
-	
-	xmlNanoHTTPInit();
-	ctxt = xmlNanoHTTPMethod (url, "GET", NULL, NULL, NULL, 0);
-	if (!ctxt) {
-		g_set_error (error, GEOCLUE_ERROR,
-		             GEOCLUE_ERROR_NOT_AVAILABLE,
-		             "xmlNanoHTTPMethod did not get a response from %s\n", url);
+	if (!gc_http_pool_get (url, &http_response, NULL, NULL,
+	                       cancellable, error)) {
 		return FALSE;
 	}
 	
-	output = xmlBufferCreate ();
-	while ((len = xmlNanoHTTPRead (ctxt, buf, sizeof(buf))) > 0) {
-		if (xmlBufferAdd (output, buf, len) != 0) {
-			xmlNanoHTTPClose(ctxt);
-			xmlBufferFree (output);
-			
-			g_set_error_literal (error, GEOCLUE_ERROR,
-			                     GEOCLUE_ERROR_FAILED,
-			                     "libxml error (xmlBufferAdd failed)");
-			
-			return FALSE;
+	/* only successful responses are cached */
+	if (http_response.status == 200) {
+		*max_age = gc_http_response_get_max_age (&http_response);
+	} else {
+		*max_age = 0;
+	}
+	*response_length = http_response.length;
+	*response = http_response.body;
+	http_response.body = NULL;
+	gc_http_response_clear (&http_response);
+	
+	return TRUE;
+}
+
+typedef struct _GcWebServiceStream {
+	GcXmlStream *parser;
+	GByteArray *copy;     /* raw response for the caches, or NULL */
+	gboolean invalid;     /* response is not a parseable document */
+} GcWebServiceStream;
+
+/* GcHttpBodyFunc */
+static gboolean
+gc_web_service_stream_body (const guchar *data,
+                            gsize         length,
+                            gpointer      user_data,
+                            GError      **error)
+{
+	GcWebServiceStream *stream = user_data;
+	
+	if (stream->copy) {
+		g_byte_array_append (stream->copy, data, length);
+	}
+	/* like an unparseable document in the non-streaming case, an
+	 * error page just has no fields: keep reading the body so the
+	 * connection can be reused */
+	if (!stream->invalid &&
+	    !gc_xml_stream_push (stream->parser, (const gchar *)data, length,
+	                         FALSE, NULL)) {
+		stream->invalid = TRUE;
+	}
+	return TRUE;
+}
+
+/* fetch url and extract the fields while the response arrives. If
+ * response is not NULL the raw response is returned as well. Like 
+ * gc_web_service_fetch_url() this can be run from a worker thread. */
+static gboolean
+gc_web_service_fetch_fields (const gchar   *url,
+                             GcXmlPath    **paths,
+                             guint          n_paths,
+                             GHashTable    *namespaces,
+                             gchar       ***values,
+                             guchar       **response,
+                             gint          *response_length,
+                             glong         *max_age,
+                             GCancellable  *cancellable,
+                             GError       **error)
+{
+	GcWebServiceStream stream;
+	GcHttpResponse http_response;
+	gboolean ok;
+	
+	stream.parser = gc_xml_stream_new (paths, n_paths, namespaces);
+	stream.copy = response ? g_byte_array_new () : NULL;
+	stream.invalid = FALSE;
+	
+	ok = gc_http_pool_get (url, &http_response,
+	                       gc_web_service_stream_body, &stream,
+	                       cancellable, error);
+	if (ok) {
+		if (http_response.status == 200) {
+			*max_age = gc_http_response_get_max_age (&http_response);
+		} else {
+			/* other responses are not streamed (nor cached), and
+			 * have no fields */
+			*max_age = 0;
+			stream.invalid = TRUE;
 		}
+		gc_http_response_clear (&http_response);
 	}
-	xmlNanoHTTPClose(ctxt);
 	
-	self->response_length = xmlBufferLength (output);
-	self->response = g_memdup (xmlBufferContent (output), self->response_length);
-	xmlBufferFree (output);
+	if (ok) {
+		if (stream.invalid ||
+		    !gc_xml_stream_push (stream.parser, NULL, 0, TRUE, NULL)) {
+			*values = g_new0 (gchar *, n_paths + 1);
+		} else {
+			*values = gc_xml_stream_steal_values (stream.parser);
+		}
+		if (response) {
+			*response_length = stream.copy->len;
+			*response = g_byte_array_free (stream.copy, FALSE);
+			stream.copy = NULL;
+		}
+	}
+	if (stream.copy) {
+		g_byte_array_free (stream.copy, TRUE);
+	}
+	gc_xml_stream_free (stream.parser);
+	return ok;
+}
+
+/* extract the fields from a complete (cached) response. A response
+ * that can't be parsed has no fields. */
+static void
+gc_web_service_parse_fields (GcXmlPath    **paths,
+                             guint          n_paths,
+                             GHashTable    *namespaces,
+                             const guchar  *response,
+                             gint           response_length,
+                             gchar       ***values)
+{
+	GcXmlStream *parser;
 	
+	parser = gc_xml_stream_new (paths, n_paths, namespaces);
+	if (gc_xml_stream_push (parser, (const gchar *)response, response_length,
+	                        TRUE, NULL)) {
+		*values = gc_xml_stream_steal_values (parser);
+	} else {
+		*values = g_new0 (gchar *, n_paths + 1);
+	}
+	gc_xml_stream_free (parser);
+}
+
+/* Streaming is used if it is enabled and all fields can be streamed */
+static gboolean
+gc_web_service_can_stream (GcWebService *self)
+{
+	guint i;
+	
+	if (!self->streaming || self->stream_paths->len == 0) {
+		return FALSE;
+	}
+	for (i = 0; i < self->stream_paths->len; i++) {
+		if (!g_ptr_array_index (self->stream_paths, i)) {
+			return FALSE;
+		}
+	}
 	return TRUE;
 }
 
-static xmlXPathObject*
-gc_web_service_get_xpath_object (GcWebService *self, gchar* xpath)
+typedef struct _GcWebServiceCacheEntry {
+	gchar *url;
+	guchar *response;
+	gint response_length;
+	glong expires;
+	GList *link;    /* in self->cache_lru */
+} GcWebServiceCacheEntry;
+
+static glong
+gc_web_service_now (void)
 {
-	xmlXPathObject *obj = NULL;
+	GTimeVal now;
 	
-	g_return_val_if_fail (xpath, FALSE);
+	g_get_current_time (&now);
+	return now.tv_sec;
+}
+
+static void
+gc_web_service_cache_entry_free (GcWebServiceCacheEntry *entry)
+{
+	g_free (entry->url);
+	g_free (entry->response);
+	g_free (entry);
+}
+
+static void
+gc_web_service_cache_remove (GcWebService           *self,
+                             GcWebServiceCacheEntry *entry)
+{
+	g_queue_delete_link (self->cache_lru, entry->link);
+	self->cache_size -= entry->response_length;
+	/* frees entry */
+	g_hash_table_remove (self->cache, entry->url);
+}
+
+static void
+gc_web_service_cache_clear (GcWebService *self)
+{
+	if (self->cache) {
+		g_hash_table_destroy (self->cache);
+		self->cache = NULL;
+		g_queue_free (self->cache_lru);
+		self->cache_lru = NULL;
+	}
+	self->cache_size = 0;
+}
+
+/* Returns an unexpired cache entry for url or NULL */
+static GcWebServiceCacheEntry *
+gc_web_service_cache_lookup (GcWebService *self, const gchar *url)
+{
+	GcWebServiceCacheEntry *entry;
 	
-	/* parse the doc if not parsed yet and register namespaces */
-	if (!gc_web_service_build_xpath_context (self)) {
+	if (!self->cache) {
+		return NULL;
+	}
+	
+	entry = g_hash_table_lookup (self->cache, url);
+	if (entry && entry->expires <= gc_web_service_now ()) {
+		gc_web_service_cache_remove (self, entry);
+		entry = NULL;
+	}
+	
+	if (entry) {
+		g_queue_unlink (self->cache_lru, entry->link);
+		g_queue_push_head_link (self->cache_lru, entry->link);
+	}
+	return entry;
+}
+
+/* Store a copy of response. max_age is the lifetime the server 
+ * allows (-1 if it did not say): it can shorten but not extend
+ * the cache ttl */
+static void
+gc_web_service_cache_insert (GcWebService *self,
+                             const gchar  *url,
+                             const guchar *response,
+                             gint          response_length,
+                             glong         max_age)
+{
+	GcWebServiceCacheEntry *entry;
+	glong ttl;
+	
+	if (!self->cache) {
+		return;
+	}
+	
+	ttl = self->cache_ttl;
+	if (max_age >= 0) {
+		ttl = MIN (ttl, max_age);
+	}
+	if (ttl == 0 ||
+	    (self->cache_max_size > 0 && 
+	     (gsize)response_length > self->cache_max_size)) {
+		return;
+	}
+	
+	entry = g_hash_table_lookup (self->cache, url);
+	if (entry) {
+		gc_web_service_cache_remove (self, entry);
+	}
+	
+	entry = g_new0 (GcWebServiceCacheEntry, 1);
+	entry->url = g_strdup (url);
+	entry->response = g_memdup (response, response_length);
+	entry->response_length = response_length;
+	entry->expires = gc_web_service_now () + ttl;
+	
+	g_queue_push_head (self->cache_lru, entry);
+	entry->link = self->cache_lru->head;
+	g_hash_table_insert (self->cache, entry->url, entry);
+	self->cache_size += response_length;
+	
+	/* evict least recently used entries */
+	while (self->cache_max_size > 0 &&
+	       self->cache_size > self->cache_max_size) {
+		gc_web_service_cache_remove (self, 
+		                             g_queue_peek_tail (self->cache_lru));
+	}
+}
+
+/* Look for url in the memory cache and then in the disk cache.
+ * Returns a copy of the cached response */
+static gboolean
+gc_web_service_cache_get (GcWebService *self,
+                          const gchar  *url,
+                          guchar      **response,
+                          gint         *response_length)
+{
+	GcWebServiceCacheEntry *entry;
+	gsize length;
+	glong max_age;
+	
+	if (!self->cache && !self->disk_cache) {
 		return FALSE;
 	}
-	g_assert (self->xpath_ctx);
 	
-	obj = xmlXPathEvalExpression ((xmlChar*)xpath, self->xpath_ctx);
+	entry = gc_web_service_cache_lookup (self, url);
+	if (entry) {
+		*response = g_memdup (entry->response, entry->response_length);
+		*response_length = entry->response_length;
+		self->cache_hits++;
+		return TRUE;
+	}
+	
+	if (self->disk_cache &&
+	    gc_disk_cache_lookup (self->disk_cache, url,
+	                          response, &length, &max_age)) {
+		*response_length = length;
+		gc_web_service_cache_insert (self, url,
+		                             *response, *response_length,
+		                             max_age);
+		self->cache_hits++;
+		return TRUE;
+	}
+	
+	self->cache_misses++;
+	return FALSE;
+}
+
+/* Store a freshly fetched response in the memory and disk caches */
+static void
+gc_web_service_cache_put (GcWebService *self,
+                          const gchar  *url,
+                          const guchar *response,
+                          gint          response_length,
+                          glong         max_age)
+{
+	guint ttl;
+	
+	gc_web_service_cache_insert (self, url,
+	                             response, response_length,
+	                             max_age);
+	
+	if (self->disk_cache && max_age != 0) {
+		ttl = self->disk_cache_ttl;
+		if (max_age > 0) {
+			ttl = MIN (ttl, (guint)max_age);
+		}
+		gc_disk_cache_store (self->disk_cache, url,
+		                     response, response_length, ttl);
+	}
+}
+
+/* fetch url (or use the cache), save fields into self->stream_values */
+static gboolean
+gc_web_service_fetch_streaming (GcWebService *self, gchar *url, GError **error)
+{
+	GcXmlPath **paths = (GcXmlPath **)self->stream_paths->pdata;
+	guint n_paths = self->stream_paths->len;
+	GHashTable *namespaces;
+	guchar *response = NULL;
+	gint response_length = 0;
+	glong max_age;
+	gboolean ok;
+	
+	gc_web_service_reset (self);
+	namespaces = gc_web_service_get_namespace_table (self);
+	
+	if (gc_web_service_cache_get (self, url, &response, &response_length)) {
+		gc_web_service_parse_fields (paths, n_paths, namespaces,
+		                             response, response_length,
+		                             &self->stream_values);
+		ok = TRUE;
+	} else {
+		ok = gc_web_service_fetch_fields (url, paths, n_paths, namespaces,
+		                                  &self->stream_values,
+		                                  (self->cache || self->disk_cache) ?
+		                                  &response : NULL,
+		                                  &response_length, &max_age,
+		                                  NULL, error);
+		if (ok && response) {
+			gc_web_service_cache_put (self, url,
+			                          response, response_length,
+			                          max_age);
+		}
+	}
+	g_free (response);
+	g_hash_table_unref (namespaces);
+	
+	if (ok) {
+		self->n_stream_values = n_paths;
+	}
+	return ok;
+}
+
+/* fetch data from url (or the cache), save into self->response */
+static gboolean
+gc_web_service_fetch (GcWebService *self, gchar *url, GError **error)
+{
+	glong max_age;
+	
+	if (gc_web_service_can_stream (self)) {
+		return gc_web_service_fetch_streaming (self, url, error);
+	}
+	
+	gc_web_service_reset (self);
+	
+	if (gc_web_service_cache_get (self, url,
+	                              &self->response,
+	                              &self->response_length)) {
+		return TRUE;
+	}
+	
+	if (!gc_web_service_fetch_url (url,
+	                               &self->response,
+	                               &self->response_length,
+	                               &max_age,
+	                               NULL,
+	                               error)) {
+		return FALSE;
+	}
+	
+	gc_web_service_cache_put (self, url,
+	                          self->response, self->response_length,
+	                          max_age);
+	return TRUE;
+}
+
+/* Build the query url from base url and a NULL-terminated list of 
+ * key-value pairs: "base?key1=value1&key2=value2&..." */
+static gchar *
+gc_web_service_build_url (GcWebService *self, va_list list)
+{
+	gchar *key, *value, *esc_value, *tmp, *url;
+	gboolean first_pair = TRUE;
+	
+	url = g_strdup (self->base_url);
+	
+	key = va_arg (list, char*);
+	while (key) {
+		value = va_arg (list, char*);
+		esc_value = (gchar *)xmlURIEscapeStr ((xmlChar *)value, (xmlChar *)":");
+		
+		if (first_pair) {
+			tmp = g_strdup_printf ("%s?%s=%s",  url, key, esc_value);
+			first_pair = FALSE;
+		} else {
+			tmp = g_strdup_printf ("%s&%s=%s",  url, key, esc_value);
+		}
+		g_free (esc_value);
+		g_free (url);
+		url = tmp;
+		key = va_arg (list, char*);
+	}
+	
+	return url;
+}
+
+/* Used both for the result of a gc_web_service_query_async() call
+ * and for the fetch of a url that one or more of them wait for */
+typedef struct _GcWebServiceAsyncData {
+	gchar *url;
+	GCancellable *cancellable;
+	gulong cancelled_id;
+	GCancellable *fetch_cancellable; /* of the fetch a query waits for */
+	guchar *response;
+	gint response_length;
+	glong max_age;
+	
+	/* streaming queries: values is set if the response was streamed */
+	GcXmlPath **paths;
+	guint n_paths;
+	GHashTable *namespaces;
+	gchar **values;
+	gboolean keep_response;
+} GcWebServiceAsyncData;
+
+static void
+gc_web_service_async_data_free (GcWebServiceAsyncData *data)
+{
+	g_free (data->url);
+	if (data->cancellable) {
+		g_object_unref (data->cancellable);
+	}
+	if (data->fetch_cancellable) {
+		g_object_unref (data->fetch_cancellable);
+	}
+	g_free (data->response);
+	gc_web_service_free_values (data->values, data->n_paths);
+	g_free (data->paths);
+	if (data->namespaces) {
+		g_hash_table_unref (data->namespaces);
+	}
+	g_free (data);
+}
+
+/* GSimpleAsyncThreadFunc, runs in a worker thread */
+static void
+gc_web_service_fetch_thread (GSimpleAsyncResult *result,
+                             GObject            *object,
+                             GCancellable       *cancellable)
+{
+	GcWebServiceAsyncData *data;
+	GError *error = NULL;
+	gboolean ok;
+	
+	data = g_simple_async_result_get_op_res_gpointer (result);
+	
+	if (g_cancellable_set_error_if_cancelled (cancellable, &error)) {
+		ok = FALSE;
+	} else if (data->paths) {
+		ok = gc_web_service_fetch_fields (data->url,
+		                                  data->paths, data->n_paths,
+		                                  data->namespaces,
+		                                  &data->values,
+		                                  data->keep_response ? 
+		                                  &data->response : NULL,
+		                                  &data->response_length,
+		                                  &data->max_age,
+		                                  cancellable,
+		                                  &error);
+	} else {
+		ok = gc_web_service_fetch_url (data->url,
+		                               &data->response,
+		                               &data->response_length,
+		                               &data->max_age,
+		                               cancellable,
+		                               &error);
+	}
+	
+	if (!ok) {
+		g_simple_async_result_set_from_error (result, error);
+		g_error_free (error);
+	}
+}
+
+/* Give one waiting caller a copy of the outcome of a fetch */
+static void
+gc_web_service_complete_waiter (GSimpleAsyncResult    *waiter,
+                                GcWebServiceAsyncData *fetch,
+                                GError                *error)
+{
+	GcWebServiceAsyncData *data;
+	GError *cancel_error = NULL;
+	guint i;
+	
+	data = g_simple_async_result_get_op_res_gpointer (waiter);
+	if (data->cancelled_id) {
+		g_cancellable_disconnect (data->cancellable, data->cancelled_id);
+		data->cancelled_id = 0;
+	}
+	
+	if (g_cancellable_set_error_if_cancelled (data->cancellable, &cancel_error)) {
+		g_simple_async_result_set_from_error (waiter, cancel_error);
+		g_error_free (cancel_error);
+	} else if (error) {
+		g_simple_async_result_set_from_error (waiter, error);
+	} else if (fetch->values) {
+		data->n_paths = fetch->n_paths;
+		data->values = g_new0 (gchar *, data->n_paths + 1);
+		for (i = 0; i < data->n_paths; i++) {
+			data->values[i] = g_strdup (fetch->values[i]);
+		}
+	} else {
+		data->response = g_memdup (fetch->response, fetch->response_length);
+		data->response_length = fetch->response_length;
+	}
+	g_simple_async_result_complete (waiter);
+}
+
+static gboolean
+gc_web_service_waits_for (GSimpleAsyncResult    *waiter,
+                          GcWebServiceAsyncData *fetch)
+{
+	GcWebServiceAsyncData *data;
+	
+	data = g_simple_async_result_get_op_res_gpointer (waiter);
+	return (data->fetch_cancellable == fetch->cancellable);
+}
+
+/* GSourceFunc: cancels the fetches whose waiting queries have all been
+ * cancelled, so they don't keep a worker thread (and possibly a
+ * connection slot) busy. Runs in the main context. */
+static gboolean
+gc_web_service_abandon_fetches (gpointer user_data)
+{
+	GcWebService *self = GC_WEB_SERVICE (user_data);
+	GcWebServiceAsyncData *data;
+	GHashTableIter iter;
+	GSList *waiters, *abandoned = NULL, *l;
+	
+	g_hash_table_iter_init (&iter, self->in_flight);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&waiters)) {
+		for (l = waiters; l; l = l->next) {
+			data = g_simple_async_result_get_op_res_gpointer (l->data);
+			if (!g_cancellable_is_cancelled (data->cancellable)) {
+				break;
+			}
+		}
+		if (l) {
+			continue;
+		}
+		
+		/* the fetch finishes with an error nobody waits for */
+		data = g_simple_async_result_get_op_res_gpointer (waiters->data);
+		g_cancellable_cancel (data->fetch_cancellable);
+		abandoned = g_slist_concat (g_slist_reverse (waiters), abandoned);
+		g_hash_table_iter_remove (&iter);
+	}
+	
+	/* callbacks may start new queries, so not while iterating */
+	for (l = abandoned; l; l = l->next) {
+		gc_web_service_complete_waiter (l->data, NULL, NULL);
+		g_object_unref (l->data);
+	}
+	g_slist_free (abandoned);
+	return FALSE;
+}
+
+/* GCancellable::cancelled handler of a waiting query. May run in any
+ * thread, the waiters are checked in the main context */
+static void
+gc_web_service_query_cancelled (GCancellable *cancellable,
+                                GcWebService *self)
+{
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+	                 gc_web_service_abandon_fetches,
+	                 g_object_ref (self),
+	                 g_object_unref);
+}
+
+static void
+gc_web_service_watch_cancellable (GcWebService          *self,
+                                  GcWebServiceAsyncData *data)
+{
+	if (data->cancellable) {
+		data->cancelled_id = g_cancellable_connect (data->cancellable,
+		                                            G_CALLBACK (gc_web_service_query_cancelled),
+		                                            self, NULL);
+	}
+}
+
+/* GAsyncReadyCallback for the fetch of a url: caches the response
+ * and completes every query that waits for it */
+static void
+gc_web_service_fetch_done (GObject      *source,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+	GcWebService *self = GC_WEB_SERVICE (source);
+	GcWebServiceAsyncData *fetch;
+	GError *error = NULL;
+	GSList *waiters, *l;
+	
+	fetch = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
+	
+	/* queries for the url made from now on need a new fetch. If this
+	 * fetch was abandoned, its waiters are gone and the entry (if any)
+	 * belongs to a newer fetch */
+	waiters = g_hash_table_lookup (self->in_flight, fetch->url);
+	if (waiters && gc_web_service_waits_for (waiters->data, fetch)) {
+		waiters = g_slist_reverse (waiters);
+		g_hash_table_remove (self->in_flight, fetch->url);
+	} else {
+		waiters = NULL;
+	}
+	
+	if (!g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), &error) &&
+	    fetch->response) {
+		gc_web_service_cache_put (self, fetch->url,
+		                          fetch->response, fetch->response_length,
+		                          fetch->max_age);
+	}
+	
+	for (l = waiters; l; l = l->next) {
+		gc_web_service_complete_waiter (l->data, fetch, error);
+		g_object_unref (l->data);
+	}
+	g_slist_free (waiters);
+	
+	if (error) {
+		g_error_free (error);
+	}
+}
+
+/* Compiled expression for xpath. Expressions are compiled once and
+ * kept for the lifetime of the web service */
+static xmlXPathCompExpr*
+gc_web_service_compile (GcWebService *self, const gchar *xpath)
+{
+	xmlXPathCompExpr *comp;
+	
+	comp = g_hash_table_lookup (self->compiled, xpath);
+	if (!comp) {
+		comp = xmlXPathCompile ((xmlChar*)xpath);
+		if (!comp) {
+			return NULL;
+		}
+		g_hash_table_insert (self->compiled, g_strdup (xpath), comp);
+	}
+	return comp;
+}
+
+/* Evaluate a compiled expression, NULL if nothing matches */
+static xmlXPathObject*
+gc_web_service_eval (GcWebService *self, xmlXPathCompExpr *comp)
+{
+	xmlXPathObject *obj;
+	
+	obj = xmlXPathCompiledEval (comp, self->xpath_ctx);
 	if (obj && 
 	    (!obj->nodesetval || xmlXPathNodeSetIsEmpty (obj->nodesetval))) {
 		xmlXPathFreeObject (obj);
@@ -240,6 +932,27 @@ gc_web_service_get_xpath_object (GcWebService *self, gchar* xpath)
 	return obj;
 }
 
+static xmlXPathObject*
+gc_web_service_get_xpath_object (GcWebService *self, gchar* xpath)
+{
+	xmlXPathCompExpr *comp;
+	
+	g_return_val_if_fail (xpath, FALSE);
+	
+	comp = gc_web_service_compile (self, xpath);
+	if (!comp) {
+		return NULL;
+	}
+	
+	/* parse the doc if not parsed yet and register namespaces */
+	if (!gc_web_service_build_xpath_context (self)) {
+		return NULL;
+	}
+	g_assert (self->xpath_ctx);
+	
+	return gc_web_service_eval (self, comp);
+}
+
 static void
 gc_web_service_init (GcWebService *self)
 {
@@ -248,6 +961,30 @@ gc_web_service_init (GcWebService *self)
 	self->xpath_ctx = NULL;
 	self->namespaces = NULL;
 	self->base_url = NULL;
+	
+	self->cache = NULL;
+	self->cache_lru = NULL;
+	self->cache_ttl = 0;
+	self->cache_max_size = 0;
+	self->cache_size = 0;
+	self->cache_hits = 0;
+	self->cache_misses = 0;
+	
+	self->disk_cache = NULL;
+	self->disk_cache_ttl = 0;
+	
+	self->compiled = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                        g_free,
+	                                        (GDestroyNotify)xmlXPathFreeCompExpr);
+	self->fields = g_ptr_array_new ();
+	
+	self->streaming = FALSE;
+	self->stream_paths = g_ptr_array_new ();
+	self->stream_values = NULL;
+	self->n_stream_values = 0;
+	
+	self->in_flight = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                         g_free, NULL);
 }
 
 
@@ -255,8 +992,25 @@ static void
 gc_web_service_finalize (GObject *obj)
 {
 	GcWebService *self = (GcWebService *) obj;
+	guint i;
 	
 	gc_web_service_reset (self);
+	gc_web_service_cache_clear (self);
+	if (self->disk_cache) {
+		gc_disk_cache_unref (self->disk_cache);
+	}
+	
+	/* fields are owned by the compiled table */
+	g_ptr_array_free (self->fields, TRUE);
+	g_hash_table_destroy (self->compiled);
+	for (i = 0; i < self->stream_paths->len; i++) {
+		if (g_ptr_array_index (self->stream_paths, i)) {
+			gc_xml_path_free (g_ptr_array_index (self->stream_paths, i));
+		}
+	}
+	g_ptr_array_free (self->stream_paths, TRUE);
+	/* every pending query holds a reference, so this is empty */
+	g_hash_table_destroy (self->in_flight);
 	
 	g_free (self->base_url);
 	
@@ -271,6 +1025,8 @@ gc_web_service_class_init (GcWebServiceClass *klass)
 {
 	GObjectClass *o_class = (GObjectClass *) klass;
 	o_class->finalize = gc_web_service_finalize;
+	
+	gc_http_pool_init ();
 }
 
 /**
@@ -292,6 +1048,113 @@ gc_web_service_set_base_url (GcWebService *self, gchar *url)
 	self->base_url = g_strdup (url);
 }
  
+/**
+ * gc_web_service_set_connection_limits:
+ * @max_connections: Maximum number of simultaneous connections per host, 
+ * 0 for no limit
+ * @idle_timeout: Seconds an unused connection is kept open for reuse, 
+ * 0 to close connections after every query
+ * 
+ * Sets the limits of the HTTP connection pool shared by all 
+ * #GcWebService objects in the process. The defaults are 4 connections
+ * per host and 30 seconds.
+ */
+void
+gc_web_service_set_connection_limits (guint max_connections, guint idle_timeout)
+{
+	gc_http_pool_set_limits (max_connections, idle_timeout);
+}
+
+/**
+ * gc_web_service_set_cache:
+ * @self: The #GcWebService object
+ * @ttl: Seconds a response is kept in the cache, 0 disables the cache
+ * @max_size: Maximum total size of cached responses in bytes, 0 for 
+ * no limit
+ * 
+ * Enables caching of query responses. Queries with an url that was 
+ * fetched less than @ttl seconds ago are answered from memory. The 
+ * lifetime is shortened if the server response says so 
+ * (Cache-Control or Expires header) and only successful responses are 
+ * cached. When the cache grows beyond @max_size the least recently 
+ * used responses are dropped.
+ *
+ * Calling this function clears the cache and the statistics.
+ */
+void
+gc_web_service_set_cache (GcWebService *self, guint ttl, gsize max_size)
+{
+	gc_web_service_cache_clear (self);
+	self->cache_hits = 0;
+	self->cache_misses = 0;
+	
+	self->cache_ttl = ttl;
+	self->cache_max_size = max_size;
+	if (ttl > 0) {
+		self->cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                     NULL,
+		                                     (GDestroyNotify)gc_web_service_cache_entry_free);
+		self->cache_lru = g_queue_new ();
+	}
+}
+
+/**
+ * gc_web_service_set_disk_cache:
+ * @self: The #GcWebService object
+ * @name: Name of the cache file, or %NULL to disable the disk cache
+ * @ttl: Seconds a response is kept on disk
+ * 
+ * Enables a persistent cache of query responses in the user cache 
+ * directory, so that a provider that was restarted can answer 
+ * repeated queries without network access. Web services in the same 
+ * process may share a cache by using the same @name. Like with 
+ * gc_web_service_set_cache(), Cache-Control and Expires headers can 
+ * shorten the lifetime of a response. A response found on disk is
+ * also added to the memory cache if that is enabled.
+ */
+void
+gc_web_service_set_disk_cache (GcWebService *self, 
+                               const gchar  *name,
+                               guint         ttl)
+{
+	if (self->disk_cache) {
+		gc_disk_cache_unref (self->disk_cache);
+		self->disk_cache = NULL;
+	}
+	
+	self->disk_cache_ttl = ttl;
+	if (name && ttl > 0) {
+		self->disk_cache = gc_disk_cache_open (name);
+	}
+}
+
+/**
+ * gc_web_service_get_cache_stats:
+ * @self: The #GcWebService object
+ * @hits: Pointer to returned number of queries answered from the memory or disk cache, or %NULL
+ * @misses: Pointer to returned number of queries that were not cached, or %NULL
+ * @size: Pointer to returned current size of the memory cache in bytes, or %NULL
+ * 
+ * Returns statistics of the response cache enabled with 
+ * gc_web_service_set_cache().
+ */
+void
+gc_web_service_get_cache_stats (GcWebService *self,
+                                guint        *hits,
+                                guint        *misses,
+                                gsize        *size)
+{
+	if (hits) {
+		*hits = self->cache_hits;
+	}
+	if (misses) {
+		*misses = self->cache_misses;
+	}
+	if (size) {
+		*size = self->cache_size;
+	}
+}
+
 /**
  * gc_web_service_add_namespace:
  * @self: The #GcWebService object
@@ -333,32 +1196,12 @@ gboolean
 gc_web_service_query (GcWebService *self, GError **error, ...)
 {
 	va_list list;
-	gchar *key, *value, *esc_value, *tmp, *url;
-	gboolean first_pair = TRUE;
+	gchar *url;
 	
 	g_return_val_if_fail (self->base_url, FALSE);
 	
-	url = g_strdup (self->base_url);
-	
-	/* read the arguments one key-value pair at a time,
-	   add the pairs to url as "?key1=value1&key2=value2&..." */
 	va_start (list, error);
-	key = va_arg (list, char*);
-	while (key) {
-		value = va_arg (list, char*);
-		esc_value = (gchar *)xmlURIEscapeStr ((xmlChar *)value, (xmlChar *)":");
-		
-		if (first_pair) {
-			tmp = g_strdup_printf ("%s?%s=%s",  url, key, esc_value);
-			first_pair = FALSE;
-		} else {
-			tmp = g_strdup_printf ("%s&%s=%s",  url, key, esc_value);
-		}
-		g_free (esc_value);
-		g_free (url);
-		url = tmp;
-		key = va_arg (list, char*);
-	}
+	url = gc_web_service_build_url (self, list);
 	va_end (list);
 	
 	if (!gc_web_service_fetch (self, url, error)) {
@@ -370,6 +1213,166 @@ gc_web_service_query (GcWebService *self, GError **error, ...)
 	return TRUE;
 }
 
+/**
+ * gc_web_service_query_async:
+ * @self: A #GcWebService object
+ * @cancellable: optional #GCancellable object, %NULL to ignore
+ * @callback: A #GAsyncReadyCallback to call when the data has been fetched
+ * @user_data: the data to pass to @callback
+ * @Varargs: NULL-terminated list of key-value gchar* pairs
+ * 
+ * Asynchronous version of gc_web_service_query(). The url is 
+ * constructed like in gc_web_service_query() and fetched without 
+ * blocking the main loop. When the data is available @callback is 
+ * called in the thread-default main context; it should then call 
+ * gc_web_service_query_finish() and can read the data using 
+ * gc_web_service_get_* -functions.
+ *
+ * Queries for an url that is already being fetched by an earlier 
+ * gc_web_service_query_async() call do not cause another request: 
+ * all of them complete when the response arrives. Cancelling 
+ * @cancellable makes the query finish with %G_IO_ERROR_CANCELLED; the
+ * request itself is interrupted once every query waiting for it has
+ * been cancelled.
+ */
+void
+gc_web_service_query_async (GcWebService        *self,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data,
+                            ...)
+{
+	va_list list;
+	GSimpleAsyncResult *result, *fetch_result;
+	GcWebServiceAsyncData *data, *fetch, *waiting;
+	GHashTable *namespaces;
+	GSList *waiters;
+	guchar *response;
+	gint response_length;
+	
+	g_return_if_fail (self->base_url);
+	
+	data = g_new0 (GcWebServiceAsyncData, 1);
+	va_start (list, user_data);
+	data->url = gc_web_service_build_url (self, list);
+	va_end (list);
+	if (cancellable) {
+		data->cancellable = g_object_ref (cancellable);
+	}
+	
+	result = g_simple_async_result_new (G_OBJECT (self),
+	                                    callback, user_data,
+	                                    gc_web_service_query_async);
+	g_simple_async_result_set_op_res_gpointer (result, data,
+	                                           (GDestroyNotify)gc_web_service_async_data_free);
+	
+	if (gc_web_service_cache_get (self, data->url,
+	                              &response, &response_length)) {
+		if (gc_web_service_can_stream (self)) {
+			namespaces = gc_web_service_get_namespace_table (self);
+			gc_web_service_parse_fields ((GcXmlPath **)self->stream_paths->pdata,
+			                             self->stream_paths->len,
+			                             namespaces,
+			                             response, response_length,
+			                             &data->values);
+			data->n_paths = self->stream_paths->len;
+			g_hash_table_unref (namespaces);
+			g_free (response);
+		} else {
+			data->response = response;
+			data->response_length = response_length;
+		}
+		g_simple_async_result_complete_in_idle (result);
+		g_object_unref (result);
+		return;
+	}
+	
+	/* identical queries share one fetch */
+	if (g_hash_table_lookup_extended (self->in_flight, data->url,
+	                                  NULL, (gpointer *)&waiters)) {
+		waiting = g_simple_async_result_get_op_res_gpointer (waiters->data);
+		data->fetch_cancellable = g_object_ref (waiting->fetch_cancellable);
+		g_hash_table_insert (self->in_flight, g_strdup (data->url),
+		                     g_slist_prepend (waiters, result));
+		gc_web_service_watch_cancellable (self, data);
+		return;
+	}
+	g_hash_table_insert (self->in_flight, g_strdup (data->url),
+	                     g_slist_prepend (NULL, result));
+	
+	fetch = g_new0 (GcWebServiceAsyncData, 1);
+	fetch->url = g_strdup (data->url);
+	fetch->cancellable = g_cancellable_new ();
+	data->fetch_cancellable = g_object_ref (fetch->cancellable);
+	gc_web_service_watch_cancellable (self, data);
+	if (gc_web_service_can_stream (self)) {
+		fetch->n_paths = self->stream_paths->len;
+		fetch->paths = g_memdup (self->stream_paths->pdata,
+		                         fetch->n_paths * sizeof (GcXmlPath *));
+		fetch->namespaces = gc_web_service_get_namespace_table (self);
+		fetch->keep_response = (self->cache || self->disk_cache);
+	}
+	
+	/* others may join, so the fetch is only cancelled once all the
+	 * queries waiting for it have been */
+	fetch_result = g_simple_async_result_new (G_OBJECT (self),
+	                                          gc_web_service_fetch_done, NULL,
+	                                          gc_web_service_fetch_done);
+	g_simple_async_result_set_op_res_gpointer (fetch_result, fetch,
+	                                           (GDestroyNotify)gc_web_service_async_data_free);
+	g_simple_async_result_run_in_thread (fetch_result,
+	                                     gc_web_service_fetch_thread,
+	                                     G_PRIORITY_DEFAULT,
+	                                     fetch->cancellable);
+	g_object_unref (fetch_result);
+}
+
+/**
+ * gc_web_service_query_finish:
+ * @self: A #GcWebService object
+ * @result: The #GAsyncResult passed to the callback
+ * @error: Pointer to returned #GError or %NULL
+ * 
+ * Finishes a query started with gc_web_service_query_async(). On 
+ * success the fetched data replaces the data of any previous query
+ * and can be read with gc_web_service_get_* -functions.
+ *
+ * Return value: %TRUE on success.
+ */
+gboolean
+gc_web_service_query_finish (GcWebService  *self,
+                             GAsyncResult  *result,
+                             GError       **error)
+{
+	GSimpleAsyncResult *simple;
+	GcWebServiceAsyncData *data;
+	
+	g_return_val_if_fail (g_simple_async_result_is_valid (result,
+	                                                      G_OBJECT (self),
+	                                                      gc_web_service_query_async),
+	                      FALSE);
+	
+	simple = G_SIMPLE_ASYNC_RESULT (result);
+	if (g_simple_async_result_propagate_error (simple, error)) {
+		return FALSE;
+	}
+	
+	data = g_simple_async_result_get_op_res_gpointer (simple);
+	
+	gc_web_service_reset (self);
+	if (data->values) {
+		self->stream_values = data->values;
+		self->n_stream_values = data->n_paths;
+		data->values = NULL;
+	} else {
+		self->response = data->response;
+		self->response_length = data->response_length;
+		data->response = NULL;
+	}
+	
+	return TRUE;
+}
+
 /**
  * gc_web_service_get_double:
  * @self: A #GcWebService object
@@ -422,6 +1425,111 @@ gc_web_service_get_string (GcWebService *self, gchar **value, gchar* xpath)
 	return TRUE;
 }
 
+/**
+ * gc_web_service_add_field:
+ * @self: The #GcWebService object
+ * @xpath: XPath expression for the field
+ * 
+ * Registers a field that gc_web_service_get_fields() extracts from 
+ * every response. The expression is compiled only once. Fields are 
+ * numbered in the order they are added, starting from 0.
+ *
+ * Return value: Index of the field, or -1 if @xpath is not a valid
+ * expression.
+ */
+gint
+gc_web_service_add_field (GcWebService *self, const gchar *xpath)
+{
+	xmlXPathCompExpr *comp;
+	
+	g_return_val_if_fail (xpath, -1);
+	
+	comp = gc_web_service_compile (self, xpath);
+	if (!comp) {
+		return -1;
+	}
+	g_ptr_array_add (self->fields, comp);
+	/* NULL if the field can't be extracted in streaming mode */
+	g_ptr_array_add (self->stream_paths, gc_xml_path_new (xpath));
+	return self->fields->len - 1;
+}
+
+/**
+ * gc_web_service_get_fields:
+ * @self: The #GcWebService object
+ * @values: Array with room for one string per field
+ * 
+ * Extracts all fields registered with gc_web_service_add_field() from
+ * the data that was fetched in the last query. The document is parsed
+ * only once. Each element of @values is set to a newly allocated 
+ * string with the first match of the field, or %NULL if the field was
+ * not found. The strings should be freed with g_free().
+ *
+ * Return value: %TRUE if the response could be parsed.
+ */
+gboolean
+gc_web_service_get_fields (GcWebService *self, gchar **values)
+{
+	xmlXPathObject *obj;
+	xmlChar *str;
+	guint i;
+	
+	for (i = 0; i < self->fields->len; i++) {
+		values[i] = NULL;
+	}
+	
+	/* last query was streamed */
+	if (self->stream_values) {
+		for (i = 0; i < MIN (self->fields->len, self->n_stream_values); i++) {
+			values[i] = g_strdup (self->stream_values[i]);
+		}
+		return TRUE;
+	}
+	
+	if (!gc_web_service_build_xpath_context (self)) {
+		return FALSE;
+	}
+	
+	for (i = 0; i < self->fields->len; i++) {
+		obj = gc_web_service_eval (self, g_ptr_array_index (self->fields, i));
+		if (obj) {
+			str = xmlXPathCastNodeSetToString (obj->nodesetval);
+			values[i] = g_strdup ((gchar *)str);
+			xmlFree (str);
+			xmlXPathFreeObject (obj);
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * gc_web_service_set_streaming:
+ * @self: The #GcWebService object
+ * @streaming: %TRUE to enable streaming mode
+ * 
+ * In streaming mode the response is parsed while it is being received
+ * and only the fields registered with gc_web_service_add_field() are
+ * kept: no document tree is built and, unless a cache is enabled, the
+ * response itself is not stored. The fields are read with 
+ * gc_web_service_get_fields() as usual, but gc_web_service_get_string(),
+ * gc_web_service_get_double() and gc_web_service_get_response() find
+ * nothing after a streamed query. An error response (any status but 
+ * 200) or one that is not well-formed XML does not make the query 
+ * fail: it succeeds and every field is %NULL, so treat a query whose
+ * fields are all %NULL as "no result".
+ *
+ * Only fields that are simple location paths are supported in 
+ * streaming mode: element names (optionally with a namespace prefix 
+ * or a position like "[1]") separated by "/" or "//", optionally 
+ * followed by an attribute ("/@name"). If any field falls outside this
+ * subset, queries are not streamed.
+ */
+void
+gc_web_service_set_streaming (GcWebService *self, gboolean streaming)
+{
+	self->streaming = streaming;
+}
+
 /**
  * gc_web_service_get_response:
  * @self: The #GcWebService object
@@ -24,6 +24,7 @@
 #define GC_WEB_SERVICE_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <libxml/xpath.h> /* TODO: could move privates to .c-file and get rid of this*/
 
 G_BEGIN_DECLS
@@ -46,6 +47,27 @@ typedef struct _GcWebService {
 	gint response_length;
 	GList *namespaces;
 	xmlXPathContext *xpath_ctx;
+	
+	GHashTable *cache;      /* url -> cache entry */
+	GQueue *cache_lru;      /* cache entries, most recently used first */
+	guint cache_ttl;
+	gsize cache_max_size;
+	gsize cache_size;
+	guint cache_hits;
+	guint cache_misses;
+	
+	struct _GcDiskCache *disk_cache;
+	guint disk_cache_ttl;
+	
+	GHashTable *compiled;   /* xpath -> xmlXPathCompExpr */
+	GPtrArray *fields;      /* xmlXPathCompExpr, see gc_web_service_add_field() */
+	
+	gboolean streaming;
+	GPtrArray *stream_paths;  /* parsed fields for streaming mode */
+	gchar **stream_values;    /* fields of the last streamed query */
+	guint n_stream_values;
+	
+	GHashTable *in_flight;    /* url -> GSList of waiting queries */
 } GcWebService;
 
 typedef struct _GcWebServiceClass {
@@ -56,10 +78,30 @@ GType gc_web_service_get_type (void);
 
 void gc_web_service_set_base_url (GcWebService *self, gchar *url);
 gboolean gc_web_service_add_namespace (GcWebService *self, gchar *namespace, gchar *uri);
+void gc_web_service_set_connection_limits (guint max_connections, guint idle_timeout);
+void gc_web_service_set_cache (GcWebService *self, guint ttl, gsize max_size);
+void gc_web_service_set_disk_cache (GcWebService *self, 
+                                    const gchar  *name,
+                                    guint         ttl);
+void gc_web_service_get_cache_stats (GcWebService *self,
+                                     guint        *hits,
+                                     guint        *misses,
+                                     gsize        *size);
 
 gboolean gc_web_service_query (GcWebService *self, GError **error, ...);
+void gc_web_service_query_async (GcWebService        *self,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data,
+                                 ...);
+gboolean gc_web_service_query_finish (GcWebService  *self,
+                                      GAsyncResult  *result,
+                                      GError       **error);
 gboolean gc_web_service_get_string (GcWebService *self, gchar **value, gchar *xpath);
 gboolean gc_web_service_get_double (GcWebService *self, gdouble *value, gchar *xpath);
+gint gc_web_service_add_field (GcWebService *self, const gchar *xpath);
+gboolean gc_web_service_get_fields (GcWebService *self, gchar **values);
+void gc_web_service_set_streaming (GcWebService *self, gboolean streaming);
 
 gboolean gc_web_service_get_response (GcWebService *self, guchar **response, gint *response_length);
 
@@ -0,0 +1,480 @@
+/*
+ * Geoclue
+ * gc-xml-stream.c - Incremental extraction of fields from XML documents
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * GcXmlStream feeds a document to a libxml SAX2 push parser as it
+ * arrives and keeps only the values of a set of fields, without
+ * building a tree. Fields are given as a subset of XPath that can be
+ * matched against the stack of open elements:
+ *
+ *   /a/b/c   //b/c   /a//c   /a/b[2]/c   /a/*   /a/b/@attr   ns:a
+ *
+ * Like XPath, an element selects the concatenation of all text inside
+ * it and only the first match of a field is kept. Unprefixed names
+ * match elements without a namespace; prefixes are resolved with the
+ * namespaces table.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <libxml/parser.h>
+
+#include "gc-xml-stream.h"
+#include "geoclue-error.h"
+
+typedef struct _GcXmlStep {
+	gboolean descendant;  /* preceded by "//" */
+	gchar *prefix;        /* NULL for no namespace */
+	gchar *name;          /* local name or "*" */
+	guint position;       /* [n], 0 if none */
+} GcXmlStep;
+
+struct _GcXmlPath {
+	GcXmlStep *steps;
+	guint n_steps;
+	gchar *attribute;     /* NULL if the path selects an element */
+};
+
+typedef struct _GcXmlFrame {
+	gchar *uri;
+	gchar *name;
+	guint position;            /* among siblings with the same name */
+	GHashTable *child_counts;  /* "{uri}name" -> count, created lazily */
+} GcXmlFrame;
+
+struct _GcXmlStream {
+	xmlParserCtxtPtr parser;
+	GcXmlPath **paths;
+	guint n_paths;
+	GHashTable *namespaces;    /* prefix -> uri */
+
+	GPtrArray *frames;         /* open elements, root first */
+	GHashTable *root_counts;
+	gchar **values;
+	GString **captures;        /* text of fields being collected */
+	guint *capture_depth;
+	guint n_found;
+	gboolean done;
+};
+
+static gboolean
+gc_xml_is_name_char (gchar c)
+{
+	return g_ascii_isalnum (c) || c == '_' || c == '-' || c == '.';
+}
+
+static void
+gc_xml_steps_free (GcXmlStep *steps, guint n_steps)
+{
+	guint i;
+
+	for (i = 0; i < n_steps; i++) {
+		g_free (steps[i].prefix);
+		g_free (steps[i].name);
+	}
+	g_free (steps);
+}
+
+/* Parse xpath, NULL if it is not in the supported subset */
+GcXmlPath *
+gc_xml_path_new (const gchar *xpath)
+{
+	GArray *steps;
+	GcXmlPath *path;
+	GcXmlStep step;
+	gchar *attribute = NULL, *end;
+	const gchar *p = xpath, *start, *colon;
+	guint n_steps;
+
+	steps = g_array_new (FALSE, TRUE, sizeof (GcXmlStep));
+
+	while (*p) {
+		memset (&step, 0, sizeof (step));
+		if (p[0] != '/') {
+			goto unsupported;
+		}
+		if (p[1] == '/') {
+			step.descendant = TRUE;
+			p += 2;
+		} else {
+			p += 1;
+		}
+
+		if (*p == '@') {
+			if (step.descendant || steps->len == 0) {
+				goto unsupported;
+			}
+			start = ++p;
+			while (gc_xml_is_name_char (*p)) {
+				p++;
+			}
+			if (p == start || *p != '\0') {
+				goto unsupported;
+			}
+			attribute = g_strndup (start, p - start);
+			break;
+		}
+
+		start = p;
+		colon = NULL;
+		if (*p == '*') {
+			p++;
+		} else {
+			while (gc_xml_is_name_char (*p) || (*p == ':' && !colon)) {
+				if (*p == ':') {
+					colon = p;
+				}
+				p++;
+			}
+		}
+		if (p == start || colon == start || colon == p - 1) {
+			goto unsupported;
+		}
+		if (colon) {
+			step.prefix = g_strndup (start, colon - start);
+			step.name = g_strndup (colon + 1, p - colon - 1);
+		} else {
+			step.name = g_strndup (start, p - start);
+		}
+
+		if (*p == '[') {
+			step.position = strtoul (p + 1, &end, 10);
+			if (end == p + 1 || *end != ']' || step.position == 0) {
+				g_free (step.prefix);
+				g_free (step.name);
+				goto unsupported;
+			}
+			p = end + 1;
+		}
+		if (*p != '\0' && *p != '/') {
+			g_free (step.prefix);
+			g_free (step.name);
+			goto unsupported;
+		}
+		g_array_append_val (steps, step);
+	}
+
+	if (steps->len == 0) {
+		goto unsupported;
+	}
+
+	path = g_new0 (GcXmlPath, 1);
+	path->n_steps = steps->len;
+	path->steps = (GcXmlStep *)g_array_free (steps, FALSE);
+	path->attribute = attribute;
+	return path;
+
+unsupported:
+	n_steps = steps->len;
+	gc_xml_steps_free ((GcXmlStep *)g_array_free (steps, FALSE), n_steps);
+	g_free (attribute);
+	return NULL;
+}
+
+void
+gc_xml_path_free (GcXmlPath *path)
+{
+	gc_xml_steps_free (path->steps, path->n_steps);
+	g_free (path->attribute);
+	g_free (path);
+}
+
+static gboolean
+gc_xml_step_matches (GcXmlStream *stream, GcXmlStep *step, GcXmlFrame *frame)
+{
+	const gchar *uri = NULL;
+
+	if (step->prefix) {
+		uri = g_hash_table_lookup (stream->namespaces, step->prefix);
+		if (!uri) {
+			return FALSE;
+		}
+	}
+	if (g_strcmp0 (uri, frame->uri) != 0) {
+		return FALSE;
+	}
+	if (strcmp (step->name, "*") != 0 && strcmp (step->name, frame->name) != 0) {
+		return FALSE;
+	}
+	return (step->position == 0 || step->position == frame->position);
+}
+
+/* Do steps from step on match the open elements from frame on,
+ * ending at the innermost one? */
+static gboolean
+gc_xml_stream_match (GcXmlStream *stream, GcXmlPath *path,
+                     guint step, guint frame)
+{
+	guint f;
+
+	if (step == path->n_steps) {
+		return (frame == stream->frames->len);
+	}
+	if (frame >= stream->frames->len) {
+		return FALSE;
+	}
+
+	if (path->steps[step].descendant) {
+		for (f = frame; f < stream->frames->len; f++) {
+			if (gc_xml_step_matches (stream, &path->steps[step],
+			                         g_ptr_array_index (stream->frames, f)) &&
+			    gc_xml_stream_match (stream, path, step + 1, f + 1)) {
+				return TRUE;
+			}
+		}
+		return FALSE;
+	}
+
+	return (gc_xml_step_matches (stream, &path->steps[step],
+	                             g_ptr_array_index (stream->frames, frame)) &&
+	        gc_xml_stream_match (stream, path, step + 1, frame + 1));
+}
+
+static void
+gc_xml_frame_free (GcXmlFrame *frame)
+{
+	g_free (frame->uri);
+	g_free (frame->name);
+	if (frame->child_counts) {
+		g_hash_table_destroy (frame->child_counts);
+	}
+	g_free (frame);
+}
+
+static void
+gc_xml_stream_found (GcXmlStream *stream, guint i, gchar *value)
+{
+	stream->values[i] = value;
+	stream->n_found++;
+	if (stream->n_found == stream->n_paths) {
+		/* nothing more to look for */
+		stream->done = TRUE;
+		xmlStopParser (stream->parser);
+	}
+}
+
+static void
+gc_xml_stream_start_element (void           *ctx,
+                             const xmlChar  *localname,
+                             const xmlChar  *prefix,
+                             const xmlChar  *uri,
+                             int             nb_namespaces,
+                             const xmlChar **namespaces,
+                             int             nb_attributes,
+                             int             nb_defaulted,
+                             const xmlChar **attributes)
+{
+	GcXmlStream *stream = ctx;
+	GcXmlFrame *frame, *parent;
+	GHashTable *counts;
+	gchar *key;
+	guint i;
+	int a;
+
+	parent = stream->frames->len > 0 ?
+		g_ptr_array_index (stream->frames, stream->frames->len - 1) : NULL;
+	if (parent) {
+		if (!parent->child_counts) {
+			parent->child_counts = g_hash_table_new_full (g_str_hash, g_str_equal,
+			                                              g_free, NULL);
+		}
+		counts = parent->child_counts;
+	} else {
+		counts = stream->root_counts;
+	}
+
+	frame = g_new0 (GcXmlFrame, 1);
+	frame->uri = g_strdup ((const gchar *)uri);
+	frame->name = g_strdup ((const gchar *)localname);
+	key = g_strdup_printf ("{%s}%s", uri ? (const gchar *)uri : "", localname);
+	frame->position = GPOINTER_TO_UINT (g_hash_table_lookup (counts, key)) + 1;
+	g_hash_table_insert (counts, key, GUINT_TO_POINTER (frame->position));
+	g_ptr_array_add (stream->frames, frame);
+
+	for (i = 0; i < stream->n_paths && !stream->done; i++) {
+		GcXmlPath *path = stream->paths[i];
+
+		if (stream->values[i] || stream->captures[i] ||
+		    !gc_xml_stream_match (stream, path, 0, 0)) {
+			continue;
+		}
+
+		if (!path->attribute) {
+			stream->captures[i] = g_string_new ("");
+			stream->capture_depth[i] = stream->frames->len;
+			continue;
+		}
+
+		/* localname, prefix, URI, value, end */
+		for (a = 0; a < nb_attributes; a++) {
+			const xmlChar **attr = attributes + a * 5;
+
+			if (attr[2] == NULL &&
+			    strcmp ((const gchar *)attr[0], path->attribute) == 0) {
+				gc_xml_stream_found (stream, i,
+				                     g_strndup ((const gchar *)attr[3],
+				                                attr[4] - attr[3]));
+				break;
+			}
+		}
+	}
+}
+
+static void
+gc_xml_stream_end_element (void          *ctx,
+                           const xmlChar *localname,
+                           const xmlChar *prefix,
+                           const xmlChar *uri)
+{
+	GcXmlStream *stream = ctx;
+	guint i;
+
+	for (i = 0; i < stream->n_paths && !stream->done; i++) {
+		if (stream->captures[i] &&
+		    stream->capture_depth[i] == stream->frames->len) {
+			gc_xml_stream_found (stream, i,
+			                     g_string_free (stream->captures[i], FALSE));
+			stream->captures[i] = NULL;
+		}
+	}
+
+	if (stream->frames->len > 0) {
+		gc_xml_frame_free (g_ptr_array_remove_index (stream->frames,
+		                                             stream->frames->len - 1));
+	}
+}
+
+static void
+gc_xml_stream_characters (void *ctx, const xmlChar *ch, int len)
+{
+	GcXmlStream *stream = ctx;
+	guint i;
+
+	for (i = 0; i < stream->n_paths; i++) {
+		if (stream->captures[i]) {
+			g_string_append_len (stream->captures[i], (const gchar *)ch, len);
+		}
+	}
+}
+
+/* paths are borrowed and must stay alive until the stream is freed */
+GcXmlStream *
+gc_xml_stream_new (GcXmlPath  **paths,
+                   guint        n_paths,
+                   GHashTable  *namespaces)
+{
+	GcXmlStream *stream;
+	xmlSAXHandler sax;
+
+	stream = g_new0 (GcXmlStream, 1);
+	stream->paths = paths;
+	stream->n_paths = n_paths;
+	stream->namespaces = g_hash_table_ref (namespaces);
+	stream->frames = g_ptr_array_new ();
+	stream->root_counts = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                             g_free, NULL);
+	stream->values = g_new0 (gchar *, n_paths + 1);
+	stream->captures = g_new0 (GString *, n_paths);
+	stream->capture_depth = g_new0 (guint, n_paths);
+	stream->done = (n_paths == 0);
+
+	memset (&sax, 0, sizeof (sax));
+	sax.initialized = XML_SAX2_MAGIC;
+	sax.startElementNs = gc_xml_stream_start_element;
+	sax.endElementNs = gc_xml_stream_end_element;
+	sax.characters = gc_xml_stream_characters;
+	sax.cdataBlock = gc_xml_stream_characters;
+
+	stream->parser = xmlCreatePushParserCtxt (&sax, stream, NULL, 0, NULL);
+	/* never touch the network, and leave entities unexpanded: a
+	 * response has no business declaring them */
+#if LIBXML_VERSION >= 21300
+	xmlCtxtUseOptions (stream->parser, XML_PARSE_NONET | XML_PARSE_NO_XXE);
+#else
+	xmlCtxtUseOptions (stream->parser, XML_PARSE_NONET);
+#endif
+
+	return stream;
+}
+
+/* Parse the next piece of the document, terminate with the last one */
+gboolean
+gc_xml_stream_push (GcXmlStream  *stream,
+                    const gchar  *data,
+                    gsize         length,
+                    gboolean      terminate,
+                    GError      **error)
+{
+	if (stream->done) {
+		return TRUE;
+	}
+
+	if (xmlParseChunk (stream->parser, data, length, terminate) != 0 &&
+	    !stream->done) {
+		g_set_error_literal (error, GEOCLUE_ERROR,
+		                     GEOCLUE_ERROR_FAILED,
+		                     "Could not parse response");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Returns an array with a newly allocated string or NULL for each
+ * path. Fields still being collected are dropped. */
+gchar **
+gc_xml_stream_steal_values (GcXmlStream *stream)
+{
+	gchar **values = stream->values;
+
+	stream->values = g_new0 (gchar *, stream->n_paths + 1);
+	return values;
+}
+
+void
+gc_xml_stream_free (GcXmlStream *stream)
+{
+	guint i;
+
+	for (i = 0; i < stream->n_paths; i++) {
+		g_free (stream->values[i]);
+		if (stream->captures[i]) {
+			g_string_free (stream->captures[i], TRUE);
+		}
+	}
+	g_free (stream->values);
+	g_free (stream->captures);
+	g_free (stream->capture_depth);
+
+	g_ptr_array_foreach (stream->frames, (GFunc)gc_xml_frame_free, NULL);
+	g_ptr_array_free (stream->frames, TRUE);
+	g_hash_table_destroy (stream->root_counts);
+	g_hash_table_unref (stream->namespaces);
+
+	if (stream->parser->myDoc) {
+		xmlFreeDoc (stream->parser->myDoc);
+	}
+	xmlFreeParserCtxt (stream->parser);
+	g_free (stream);
+}
@@ -0,0 +1,50 @@
+/*
+ * Geoclue
+ * gc-xml-stream.h - Incremental extraction of fields from XML documents
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/* Private to libgeoclue, used by GcWebService. Not installed. */
+
+#ifndef GC_XML_STREAM_H
+#define GC_XML_STREAM_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GcXmlPath GcXmlPath;
+typedef struct _GcXmlStream GcXmlStream;
+
+GcXmlPath *gc_xml_path_new (const gchar *xpath);
+void gc_xml_path_free (GcXmlPath *path);
+
+GcXmlStream *gc_xml_stream_new (GcXmlPath  **paths,
+                                guint        n_paths,
+                                GHashTable  *namespaces);
+gboolean gc_xml_stream_push (GcXmlStream  *stream,
+                             const gchar  *data,
+                             gsize         length,
+                             gboolean      terminate,
+                             GError      **error);
+gchar **gc_xml_stream_steal_values (GcXmlStream *stream);
+void gc_xml_stream_free (GcXmlStream *stream);
+
+G_END_DECLS
+
+#endif /* GC_XML_STREAM_H */
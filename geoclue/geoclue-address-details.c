@@ -23,6 +23,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 
 char *countries[][2] = {
@@ -413,3 +414,206 @@ geoclue_address_details_get_accuracy_level (GHashTable *address)
 	}
 	return GEOCLUE_ACCURACY_LEVEL_NONE;
 }
+
+/* in GeoclueAddressField order */
+static const char *address_keys[GEOCLUE_ADDRESS_N_FIELDS] = {
+	GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
+	GEOCLUE_ADDRESS_KEY_COUNTRY,
+	GEOCLUE_ADDRESS_KEY_REGION,
+	GEOCLUE_ADDRESS_KEY_LOCALITY,
+	GEOCLUE_ADDRESS_KEY_AREA,
+	GEOCLUE_ADDRESS_KEY_POSTALCODE,
+	GEOCLUE_ADDRESS_KEY_STREET,
+};
+
+#define FIELD_BIT(field) (1 << (GEOCLUE_ADDRESS_FIELD_##field))
+
+/* values: GEOCLUE_ADDRESS_N_FIELDS strings or NULLs */
+static GeoclueAddressDetails *
+address_details_new (const char * const *values)
+{
+	GeoclueAddressDetails *details;
+	gsize lengths[GEOCLUE_ADDRESS_N_FIELDS];
+	gsize size = sizeof (GeoclueAddressDetails);
+	char *block;
+	int i;
+	
+	for (i = 0; i < GEOCLUE_ADDRESS_N_FIELDS; i++) {
+		if (values[i]) {
+			lengths[i] = strlen (values[i]) + 1;
+			size += lengths[i];
+		}
+	}
+	
+	/* the strings are stored right after the struct */
+	details = g_malloc (size);
+	details->fields = 0;
+	details->ref_count = 1;
+	details->hash = NULL;
+	block = (char *)(details + 1);
+	for (i = 0; i < GEOCLUE_ADDRESS_N_FIELDS; i++) {
+		if (values[i]) {
+			memcpy (block, values[i], lengths[i]);
+			details->values[i] = block;
+			details->fields |= 1 << i;
+			block += lengths[i];
+		} else {
+			details->values[i] = NULL;
+		}
+	}
+	return details;
+}
+
+/**
+ * geoclue_address_details_from_hash:
+ * @address: #GHashTable with address data, or %NULL for an empty address
+ * 
+ * Creates a compact copy of @address. Keys that are not one of 
+ * GEOCLUE_ADDRESS_KEY_* are ignored.
+ * 
+ * Return value: New #GeoclueAddressDetails with a reference count 
+ * of one, release it with geoclue_address_details_unref()
+ */
+GeoclueAddressDetails *
+geoclue_address_details_from_hash (GHashTable *address)
+{
+	const char *values[GEOCLUE_ADDRESS_N_FIELDS];
+	int i;
+	
+	for (i = 0; i < GEOCLUE_ADDRESS_N_FIELDS; i++) {
+		values[i] = address ? 
+			g_hash_table_lookup (address, address_keys[i]) : NULL;
+	}
+	return address_details_new (values);
+}
+
+/**
+ * geoclue_address_details_ref:
+ * @details: A #GeoclueAddressDetails
+ * 
+ * Adds a reference to @details.
+ * 
+ * Return value: @details
+ */
+GeoclueAddressDetails *
+geoclue_address_details_ref (GeoclueAddressDetails *details)
+{
+	g_return_val_if_fail (details != NULL, NULL);
+	
+	details->ref_count++;
+	return details;
+}
+
+/**
+ * geoclue_address_details_unref:
+ * @details: A #GeoclueAddressDetails
+ * 
+ * Drops a reference to @details. When the last one is dropped, 
+ * @details and its strings are freed.
+ */
+void
+geoclue_address_details_unref (GeoclueAddressDetails *details)
+{
+	g_return_if_fail (details != NULL);
+	
+	if (--details->ref_count > 0) {
+		return;
+	}
+	if (details->hash) {
+		g_hash_table_unref (details->hash);
+	}
+	g_free (details);
+}
+
+/**
+ * geoclue_address_details_to_hash:
+ * @details: A #GeoclueAddressDetails
+ * 
+ * Creates a #GHashTable with the set fields of @details, suitable 
+ * for sending over D-Bus.
+ * 
+ * Return value: New #GHashTable, see geoclue_address_details_new()
+ */
+GHashTable *
+geoclue_address_details_to_hash (const GeoclueAddressDetails *details)
+{
+	GHashTable *address;
+	int i;
+	
+	address = geoclue_address_details_new ();
+	for (i = 0; i < GEOCLUE_ADDRESS_N_FIELDS; i++) {
+		if (details->values[i]) {
+			geoclue_address_details_insert (address, 
+			                                address_keys[i],
+			                                details->values[i]);
+		}
+	}
+	return address;
+}
+
+/**
+ * geoclue_address_details_get_hash:
+ * @details: A #GeoclueAddressDetails
+ * 
+ * Like geoclue_address_details_to_hash(), but the table is only 
+ * built on the first call and then shared by all callers. It must 
+ * not be modified. Use g_hash_table_ref() to keep it after @details 
+ * is released.
+ * 
+ * Return value: #GHashTable owned by @details
+ */
+GHashTable *
+geoclue_address_details_get_hash (GeoclueAddressDetails *details)
+{
+	g_return_val_if_fail (details != NULL, NULL);
+	
+	if (!details->hash) {
+		details->hash = geoclue_address_details_to_hash (details);
+	}
+	return details->hash;
+}
+
+/**
+ * geoclue_address_details_get:
+ * @details: A #GeoclueAddressDetails
+ * @field: the field to get
+ * 
+ * Return value: value of @field, or NULL if it is not set. 
+ * The string is owned by @details.
+ */
+const char *
+geoclue_address_details_get (const GeoclueAddressDetails *details,
+                             GeoclueAddressField          field)
+{
+	g_return_val_if_fail (field < GEOCLUE_ADDRESS_N_FIELDS, NULL);
+	
+	return details->values[field];
+}
+
+/**
+ * geoclue_address_details_get_level:
+ * @details: A #GeoclueAddressDetails
+ * 
+ * Like geoclue_address_details_get_accuracy_level(), but only 
+ * checks the field mask.
+ * 
+ * Return value: #GeoclueAccuracyLevel
+ */
+GeoclueAccuracyLevel
+geoclue_address_details_get_level (const GeoclueAddressDetails *details)
+{
+	guint fields = details->fields;
+	
+	if (fields & FIELD_BIT (STREET)) {
+		return GEOCLUE_ACCURACY_LEVEL_STREET;
+	} else if (fields & FIELD_BIT (POSTALCODE)) {
+		return GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
+	} else if (fields & FIELD_BIT (LOCALITY)) {
+		return GEOCLUE_ACCURACY_LEVEL_LOCALITY;
+	} else if (fields & FIELD_BIT (REGION)) {
+		return GEOCLUE_ACCURACY_LEVEL_REGION;
+	} else if (fields & (FIELD_BIT (COUNTRY) | FIELD_BIT (COUNTRYCODE))) {
+		return GEOCLUE_ACCURACY_LEVEL_COUNTRY;
+	}
+	return GEOCLUE_ACCURACY_LEVEL_NONE;
+}
@@ -36,4 +36,62 @@ void geoclue_address_details_set_country_from_code (GHashTable *address);
 
 GeoclueAccuracyLevel geoclue_address_details_get_accuracy_level (GHashTable *address);
 
+/**
+ * GeoclueAddressField:
+ * @GEOCLUE_ADDRESS_FIELD_COUNTRYCODE: GEOCLUE_ADDRESS_KEY_COUNTRYCODE
+ * @GEOCLUE_ADDRESS_FIELD_COUNTRY: GEOCLUE_ADDRESS_KEY_COUNTRY
+ * @GEOCLUE_ADDRESS_FIELD_REGION: GEOCLUE_ADDRESS_KEY_REGION
+ * @GEOCLUE_ADDRESS_FIELD_LOCALITY: GEOCLUE_ADDRESS_KEY_LOCALITY
+ * @GEOCLUE_ADDRESS_FIELD_AREA: GEOCLUE_ADDRESS_KEY_AREA
+ * @GEOCLUE_ADDRESS_FIELD_POSTALCODE: GEOCLUE_ADDRESS_KEY_POSTALCODE
+ * @GEOCLUE_ADDRESS_FIELD_STREET: GEOCLUE_ADDRESS_KEY_STREET
+ * @GEOCLUE_ADDRESS_N_FIELDS: Number of fields
+ *
+ * Slots of a #GeoclueAddressDetails.
+ */
+typedef enum {
+	GEOCLUE_ADDRESS_FIELD_COUNTRYCODE,
+	GEOCLUE_ADDRESS_FIELD_COUNTRY,
+	GEOCLUE_ADDRESS_FIELD_REGION,
+	GEOCLUE_ADDRESS_FIELD_LOCALITY,
+	GEOCLUE_ADDRESS_FIELD_AREA,
+	GEOCLUE_ADDRESS_FIELD_POSTALCODE,
+	GEOCLUE_ADDRESS_FIELD_STREET,
+	GEOCLUE_ADDRESS_N_FIELDS
+} GeoclueAddressField;
+
+/**
+ * GeoclueAddressDetails:
+ * @fields: mask of the set fields, bit n is (1 << #GeoclueAddressField n)
+ * @values: field values, NULL if not set
+ *
+ * Compact, read-only form of an address. The struct and all the
+ * strings are one allocation. It is reference counted, so one 
+ * address can be shared instead of copied: see 
+ * geoclue_address_details_ref() and geoclue_address_details_unref().
+ */
+typedef struct {
+	guint fields;
+	const char *values[GEOCLUE_ADDRESS_N_FIELDS];
+	
+	/*< private >*/
+	int ref_count;
+	GHashTable *hash;
+} GeoclueAddressDetails;
+
+GeoclueAddressDetails *geoclue_address_details_from_hash (GHashTable *address);
+
+GeoclueAddressDetails *geoclue_address_details_ref (GeoclueAddressDetails *details);
+
+void geoclue_address_details_unref (GeoclueAddressDetails *details);
+
+GHashTable *geoclue_address_details_to_hash (const GeoclueAddressDetails *details);
+
+GHashTable *geoclue_address_details_get_hash (GeoclueAddressDetails *details);
+
+const char *geoclue_address_details_get (const GeoclueAddressDetails *details,
+                                         GeoclueAddressField          field);
+
+GeoclueAccuracyLevel geoclue_address_details_get_level (const GeoclueAddressDetails *details);
+
 #endif
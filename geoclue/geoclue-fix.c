@@ -0,0 +1,179 @@
+/*
+ * Geoclue
+ * geoclue-fix.c - Client API for accessing GcIfaceFix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * SECTION:geoclue-fix
+ * @short_description: Geoclue combined position and velocity client API
+ *
+ * #GeoclueFix delivers the position and the velocity of a provider
+ * together, in one D-Bus message per fix. It is part of the Geoclue
+ * public C client API which uses D-Bus to communicate with the actual
+ * provider.
+ *
+ * Only providers that implement both the position and the velocity
+ * interface, such as GPS providers and the master client, support it.
+ * A client that needs both connects to the position-and-velocity-changed
+ * signal of a #GeoclueFix instead of using a #GeocluePosition and a
+ * #GeoclueVelocity. Use those for the current values.
+ */
+
+#include <geoclue/geoclue-fix.h>
+#include <geoclue/geoclue-marshal.h>
+
+typedef struct _GeoclueFixPrivate {
+	int dummy;
+} GeoclueFixPrivate;
+
+enum {
+	POSITION_AND_VELOCITY_CHANGED,
+	LAST_SIGNAL
+};
+
+static guint32 signals[LAST_SIGNAL] = {0, };
+
+#define GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), GEOCLUE_TYPE_FIX, GeoclueFixPrivate))
+
+G_DEFINE_TYPE (GeoclueFix, geoclue_fix, GEOCLUE_TYPE_PROVIDER);
+
+static void
+finalize (GObject *object)
+{
+	G_OBJECT_CLASS (geoclue_fix_parent_class)->finalize (object);
+}
+
+static void
+dispose (GObject *object)
+{
+	G_OBJECT_CLASS (geoclue_fix_parent_class)->dispose (object);
+}
+
+static void
+position_and_velocity_changed (DBusGProxy      *proxy,
+			       int              position_fields,
+			       int              velocity_fields,
+			       int              timestamp,
+			       double           latitude,
+			       double           longitude,
+			       double           altitude,
+			       double           speed,
+			       double           direction,
+			       double           climb,
+			       GeoclueAccuracy *accuracy,
+			       GeoclueFix      *fix)
+{
+	g_signal_emit (fix, signals[POSITION_AND_VELOCITY_CHANGED], 0,
+		       position_fields, velocity_fields, timestamp,
+		       latitude, longitude, altitude,
+		       speed, direction, climb, accuracy);
+}
+
+static GObject *
+constructor (GType                  type,
+	     guint                  n_props,
+	     GObjectConstructParam *props)
+{
+	GObject *object;
+	GeoclueProvider *provider;
+
+	object = G_OBJECT_CLASS (geoclue_fix_parent_class)->constructor
+		(type, n_props, props);
+	provider = GEOCLUE_PROVIDER (object);
+
+	dbus_g_proxy_add_signal (provider->proxy, "PositionAndVelocityChanged",
+				 G_TYPE_INT, G_TYPE_INT, G_TYPE_INT,
+				 G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE,
+				 G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE,
+				 GEOCLUE_ACCURACY_TYPE,
+				 G_TYPE_INVALID);
+	dbus_g_proxy_connect_signal (provider->proxy, "PositionAndVelocityChanged",
+				     G_CALLBACK (position_and_velocity_changed),
+				     object, NULL);
+
+	return object;
+}
+
+static void
+geoclue_fix_class_init (GeoclueFixClass *klass)
+{
+	GObjectClass *o_class = (GObjectClass *) klass;
+
+	o_class->finalize = finalize;
+	o_class->dispose = dispose;
+	o_class->constructor = constructor;
+
+	g_type_class_add_private (klass, sizeof (GeoclueFixPrivate));
+
+	/**
+	 * GeoclueFix::position-and-velocity-changed:
+	 * @fix: the #GeoclueFix object emitting the signal
+	 * @position_fields: A #GeocluePositionFields bitfield representing the validity of the position values
+	 * @velocity_fields: A #GeoclueVelocityFields bitfield representing the validity of the velocity values
+	 * @timestamp: Time of measurement (Unix timestamp)
+	 * @latitude: Latitude in degrees
+	 * @longitude: Longitude in degrees
+	 * @altitude: Altitude in meters
+	 * @speed: horizontal speed
+	 * @direction: horizontal direction (bearing)
+	 * @climb: vertical speed
+	 * @accuracy: Accuracy of measurement as #GeoclueAccuracy
+	 *
+	 * The position-and-velocity-changed signal is emitted with a complete
+	 * fix each time the position or the velocity changes.
+	 */
+	signals[POSITION_AND_VELOCITY_CHANGED] = g_signal_new ("position-and-velocity-changed",
+							       G_TYPE_FROM_CLASS (klass),
+							       G_SIGNAL_RUN_FIRST |
+							       G_SIGNAL_NO_RECURSE,
+							       G_STRUCT_OFFSET (GeoclueFixClass, position_and_velocity_changed),
+							       NULL, NULL,
+							       geoclue_marshal_VOID__INT_INT_INT_DOUBLE_DOUBLE_DOUBLE_DOUBLE_DOUBLE_DOUBLE_BOXED,
+							       G_TYPE_NONE, 10,
+							       G_TYPE_INT, G_TYPE_INT, G_TYPE_INT,
+							       G_TYPE_DOUBLE, G_TYPE_DOUBLE,
+							       G_TYPE_DOUBLE, G_TYPE_DOUBLE,
+							       G_TYPE_DOUBLE, G_TYPE_DOUBLE,
+							       G_TYPE_POINTER);
+}
+
+static void
+geoclue_fix_init (GeoclueFix *fix)
+{
+}
+
+/**
+ * geoclue_fix_new:
+ * @service: D-Bus service name
+ * @path: D-Bus path name
+ *
+ * Creates a #GeoclueFix with given D-Bus service name and path.
+ *
+ * Return value: Pointer to a new #GeoclueFix
+ */
+GeoclueFix *
+geoclue_fix_new (const char *service,
+		 const char *path)
+{
+	return g_object_new (GEOCLUE_TYPE_FIX,
+			     "service", service,
+			     "path", path,
+			     "interface", GEOCLUE_FIX_INTERFACE_NAME,
+			     NULL);
+}
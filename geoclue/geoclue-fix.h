@@ -0,0 +1,64 @@
+/*
+ * Geoclue
+ * geoclue-fix.h -
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _GEOCLUE_FIX_H
+#define _GEOCLUE_FIX_H
+
+#include <geoclue/geoclue-provider.h>
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+G_BEGIN_DECLS
+
+#define GEOCLUE_TYPE_FIX (geoclue_fix_get_type ())
+#define GEOCLUE_FIX(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GEOCLUE_TYPE_FIX, GeoclueFix))
+#define GEOCLUE_IS_FIX(obj) (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEOCLUE_TYPE_FIX))
+
+#define GEOCLUE_FIX_INTERFACE_NAME "org.freedesktop.Geoclue.Fix"
+
+typedef struct _GeoclueFix {
+	GeoclueProvider provider;
+} GeoclueFix;
+
+typedef struct _GeoclueFixClass {
+	GeoclueProviderClass provider_class;
+
+	void (* position_and_velocity_changed) (GeoclueFix           *fix,
+						GeocluePositionFields position_fields,
+						GeoclueVelocityFields velocity_fields,
+						int                   timestamp,
+						double                latitude,
+						double                longitude,
+						double                altitude,
+						double                speed,
+						double                direction,
+						double                climb,
+						GeoclueAccuracy      *accuracy);
+} GeoclueFixClass;
+
+GType geoclue_fix_get_type (void);
+
+GeoclueFix *geoclue_fix_new (const char *service,
+			     const char *path);
+
+G_END_DECLS
+
+#endif
@@ -36,7 +36,8 @@
  * geoclue_geocode_address_to_position(),
  * geoclue_geocode_freeform_address_to_position() methods and their
  * asynchronous counterparts can be used to obtain the position (coordinates)
- * of the given address.
+ * of the given address. geoclue_geocode_addresses_to_positions() geocodes
+ * many addresses with a single D-Bus call.
  * 
  * Address #GHashTable keys are defined in 
  * <ulink url="geoclue-types.html">geoclue-types.h</ulink>. See also 
@@ -333,3 +334,152 @@ geoclue_geocode_freeform_address_to_position_async (GeoclueGeocode         *geoc
 			 data);
 }
 
+
+/* Converts the D-Bus a(iddd(idd)) reply to GeoclueGeocodeResults,
+ * freeing @values */
+static GPtrArray *
+results_from_values (GPtrArray *values)
+{
+	GPtrArray *results;
+	guint i;
+
+	results = g_ptr_array_sized_new (values->len);
+	for (i = 0; i < values->len; i++) {
+		GValueArray *vals = values->pdata[i];
+		GeoclueGeocodeResult *result;
+
+		result = g_new0 (GeoclueGeocodeResult, 1);
+		result->fields = g_value_get_int (g_value_array_get_nth (vals, 0));
+		result->latitude = g_value_get_double (g_value_array_get_nth (vals, 1));
+		result->longitude = g_value_get_double (g_value_array_get_nth (vals, 2));
+		result->altitude = g_value_get_double (g_value_array_get_nth (vals, 3));
+		result->accuracy = geoclue_accuracy_copy 
+			(g_value_get_boxed (g_value_array_get_nth (vals, 4)));
+		g_ptr_array_add (results, result);
+
+		g_value_array_free (vals);
+	}
+	g_ptr_array_free (values, TRUE);
+
+	return results;
+}
+
+/**
+ * geoclue_geocode_addresses_to_positions:
+ * @geocode: A #GeoclueGeocode object
+ * @addresses: A #GPtrArray of #GHashTable<!-- -->s with address data
+ * @error: Pointer to returned #Gerror or %NULL
+ *
+ * Geocodes all of @addresses with one D-Bus call. This is much faster 
+ * than calling geoclue_geocode_address_to_position() for each address
+ * as the provider may geocode several addresses in parallel.
+ *
+ * see <ulink url="geoclue-types.html">geoclue-types.h</ulink> for the 
+ * hashtable keys usable in @addresses.
+ *
+ * Return value: A #GPtrArray of #GeoclueGeocodeResult<!-- -->s in the 
+ * same order as @addresses, or %NULL on error. Addresses that could not 
+ * be geocoded have %GEOCLUE_POSITION_FIELDS_NONE as fields. Free with
+ * geoclue_geocode_results_free().
+ */
+GPtrArray *
+geoclue_geocode_addresses_to_positions (GeoclueGeocode  *geocode,
+                                        GPtrArray       *addresses,
+                                        GError         **error)
+{
+	GeoclueProvider *provider = GEOCLUE_PROVIDER (geocode);
+	GPtrArray *values;
+
+	if (!org_freedesktop_Geoclue_Geocode_addresses_to_positions
+			(provider->proxy,
+			 addresses, &values,
+			 error)) {
+		return NULL;
+	}
+
+	return results_from_values (values);
+}
+
+static void
+addresses_to_positions_callback (DBusGProxy              *proxy,
+                                 GPtrArray               *values,
+                                 GError                  *error,
+                                 GeoclueGeocodeAsyncData *data)
+{
+	GPtrArray *results = NULL;
+
+	if (!error) {
+		results = results_from_values (values);
+	}
+
+	(*(GeoclueGeocodeBatchCallback)data->callback) (data->geocode,
+	                                                results,
+	                                                error,
+	                                                data->userdata);
+	g_free (data);
+}
+
+/**
+ * GeoclueGeocodeBatchCallback:
+ * @geocode: A #GeoclueGeocode object
+ * @results: A #GPtrArray of #GeoclueGeocodeResult<!-- -->s or %NULL on error. Free with geoclue_geocode_results_free()
+ * @error: Error as #Gerror or %NULL
+ * @userdata: User data pointer
+ *
+ * Callback function for geoclue_geocode_addresses_to_positions_async().
+ */
+
+/**
+ * geoclue_geocode_addresses_to_positions_async:
+ * @geocode: A #GeoclueGeocode object
+ * @addresses: A #GPtrArray of #GHashTable<!-- -->s with address data
+ * @callback: A #GeoclueGeocodeBatchCallback function that should be called when return values are available
+ * @userdata: pointer for user specified data
+ *
+ * Function returns (essentially) immediately and calls @callback when 
+ * all of @addresses have been geocoded or when D-Bus timeouts.
+ */
+void
+geoclue_geocode_addresses_to_positions_async (GeoclueGeocode              *geocode,
+                                              GPtrArray                   *addresses,
+                                              GeoclueGeocodeBatchCallback  callback,
+                                              gpointer                     userdata)
+{
+	GeoclueProvider *provider = GEOCLUE_PROVIDER (geocode);
+	GeoclueGeocodeAsyncData *data;
+
+	data = g_new (GeoclueGeocodeAsyncData, 1);
+	data->geocode = geocode;
+	data->callback = G_CALLBACK (callback);
+	data->userdata = userdata;
+
+	org_freedesktop_Geoclue_Geocode_addresses_to_positions_async
+			(provider->proxy,
+			 addresses,
+			 (org_freedesktop_Geoclue_Geocode_addresses_to_positions_reply)addresses_to_positions_callback,
+			 data);
+}
+
+/**
+ * geoclue_geocode_results_free:
+ * @results: A #GPtrArray of #GeoclueGeocodeResult<!-- -->s
+ *
+ * Frees @results and the #GeoclueGeocodeResult<!-- -->s in it.
+ */
+void
+geoclue_geocode_results_free (GPtrArray *results)
+{
+	guint i;
+
+	if (!results) {
+		return;
+	}
+
+	for (i = 0; i < results->len; i++) {
+		GeoclueGeocodeResult *result = results->pdata[i];
+
+		geoclue_accuracy_free (result->accuracy);
+		g_free (result);
+	}
+	g_ptr_array_free (results, TRUE);
+}
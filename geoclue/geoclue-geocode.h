@@ -48,6 +48,25 @@ typedef struct _GeoclueGeocodeClass {
 	GeoclueProviderClass provider_class;
 } GeoclueGeocodeClass;
 
+/**
+ * GeoclueGeocodeResult:
+ * @fields: A #GeocluePositionFields bitfield representing the validity of the position values
+ * @latitude: Latitude in degrees
+ * @longitude: Longitude in degrees
+ * @altitude: Altitude in meters
+ * @accuracy: Accuracy of the position as #GeoclueAccuracy
+ *
+ * Geocoded position of one address in a batch, see
+ * geoclue_geocode_addresses_to_positions().
+ */
+typedef struct _GeoclueGeocodeResult {
+	GeocluePositionFields fields;
+	double latitude;
+	double longitude;
+	double altitude;
+	GeoclueAccuracy *accuracy;
+} GeoclueGeocodeResult;
+
 GType geoclue_geocode_get_type (void);
 
 GeoclueGeocode *geoclue_geocode_new (const char *service,
@@ -91,6 +110,24 @@ geoclue_geocode_freeform_address_to_position_async (GeoclueGeocode         *geoc
                                                     GeoclueGeocodeCallback  callback,
                                                     gpointer                userdata);
 
+GPtrArray *
+geoclue_geocode_addresses_to_positions (GeoclueGeocode  *geocode,
+                                        GPtrArray       *addresses,
+                                        GError         **error);
+
+typedef void (*GeoclueGeocodeBatchCallback) (GeoclueGeocode *geocode,
+                                             GPtrArray      *results,
+                                             GError         *error,
+                                             gpointer        userdata);
+
+void
+geoclue_geocode_addresses_to_positions_async (GeoclueGeocode              *geocode,
+                                              GPtrArray                   *addresses,
+                                              GeoclueGeocodeBatchCallback  callback,
+                                              gpointer                     userdata);
+
+void geoclue_geocode_results_free (GPtrArray *results);
+
 G_END_DECLS
 
 #endif
@@ -90,6 +90,7 @@ enum {
 	ADDRESS_PROVIDER_CHANGED,
 	POSITION_PROVIDER_CHANGED,
 	INVALIDATED,
+	VELOCITY_PROVIDER_CHANGED,
 	LAST_SIGNAL
 };
 
@@ -173,6 +174,18 @@ position_provider_changed (DBusGProxy          *proxy,
 	               name, description, service, path);
 }
 
+static void
+velocity_provider_changed (DBusGProxy          *proxy,
+                           char                *name,
+                           char                *description, 
+                           char                *service, 
+                           char                *path, 
+                           GeoclueMasterClient *client)
+{
+	g_signal_emit (client, signals[VELOCITY_PROVIDER_CHANGED], 0, 
+	               name, description, service, path);
+}
+
 static void
 proxy_destroyed (DBusGProxy *proxy,
 		 gpointer    user_data)
@@ -235,6 +248,13 @@ constructor (GType                  type,
 	dbus_g_proxy_connect_signal (priv->proxy, "PositionProviderChanged",
 	                             G_CALLBACK (position_provider_changed),
 	                             object, NULL);
+	
+	dbus_g_proxy_add_signal (priv->proxy, "VelocityProviderChanged",
+	                         G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+	                         G_TYPE_INVALID);
+	dbus_g_proxy_connect_signal (priv->proxy, "VelocityProviderChanged",
+	                             G_CALLBACK (velocity_provider_changed),
+	                             object, NULL);
 	return object;
 }
 
@@ -305,6 +325,27 @@ geoclue_master_client_class_init (GeoclueMasterClientClass *klass)
 		              G_TYPE_NONE, 4,
 		              G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
 
+	/**
+	* GeoclueMasterClient::velocity-provider-changed:
+	* @client: the #GeoclueMasterClient object emitting the signal
+	* @name: name of the new provider (e.g. "Gpsd") or %NULL if there is no provider
+	* @description: a short description of the new provider or %NULL if there is no provider
+	* @service: D-Bus service name of the new provider or %NULL if there is no provider
+	* @path: D-Bus object path name of the new provider or %NULL if there is no provider
+	* 
+	* The velocity-provider-changed signal is emitted each time the used velocity provider
+	* changes.
+	**/
+	signals[VELOCITY_PROVIDER_CHANGED] = 
+		g_signal_new ("velocity-provider-changed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_FIRST | G_SIGNAL_NO_RECURSE,
+		              G_STRUCT_OFFSET (GeoclueMasterClientClass, velocity_provider_changed), 
+		              NULL, NULL,
+		              geoclue_marshal_VOID__STRING_STRING_STRING_STRING,
+		              G_TYPE_NONE, 4,
+		              G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+
 	/**
 	* GeoclueMasterClient::invalidated:
 	* @client: the #GeoclueMasterClient object emitting the signal
@@ -385,7 +426,7 @@ set_requirements_callback (DBusGProxy                   *proxy,
  * geoclue_master_client_set_requirements_async:
  * @client: A #GeoclueMasterClient
  * @min_accuracy: The required minimum accuracy as a #GeoclueAccuracyLevel.
- * @min_time: The minimum time between update signals (currently not implemented)
+ * @min_time: The minimum time between update signals in seconds
  * @require_updates: Whether the updates (signals) are required. Only applies to interfaces with signals
  * @allowed_resources: The resources that are allowed to be used as a #GeoclueResourceFlags
  * @callback: #GeoclueSetRequirementsCallback function to call when requirements have been set
@@ -586,6 +627,93 @@ geoclue_master_client_create_position_async (GeoclueMasterClient    *client,
 }
 
 
+/**
+ * geoclue_master_client_create_velocity:
+ * @client: A #GeoclueMasterClient
+ * @error: A pointer to returned #GError or %NULL.
+ *
+ * Starts the GeoclueMasterClient velocity provider and returns 
+ * a #GeoclueVelocity that uses the same D-Bus object as the #GeoclueMasterClient.
+ * 
+ * When position and velocity are started and come from the same 
+ * provider, a #GeoclueFix for the same D-Bus object receives them 
+ * together.
+ *
+ * Return value: New #GeoclueVelocity or %NULL on error
+ */
+GeoclueVelocity *
+geoclue_master_client_create_velocity (GeoclueMasterClient *client,
+                                       GError **error)
+{
+	GeoclueMasterClientPrivate *priv;
+	
+	priv = GET_PRIVATE (client);
+	
+	if (!org_freedesktop_Geoclue_MasterClient_velocity_start (priv->proxy, error)) {
+		return NULL;
+	}
+	return geoclue_velocity_new (GEOCLUE_MASTER_DBUS_SERVICE, priv->object_path);
+}
+
+
+static void
+velocity_start_async_callback (DBusGProxy                   *proxy, 
+			       GError                       *error,
+			       GeoclueMasterClientAsyncData *data)
+{
+	GeoclueMasterClientPrivate *priv = GET_PRIVATE (data->client);
+	GeoclueVelocity *velocity = NULL;
+	
+	if (!error) {
+		velocity = geoclue_velocity_new (GEOCLUE_MASTER_DBUS_SERVICE, priv->object_path);
+	}
+	
+	(*(CreateVelocityCallback)data->callback) (data->client,
+	                                          velocity,
+	                                          error,
+	                                          data->userdata);
+	g_free (data);
+}
+
+/**
+ * CreateVelocityCallback:
+ * @client: A #GeoclueMasterClient object
+ * @velocity: returned #GeoclueVelocity
+ * @error: Error as #Gerror (may be %NULL)
+ * @userdata: User data pointer set in geoclue_master_client_create_velocity_async()
+ * 
+ * Callback function for geoclue_master_client_create_velocity_async().
+ */
+
+/**
+ * geoclue_master_client_create_velocity_async:
+ * @client: A #GeoclueMasterClient object
+ * @callback: A #CreateVelocityCallback function that should be called when return values are available
+ * @userdata: pointer for user specified data
+ * 
+ * Function returns (essentially) immediately and calls @callback when it has started the velocity provider
+ * and a #GeoclueVelocity is available.
+ */
+void 
+geoclue_master_client_create_velocity_async (GeoclueMasterClient    *client,
+					     CreateVelocityCallback  callback,
+					     gpointer                userdata)
+{
+	GeoclueMasterClientPrivate *priv = GET_PRIVATE (client);
+	GeoclueMasterClientAsyncData *data;
+	
+	data = g_new (GeoclueMasterClientAsyncData, 1);
+	data->client = client;
+	data->callback = G_CALLBACK (callback);
+	data->userdata = userdata;
+	
+	org_freedesktop_Geoclue_MasterClient_velocity_start_async
+			(priv->proxy,
+			 (org_freedesktop_Geoclue_MasterClient_velocity_start_reply)velocity_start_async_callback,
+			 data);
+}
+
+
 /**
  * geoclue_master_client_get_address_provider:
  * @client: A #GeoclueMasterClient
@@ -722,3 +850,62 @@ geoclue_master_client_get_position_provider_async (GeoclueMasterClient  *client,
 			 (org_freedesktop_Geoclue_MasterClient_get_position_provider_reply)get_provider_callback,
 			 data);
 }
+
+
+/**
+ * geoclue_master_client_get_velocity_provider:
+ * @client: A #GeoclueMasterClient
+ * @name: Pointer to returned provider name or %NULL
+ * @description: Pointer to returned provider description or %NULL
+ * @service: Pointer to returned D-Bus service name or %NULL
+ * @path: Pointer to returned D-Bus object path or %NULL
+ * @error: Pointer to returned #GError or %NULL
+ * 
+ * Gets name and other information for the currently used velocity provider.
+ * 
+ * Return value: %TRUE on success
+ */
+gboolean geoclue_master_client_get_velocity_provider (GeoclueMasterClient  *client,
+                                                      char                **name,
+                                                      char                **description,
+                                                      char                **service,
+                                                      char                **path,
+                                                      GError              **error)
+{
+	GeoclueMasterClientPrivate *priv;
+	
+	priv = GET_PRIVATE (client);
+	if (!org_freedesktop_Geoclue_MasterClient_get_velocity_provider 
+	    (priv->proxy, name, description, service, path, error)) {
+		return FALSE;
+	}
+	
+	return TRUE;
+}
+
+/**
+ * geoclue_master_client_get_velocity_provider_async:
+ * @client: A #GeoclueMasterClient
+ * @callback: A #GeoclueGetProviderCallback function that will be called when return values are available
+ * @userdata: pointer for user specified data
+ * 
+ * Gets name and other information for the currently used velocity provider asynchronously.
+ */
+void 
+geoclue_master_client_get_velocity_provider_async (GeoclueMasterClient  *client,
+                                                   GeoclueGetProviderCallback  callback,
+                                                   gpointer userdata)
+{
+	GeoclueMasterClientPrivate *priv = GET_PRIVATE (client);
+	GeoclueMasterClientAsyncData *data;
+	
+	data = g_new (GeoclueMasterClientAsyncData, 1);
+	data->client = client;
+	data->callback = G_CALLBACK (callback);
+	data->userdata = userdata;
+	
+	org_freedesktop_Geoclue_MasterClient_get_velocity_provider_async
+			(priv->proxy,
+			 (org_freedesktop_Geoclue_MasterClient_get_velocity_provider_reply)get_provider_callback,
+			 data);
+}
@@ -30,6 +30,7 @@
 #include <geoclue/geoclue-accuracy.h>
 #include <geoclue/geoclue-position.h>
 #include <geoclue/geoclue-address.h>
+#include <geoclue/geoclue-velocity.h>
 
 G_BEGIN_DECLS
 
@@ -56,6 +57,11 @@ typedef struct _GeoclueMasterClientClass {
 	                                    char                 *service,
 	                                    char                 *path);
 	void (* invalidated) (GeoclueMasterClient *client);
+	void (* velocity_provider_changed) (GeoclueMasterClient  *client,
+	                                    char                 *name,
+	                                    char                 *description,
+	                                    char                 *service,
+	                                    char                 *path);
 } GeoclueMasterClientClass;
 
 GType geoclue_master_client_get_type (void);
@@ -96,6 +102,15 @@ void geoclue_master_client_create_position_async (GeoclueMasterClient   *client,
 						  CreatePositionCallback  callback,
 						  gpointer               userdata);
 
+GeoclueVelocity *geoclue_master_client_create_velocity (GeoclueMasterClient *client, GError **error);
+typedef void (*CreateVelocityCallback) (GeoclueMasterClient *client,
+					GeoclueVelocity     *velocity,
+					GError              *error,
+					gpointer             userdata);
+void geoclue_master_client_create_velocity_async (GeoclueMasterClient    *client,
+						  CreateVelocityCallback  callback,
+						  gpointer                userdata);
+
 gboolean geoclue_master_client_get_address_provider (GeoclueMasterClient  *client,
                                                      char                **name,
                                                      char                **description,
@@ -123,6 +138,16 @@ void geoclue_master_client_get_position_provider_async (GeoclueMasterClient
                                                        GeoclueGetProviderCallback  callback,
                                                        gpointer userdata);
 
+gboolean geoclue_master_client_get_velocity_provider (GeoclueMasterClient  *client,
+                                                     char                **name,
+                                                     char                **description,
+                                                     char                **service,
+                                                     char                **path,
+                                                     GError              **error);
+void geoclue_master_client_get_velocity_provider_async (GeoclueMasterClient        *client,
+                                                       GeoclueGetProviderCallback  callback,
+                                                       gpointer userdata);
+
 G_END_DECLS
 
 #endif
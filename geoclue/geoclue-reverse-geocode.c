@@ -35,6 +35,8 @@
  * geoclue_reverse_geocode_position_to_address() and 
  * geoclue_reverse_geocode_position_to_address_async() method can be used to 
  * obtain the address of a known position.
+ * geoclue_reverse_geocode_positions_to_addresses() obtains the addresses
+ * of many positions (e.g. a GPS track) with a single D-Bus call.
  */
 
 #include <geoclue/geoclue-reverse-geocode.h>
@@ -206,3 +208,207 @@ geoclue_reverse_geocode_position_to_address_async (GeoclueReverseGeocode
 			 (org_freedesktop_Geoclue_ReverseGeocode_position_to_address_reply)position_to_address_callback,
 			 data);
 }
+
+#define POSITION_TYPE (dbus_g_type_get_struct ("GValueArray", G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_INVALID))
+
+/* Builds the D-Bus a(dd) argument */
+static GPtrArray *
+positions_new (const double *latitudes,
+	       const double *longitudes,
+	       guint         n_positions)
+{
+	GPtrArray *positions;
+	guint i;
+
+	positions = g_ptr_array_sized_new (n_positions);
+	for (i = 0; i < n_positions; i++) {
+		GValue position_struct = {0, };
+
+		g_value_init (&position_struct, POSITION_TYPE);
+		g_value_take_boxed (&position_struct,
+				    dbus_g_type_specialized_construct
+				    (POSITION_TYPE));
+		dbus_g_type_struct_set (&position_struct,
+					0, latitudes[i],
+					1, longitudes[i],
+					G_MAXUINT);
+		g_ptr_array_add (positions, g_value_get_boxed (&position_struct));
+	}
+
+	return positions;
+}
+
+static void
+positions_free (GPtrArray *positions)
+{
+	guint i;
+
+	for (i = 0; i < positions->len; i++) {
+		g_value_array_free (positions->pdata[i]);
+	}
+	g_ptr_array_free (positions, TRUE);
+}
+
+/* Converts the D-Bus a(a{ss}(idd)) reply to GeoclueReverseGeocodeResults,
+ * freeing @values */
+static GPtrArray *
+results_from_values (GPtrArray *values)
+{
+	GPtrArray *results;
+	guint i;
+
+	results = g_ptr_array_sized_new (values->len);
+	for (i = 0; i < values->len; i++) {
+		GValueArray *vals = values->pdata[i];
+		GeoclueReverseGeocodeResult *result;
+
+		result = g_new0 (GeoclueReverseGeocodeResult, 1);
+		result->details = g_value_dup_boxed (g_value_array_get_nth (vals, 0));
+		result->accuracy = g_value_dup_boxed (g_value_array_get_nth (vals, 1));
+		g_ptr_array_add (results, result);
+
+		g_value_array_free (vals);
+	}
+	g_ptr_array_free (values, TRUE);
+
+	return results;
+}
+
+/**
+ * geoclue_reverse_geocode_positions_to_addresses:
+ * @revgeocode: A #GeoclueReverseGeocode object
+ * @latitudes: Array of @n_positions latitudes in degrees
+ * @longitudes: Array of @n_positions longitudes in degrees
+ * @n_positions: Number of positions
+ * @position_accuracy: Accuracy of the given positions
+ * @error: Pointer to returned #Gerror or %NULL
+ *
+ * Obtains addresses for all the given positions with one D-Bus call. 
+ * Positions that are indistinguishable at the level of 
+ * @position_accuracy (e.g. consecutive fixes of a GPS track with 
+ * %GEOCLUE_ACCURACY_LEVEL_STREET) are only looked up once by the 
+ * provider, so a lower accuracy level makes large batches much cheaper.
+ *
+ * Return value: A #GPtrArray of #GeoclueReverseGeocodeResult<!-- -->s
+ * in the same order as the positions, or %NULL on error. Free with
+ * geoclue_reverse_geocode_results_free().
+ */
+GPtrArray *
+geoclue_reverse_geocode_positions_to_addresses (GeoclueReverseGeocode  *revgeocode,
+						const double           *latitudes,
+						const double           *longitudes,
+						guint                   n_positions,
+						GeoclueAccuracy        *position_accuracy,
+						GError                **error)
+{
+	GeoclueProvider *provider = GEOCLUE_PROVIDER (revgeocode);
+	GPtrArray *positions, *values;
+	gboolean success;
+
+	positions = positions_new (latitudes, longitudes, n_positions);
+	success = org_freedesktop_Geoclue_ReverseGeocode_positions_to_addresses
+		(provider->proxy, positions, position_accuracy, &values, error);
+	positions_free (positions);
+
+	if (!success) {
+		return NULL;
+	}
+	return results_from_values (values);
+}
+
+static void
+positions_to_addresses_callback (DBusGProxy                 *proxy,
+				 GPtrArray                  *values,
+				 GError                     *error,
+				 GeoclueRevGeocodeAsyncData *data)
+{
+	GPtrArray *results = NULL;
+
+	if (!error) {
+		results = results_from_values (values);
+	}
+
+	(*(GeoclueReverseGeocodeBatchCallback)data->callback) (data->revgeocode,
+	                                                       results,
+	                                                       error,
+	                                                       data->userdata);
+	g_free (data);
+}
+
+/**
+ * GeoclueReverseGeocodeBatchCallback:
+ * @revgeocode: A #GeoclueReverseGeocode object
+ * @results: A #GPtrArray of #GeoclueReverseGeocodeResult<!-- -->s or %NULL on error. Free with geoclue_reverse_geocode_results_free()
+ * @error: Error as #Gerror (may be %NULL)
+ * @userdata: User data pointer set in geoclue_reverse_geocode_positions_to_addresses_async()
+ *
+ * Callback function for geoclue_reverse_geocode_positions_to_addresses_async().
+ */
+
+/**
+ * geoclue_reverse_geocode_positions_to_addresses_async:
+ * @revgeocode: A #GeoclueReverseGeocode object
+ * @latitudes: Array of @n_positions latitudes in degrees
+ * @longitudes: Array of @n_positions longitudes in degrees
+ * @n_positions: Number of positions
+ * @position_accuracy: Accuracy of the given positions
+ * @callback: A #GeoclueReverseGeocodeBatchCallback function that should be called when return values are available
+ * @userdata: pointer for user specified data
+ *
+ * Function returns (essentially) immediately and calls @callback when 
+ * all the addresses are available or when D-Bus timeouts.
+ */
+void
+geoclue_reverse_geocode_positions_to_addresses_async (GeoclueReverseGeocode             *revgeocode,
+						      const double                      *latitudes,
+						      const double                      *longitudes,
+						      guint                              n_positions,
+						      GeoclueAccuracy                   *position_accuracy,
+						      GeoclueReverseGeocodeBatchCallback callback,
+						      gpointer                           userdata)
+{
+	GeoclueProvider *provider = GEOCLUE_PROVIDER (revgeocode);
+	GeoclueRevGeocodeAsyncData *data;
+	GPtrArray *positions;
+
+	data = g_new (GeoclueRevGeocodeAsyncData, 1);
+	data->revgeocode = revgeocode;
+	data->callback = G_CALLBACK (callback);
+	data->userdata = userdata;
+
+	positions = positions_new (latitudes, longitudes, n_positions);
+	org_freedesktop_Geoclue_ReverseGeocode_positions_to_addresses_async
+			(provider->proxy,
+			 positions,
+			 position_accuracy,
+			 (org_freedesktop_Geoclue_ReverseGeocode_positions_to_addresses_reply)positions_to_addresses_callback,
+			 data);
+	positions_free (positions);
+}
+
+/**
+ * geoclue_reverse_geocode_results_free:
+ * @results: A #GPtrArray of #GeoclueReverseGeocodeResult<!-- -->s
+ *
+ * Frees @results and the #GeoclueReverseGeocodeResult<!-- -->s in it.
+ */
+void
+geoclue_reverse_geocode_results_free (GPtrArray *results)
+{
+	guint i;
+
+	if (!results) {
+		return;
+	}
+
+	for (i = 0; i < results->len; i++) {
+		GeoclueReverseGeocodeResult *result = results->pdata[i];
+
+		if (result->details) {
+			g_hash_table_destroy (result->details);
+		}
+		geoclue_accuracy_free (result->accuracy);
+		g_free (result);
+	}
+	g_ptr_array_free (results, TRUE);
+}
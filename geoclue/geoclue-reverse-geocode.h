@@ -45,6 +45,19 @@ typedef struct _GeoclueReverseGeocodeClass {
 	GeoclueProviderClass provider_class;
 } GeoclueReverseGeocodeClass;
 
+/**
+ * GeoclueReverseGeocodeResult:
+ * @details: Address details as #GHashTable
+ * @accuracy: Accuracy of the address as #GeoclueAccuracy
+ *
+ * Address of one position in a batch, see
+ * geoclue_reverse_geocode_positions_to_addresses().
+ */
+typedef struct _GeoclueReverseGeocodeResult {
+	GHashTable *details;
+	GeoclueAccuracy *accuracy;
+} GeoclueReverseGeocodeResult;
+
 GType geoclue_reverse_geocode_get_type (void);
 
 GeoclueReverseGeocode *geoclue_reverse_geocode_new (const char *service,
@@ -72,6 +85,29 @@ void geoclue_reverse_geocode_position_to_address_async (GeoclueReverseGeocode
 							GeoclueReverseGeocodeCallback callback,
 							gpointer                      userdata);
 
+GPtrArray *
+geoclue_reverse_geocode_positions_to_addresses (GeoclueReverseGeocode  *revgeocode,
+						const double           *latitudes,
+						const double           *longitudes,
+						guint                   n_positions,
+						GeoclueAccuracy        *position_accuracy,
+						GError                **error);
+
+typedef void (*GeoclueReverseGeocodeBatchCallback) (GeoclueReverseGeocode *revgeocode,
+						    GPtrArray             *results,
+						    GError                *error,
+						    gpointer               userdata);
+
+void
+geoclue_reverse_geocode_positions_to_addresses_async (GeoclueReverseGeocode             *revgeocode,
+						      const double                      *latitudes,
+						      const double                      *longitudes,
+						      guint                              n_positions,
+						      GeoclueAccuracy                   *position_accuracy,
+						      GeoclueReverseGeocodeBatchCallback callback,
+						      gpointer                           userdata);
+
+void geoclue_reverse_geocode_results_free (GPtrArray *results);
 
 G_END_DECLS
 
@@ -34,6 +34,10 @@
  * geoclue_velocity_new(), the 
  * geoclue_velocity_get_velocity() method and the VelocityChanged-signal
  * can be used to obtain the current velocity.
+ * 
+ * Clients that need both position and velocity can instead use the 
+ * #GeoclueFix::position-and-velocity-changed signal of a #GeoclueFix
+ * for the same provider: it carries both in one message.
  */
 
 #include <geoclue/geoclue-velocity.h>
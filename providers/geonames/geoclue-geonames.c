@@ -55,6 +55,11 @@
 #define GEOCODE_PLACE_URL "http://ws.geonames.org/search"
 #define GEOCODE_POSTALCODE_URL "http://ws.geonames.org/postalCodeSearch"
 
+/* per web service response cache */
+#define CACHE_TTL (60 * 60)
+#define CACHE_SIZE (256 * 1024)
+#define DISK_CACHE_TTL (7 * 24 * 60 * 60)
+
 #define POSTALCODE_LAT "//geonames/code/lat"
 #define POSTALCODE_LON "//geonames/code/lng"
 
@@ -111,212 +116,370 @@ shutdown (GcProvider *provider)
 
 /* Geocode interface implementation */
 
-static gboolean
-geoclue_geonames_address_to_position (GcIfaceGeocode        *iface,
-                                      GHashTable            *address,
-                                      GeocluePositionFields *fields,
-                                      double                *latitude,
-                                      double                *longitude,
-                                      double                *altitude,
-                                      GeoclueAccuracy      **accuracy,
-                                      GError               **error)
+typedef enum {
+	GEOCODE_POSTALCODE,
+	GEOCODE_PLACE,
+	GEOCODE_FREEFORM
+} GeocodeQueryType;
+
+/* A single query is answered through context, a query that is part
+ * of an AddressesToPositions call through batch */
+typedef struct _GeocodeQuery {
+	GeoclueGeonames *obj;   /* held while the web query runs */
+	DBusGMethodInvocation *context;
+	GcIfaceGeocodeBatch *batch;
+	guint index;
+	GeocodeQueryType type;
+} GeocodeQuery;
+
+/* Replies to query and frees it */
+static void
+geocode_return (GeocodeQuery          *query,
+                GeocluePositionFields  fields,
+                double                 latitude,
+                double                 longitude,
+                GeoclueAccuracyLevel   level)
+{
+	GeoclueAccuracy *accuracy;
+	
+	accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
+	if (query->batch) {
+		gc_iface_geocode_batch_return (query->batch, query->index, fields,
+		                               latitude, longitude, 0.0, accuracy);
+	} else {
+		dbus_g_method_return (query->context, fields,
+		                      latitude, longitude, 0.0, accuracy);
+	}
+	geoclue_accuracy_free (accuracy);
+	g_free (query);
+}
+
+/* GAsyncReadyCallback for all geocode queries */
+static void
+geocode_query_done (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      userdata)
+{
+	GcWebService *geocoder = GC_WEB_SERVICE (source);
+	GeocodeQuery *query = userdata;
+	GeoclueGeonames *obj = query->obj;
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	double latitude = 0.0, longitude = 0.0;
+	char *fclass = NULL;
+	GError *error = NULL;
+	
+	if (!gc_web_service_query_finish (geocoder, result, &error)) {
+		if (query->batch) {
+			geocode_return (query, fields, 0.0, 0.0, level);
+		} else {
+			dbus_g_method_return_error (query->context, error);
+			g_free (query);
+		}
+		g_error_free (error);
+		g_object_unref (obj);
+		return;
+	}
+	
+	switch (query->type) {
+	case GEOCODE_POSTALCODE:
+		if (gc_web_service_get_double (geocoder, 
+		                               &latitude, POSTALCODE_LAT) &&
+		    gc_web_service_get_double (geocoder, 
+		                               &longitude, POSTALCODE_LON)) {
+			fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
+			fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
+			level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
+		}
+		break;
+	case GEOCODE_PLACE:
+		if (gc_web_service_get_double (geocoder, 
+		                               &latitude, GEONAME_LAT) &&
+		    gc_web_service_get_double (geocoder, 
+		                               &longitude, GEONAME_LON)) {
+			fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
+			fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
+			level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
+		}
+		break;
+	case GEOCODE_FREEFORM:
+		if (gc_web_service_get_double (geocoder,
+		                               &latitude, GEONAME_LAT) &&
+		    gc_web_service_get_double (geocoder,
+		                               &longitude, GEONAME_LON)) {
+			fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+			fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
+
+			/* this is crude but should cover most results from geonames */
+			if (gc_web_service_get_string (geocoder,
+			                               &fclass, GEONAME_FEATURE_CLASS)) {
+				if (g_strcmp0 (fclass, "A") == 0) {
+					level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
+				}else if (g_strcmp0 (fclass, "P") == 0) {
+					level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
+				}
+				g_free (fclass);
+			}
+		}
+		break;
+	}
+	
+	geocode_return (query, fields, latitude, longitude, level);
+	g_object_unref (obj);
+}
+
+/* Starts the postalcode or place query for address, used by both
+ * AddressToPosition and AddressesToPositions */
+static void
+geocode_address (GeoclueGeonames *obj,
+                 GHashTable      *address,
+                 GeocodeQuery    *query)
 {
-	GeoclueGeonames *obj = GEOCLUE_GEONAMES (iface);
 	gchar *countrycode, *locality, *postalcode;
 	
 	countrycode = g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_COUNTRYCODE);
 	locality = g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_LOCALITY);
 	postalcode = g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_POSTALCODE);
 	
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	
 	if (countrycode && postalcode) {
-		if (!gc_web_service_query (obj->postalcode_geocoder, error,
-		                           "postalcode", postalcode,
-		                           "country", countrycode,
-		                           "maxRows", "1",
-		                           "style", "FULL",
-		                           (char *)0)) {
-			return FALSE;
-		}
-		if (gc_web_service_get_double (obj->postalcode_geocoder, 
-		                               latitude, POSTALCODE_LAT) &&
-		    gc_web_service_get_double (obj->postalcode_geocoder, 
-		                               longitude, POSTALCODE_LON)) {
-			*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
-			*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
-			*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_POSTALCODE,
-			                                  0, 0);
-		}
+		query->type = GEOCODE_POSTALCODE;
+		query->obj = g_object_ref (obj);
+		gc_web_service_query_async (obj->postalcode_geocoder, NULL,
+		                            geocode_query_done, query,
+		                            "postalcode", postalcode,
+		                            "country", countrycode,
+		                            "maxRows", "1",
+		                            "style", "FULL",
+		                            (char *)0);
 	} else if (countrycode && locality) {
-		if (!gc_web_service_query (obj->place_geocoder, error,
-		                           "name", locality,
-		                           "country", countrycode,
-		                           "maxRows", "1",
-		                           "style", "FULL",
-		                           (char *)0)) {
-			return FALSE;
-		}
-		if (gc_web_service_get_double (obj->place_geocoder, 
-		                               latitude, GEONAME_LAT) &&
-		    gc_web_service_get_double (obj->place_geocoder, 
-		                               longitude, GEONAME_LON)) {
-			*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
-			*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
-			*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_LOCALITY,
-			                                  0, 0);
-		}
-	}
-	if (*accuracy == NULL) {
-		*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0, 0);
+		query->type = GEOCODE_PLACE;
+		query->obj = g_object_ref (obj);
+		gc_web_service_query_async (obj->place_geocoder, NULL,
+		                            geocode_query_done, query,
+		                            "name", locality,
+		                            "country", countrycode,
+		                            "maxRows", "1",
+		                            "style", "FULL",
+		                            (char *)0);
+	} else {
+		geocode_return (query, GEOCLUE_POSITION_FIELDS_NONE,
+		                0.0, 0.0, GEOCLUE_ACCURACY_LEVEL_NONE);
 	}
-	return TRUE;
 }
 
-static gboolean
-geoclue_geonames_freeform_address_to_position (GcIfaceGeocode        *iface,
-                                               const char            *address,
-                                               GeocluePositionFields *fields,
-                                               double                *latitude,
-                                               double                *longitude,
-                                               double                *altitude,
-                                               GeoclueAccuracy      **accuracy,
-                                               GError               **error)
+static void
+geoclue_geonames_address_to_position_async (GcIfaceGeocode        *iface,
+                                            GHashTable            *address,
+                                            DBusGMethodInvocation *context)
+{
+	GeocodeQuery *query;
+	
+	query = g_new0 (GeocodeQuery, 1);
+	query->context = context;
+	geocode_address (GEOCLUE_GEONAMES (iface), address, query);
+}
+
+static void
+geoclue_geonames_batch_address_to_position (GcIfaceGeocode      *iface,
+                                            GHashTable          *address,
+                                            GcIfaceGeocodeBatch *batch,
+                                            guint                index)
+{
+	GeocodeQuery *query;
+	
+	query = g_new0 (GeocodeQuery, 1);
+	query->batch = batch;
+	query->index = index;
+	geocode_address (GEOCLUE_GEONAMES (iface), address, query);
+}
+
+static void
+geoclue_geonames_freeform_address_to_position_async (GcIfaceGeocode        *iface,
+                                                     const char            *address,
+                                                     DBusGMethodInvocation *context)
 {
 	GeoclueGeonames *obj = GEOCLUE_GEONAMES (iface);
+	GeocodeQuery *query;
 
-	if (fields) {
-		*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	}
+	query = g_new0 (GeocodeQuery, 1);
+	query->context = context;
 
-	if (address) {
-		if (!gc_web_service_query (obj->place_geocoder, error,
-		                           "q", address,
-		                           "maxRows", "1",
-		                           "style", "FULL",
-		                           (char *)0)) {
-			return FALSE;
-		}
-		if (gc_web_service_get_double (obj->place_geocoder,
-		                               latitude, GEONAME_LAT) &&
-			gc_web_service_get_double (obj->place_geocoder,
-			                           longitude, GEONAME_LON)) {
-			if (fields) {
-				*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-				*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
-			}
-			if (accuracy) {
-				char *fclass = NULL;
-				GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
-
-				/* this is crude but should cover most results from geonames */
-				if (gc_web_service_get_string (obj->place_geocoder,
-				                               &fclass, GEONAME_FEATURE_CLASS)) {
-					if (g_strcmp0 (fclass, "A") == 0) {
-						level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
-					}else if (g_strcmp0 (fclass, "P") == 0) {
-						level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
-					}
-					g_free (fclass);
-				}
-				*accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
-			}
-		}
+	if (!address) {
+		geocode_return (query, GEOCLUE_POSITION_FIELDS_NONE,
+		                0.0, 0.0, GEOCLUE_ACCURACY_LEVEL_NONE);
+		return;
 	}
 
-	if (accuracy && *accuracy == NULL) {
-		*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
-	}
-	return TRUE;
+	query->type = GEOCODE_FREEFORM;
+	query->obj = g_object_ref (obj);
+	gc_web_service_query_async (obj->place_geocoder, NULL,
+	                            geocode_query_done, query,
+	                            "q", address,
+	                            "maxRows", "1",
+	                            "style", "FULL",
+	                            (char *)0);
 }
 
 /* ReverseGeocode interface implementation */
 
-static gboolean
-geoclue_geonames_position_to_address (GcIfaceReverseGeocode  *iface,
-                                      double                  latitude,
-                                      double                  longitude,
-                                      GeoclueAccuracy        *position_accuracy,
-                                      GHashTable            **address,
-                                      GeoclueAccuracy       **address_accuracy,
-                                      GError                **error)
+/* A single query is answered through context, a query that is part
+ * of a PositionsToAddresses call through batch */
+typedef struct _ReverseGeocodeQuery {
+	GeoclueGeonames *obj;   /* held while the web query runs */
+	DBusGMethodInvocation *context;
+	GcIfaceReverseGeocodeBatch *batch;
+	guint index;
+	GeoclueAccuracyLevel in_acc;
+} ReverseGeocodeQuery;
+
+static void
+reverse_geocode_query_done (GObject      *source,
+                            GAsyncResult *result,
+                            gpointer      userdata)
 {
-	GeoclueGeonames *obj = GEOCLUE_GEONAMES (iface);
-	gchar lat[G_ASCII_DTOSTR_BUF_SIZE];
-	gchar lon[G_ASCII_DTOSTR_BUF_SIZE];
+	GcWebService *rev_place_geocoder = GC_WEB_SERVICE (source);
+	ReverseGeocodeQuery *query = userdata;
+	GeoclueGeonames *obj = query->obj;
+	GeoclueAccuracyLevel in_acc = query->in_acc;
+	GHashTable *address;
+	GeoclueAccuracy *address_accuracy;
 	gchar *locality = NULL;
 	gchar *region = NULL;
 	gchar *country = NULL;
 	gchar *countrycode = NULL;
-	GeoclueAccuracyLevel in_acc = GEOCLUE_ACCURACY_LEVEL_DETAILED;
+	GError *error = NULL;
 	
-	if (!address) {
-		return TRUE;
-	}
-	g_ascii_dtostr (lat, G_ASCII_DTOSTR_BUF_SIZE, latitude);
-	g_ascii_dtostr (lon, G_ASCII_DTOSTR_BUF_SIZE, longitude);
-	if (!gc_web_service_query (obj->rev_place_geocoder, error,
-	                           "lat", lat,
-	                           "lng", lon,
-	                           "featureCode","PPL",  /* http://www.geonames.org/export/codes.html*/
-	                           "featureCode","PPLA",
-	                           "featureCode","PPLC",
-	                           "featureCode","PPLG",
-	                           "featureCode","PPLL",
-	                           "featureCode","PPLR",
-	                           "featureCode","PPLS",
-	                           "maxRows", "1",
-	                           "style", "FULL",
-	                           (char *)0)) {
-		return FALSE;
-	}
-	
-	if (position_accuracy) {
-		geoclue_accuracy_get_details (position_accuracy, &in_acc, NULL, NULL);
+	if (!gc_web_service_query_finish (rev_place_geocoder, result, &error)) {
+		if (query->batch) {
+			gc_iface_reverse_geocode_batch_return (query->batch,
+			                                       query->index,
+			                                       NULL, NULL);
+		} else {
+			dbus_g_method_return_error (query->context, error);
+		}
+		g_error_free (error);
+		g_free (query);
+		g_object_unref (obj);
+		return;
 	}
 	
-	*address = g_hash_table_new (g_str_hash, g_str_equal);
+	address = geoclue_address_details_new ();
 	
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
+	    gc_web_service_get_string (rev_place_geocoder,
 	                               &countrycode, GEONAME_COUNTRYCODE)) {
-		geoclue_address_details_insert (*address,
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
 		                                countrycode);
 		g_free (countrycode);
-		geoclue_address_details_set_country_from_code (*address);
+		geoclue_address_details_set_country_from_code (address);
 	}
-	if (!g_hash_table_lookup (*address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
+	if (!g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
 	    in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
+	    gc_web_service_get_string (rev_place_geocoder,
 	                               &country, GEONAME_COUNTRY)) {
-		geoclue_address_details_insert (*address,
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRY,
 		                                country);
 		g_free (country);
 	}
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_REGION && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
+	    gc_web_service_get_string (rev_place_geocoder,
 	                               &region, GEONAME_ADMIN1)) {
-		geoclue_address_details_insert (*address,
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_REGION,
 		                                region);
 		g_free (region);
 	}
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_LOCALITY && 
-	    gc_web_service_get_string (obj->rev_place_geocoder,
+	    gc_web_service_get_string (rev_place_geocoder,
 	                               &locality, GEONAME_NAME)) {
-		geoclue_address_details_insert (*address,
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_LOCALITY,
 		                                locality);
 		g_free (locality);
 	}
 	
-	if (address_accuracy) { 
-		GeoclueAccuracyLevel level = geoclue_address_details_get_accuracy_level (*address);
-		*address_accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
+	address_accuracy = geoclue_accuracy_new (geoclue_address_details_get_accuracy_level (address),
+	                                         0.0, 0.0);
+	if (query->batch) {
+		gc_iface_reverse_geocode_batch_return (query->batch, query->index,
+		                                       address, address_accuracy);
+	} else {
+		dbus_g_method_return (query->context, address, address_accuracy);
 	}
-	return TRUE;
+	g_hash_table_destroy (address);
+	geoclue_accuracy_free (address_accuracy);
+	g_free (query);
+	g_object_unref (obj);
+}
+
+static void
+reverse_geocode_query_start (GeoclueGeonames     *obj,
+                             double               latitude,
+                             double               longitude,
+                             GeoclueAccuracy     *position_accuracy,
+                             ReverseGeocodeQuery *query)
+{
+	gchar lat[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar lon[G_ASCII_DTOSTR_BUF_SIZE];
+	
+	query->in_acc = GEOCLUE_ACCURACY_LEVEL_DETAILED;
+	if (position_accuracy) {
+		geoclue_accuracy_get_details (position_accuracy, &query->in_acc, NULL, NULL);
+	}
+	
+	g_ascii_dtostr (lat, G_ASCII_DTOSTR_BUF_SIZE, latitude);
+	g_ascii_dtostr (lon, G_ASCII_DTOSTR_BUF_SIZE, longitude);
+	query->obj = g_object_ref (obj);
+	gc_web_service_query_async (obj->rev_place_geocoder, NULL,
+	                            reverse_geocode_query_done, query,
+	                            "lat", lat,
+	                            "lng", lon,
+	                            "featureCode","PPL",  /* http://www.geonames.org/export/codes.html*/
+	                            "featureCode","PPLA",
+	                            "featureCode","PPLC",
+	                            "featureCode","PPLG",
+	                            "featureCode","PPLL",
+	                            "featureCode","PPLR",
+	                            "featureCode","PPLS",
+	                            "maxRows", "1",
+	                            "style", "FULL",
+	                            (char *)0);
+}
+
+static void
+geoclue_geonames_position_to_address_async (GcIfaceReverseGeocode  *iface,
+                                            double                  latitude,
+                                            double                  longitude,
+                                            GeoclueAccuracy        *position_accuracy,
+                                            DBusGMethodInvocation  *context)
+{
+	ReverseGeocodeQuery *query;
+	
+	query = g_new0 (ReverseGeocodeQuery, 1);
+	query->context = context;
+	reverse_geocode_query_start (GEOCLUE_GEONAMES (iface),
+	                             latitude, longitude,
+	                             position_accuracy, query);
+}
+
+static void
+geoclue_geonames_batch_position_to_address (GcIfaceReverseGeocode      *iface,
+                                            double                      latitude,
+                                            double                      longitude,
+                                            GeoclueAccuracy            *position_accuracy,
+                                            GcIfaceReverseGeocodeBatch *batch,
+                                            guint                       index)
+{
+	ReverseGeocodeQuery *query;
+	
+	query = g_new0 (ReverseGeocodeQuery, 1);
+	query->batch = batch;
+	query->index = index;
+	reverse_geocode_query_start (GEOCLUE_GEONAMES (iface),
+	                             latitude, longitude,
+	                             position_accuracy, query);
 }
 
 static void
@@ -379,33 +542,45 @@ geoclue_geonames_init (GeoclueGeonames *obj)
 	obj->place_geocoder = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (obj->place_geocoder, 
 	                             GEOCODE_PLACE_URL);
+	gc_web_service_set_cache (obj->place_geocoder, CACHE_TTL, CACHE_SIZE);
+	gc_web_service_set_disk_cache (obj->place_geocoder, "geonames", DISK_CACHE_TTL);
 	
 	obj->postalcode_geocoder = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (obj->postalcode_geocoder, 
 	                             GEOCODE_POSTALCODE_URL);
+	gc_web_service_set_cache (obj->postalcode_geocoder, CACHE_TTL, CACHE_SIZE);
+	gc_web_service_set_disk_cache (obj->postalcode_geocoder, "geonames", DISK_CACHE_TTL);
 	
 	obj->rev_place_geocoder = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (obj->rev_place_geocoder, 
 	                             REV_GEOCODE_PLACE_URL);
+	gc_web_service_set_cache (obj->rev_place_geocoder, CACHE_TTL, CACHE_SIZE);
+	gc_web_service_set_disk_cache (obj->rev_place_geocoder, "geonames", DISK_CACHE_TTL);
 	
 	obj->rev_street_geocoder = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (obj->rev_street_geocoder, 
 	                             REV_GEOCODE_STREET_URL);
+	gc_web_service_set_cache (obj->rev_street_geocoder, CACHE_TTL, CACHE_SIZE);
+	gc_web_service_set_disk_cache (obj->rev_street_geocoder, "geonames", DISK_CACHE_TTL);
 }
 
 
 static void
 geoclue_geonames_geocode_init (GcIfaceGeocodeClass *iface)
 {
-	iface->address_to_position = geoclue_geonames_address_to_position;
-	iface->freeform_address_to_position =
-			geoclue_geonames_freeform_address_to_position;
+	iface->address_to_position_async = 
+			geoclue_geonames_address_to_position_async;
+	iface->freeform_address_to_position_async =
+			geoclue_geonames_freeform_address_to_position_async;
+	iface->batch_address_to_position =
+			geoclue_geonames_batch_address_to_position;
 }
 
 static void
 geoclue_geonames_reverse_geocode_init (GcIfaceReverseGeocodeClass *iface)
 {
-	iface->position_to_address = geoclue_geonames_position_to_address;
+	iface->position_to_address_async = geoclue_geonames_position_to_address_async;
+	iface->batch_position_to_address = geoclue_geonames_batch_position_to_address;
 }
 
 int 
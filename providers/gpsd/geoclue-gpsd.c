@@ -39,18 +39,18 @@
 #include <geoclue/gc-provider.h>
 #include <geoclue/gc-iface-position.h>
 #include <geoclue/gc-iface-velocity.h>
+#include <geoclue/gc-iface-fix.h>
 
 typedef struct gps_data_t gps_data;
 typedef struct gps_fix_t gps_fix;
 
-/* only listing used tags */
-typedef enum {
-	NMEA_NONE,
-	NMEA_GSA,
-	NMEA_GGA,
-	NMEA_GSV,
-	NMEA_RMC
-} NmeaTag;
+/* used when gpsd does not know the error estimate (meters) */
+#define DEFAULT_HORIZONTAL_ACCURACY 24
+#define DEFAULT_VERTICAL_ACCURACY 60
+
+/* the parts of a TPV report used here */
+#define TPV_SET (MODE_SET | TIME_SET | LATLON_SET | ALTITUDE_SET | \
+                 SPEED_SET | TRACK_SET | CLIMB_SET | HERR_SET | VERR_SET)
 
 
 typedef struct {
@@ -60,6 +60,8 @@ typedef struct {
 	char *port;
 	
 	gps_data *gpsdata;
+	GIOChannel *channel;
+	guint watch_id;
 	
 	gps_fix *last_fix;
 	
@@ -86,17 +88,13 @@ G_DEFINE_TYPE_WITH_CODE (GeoclueGpsd, geoclue_gpsd, GC_TYPE_PROVIDER,
                          G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_POSITION,
                                                 geoclue_gpsd_position_init)
                          G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_VELOCITY,
-                                                geoclue_gpsd_velocity_init))
+                                                geoclue_gpsd_velocity_init)
+                         G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_FIX, NULL))
 
 static void geoclue_gpsd_stop_gpsd (GeoclueGpsd *self);
 static gboolean geoclue_gpsd_start_gpsd (GeoclueGpsd *self);
 
 
-/* defining global GeoclueGpsd because gpsd does not support "user_data"
- * pointers in callbacks */
-GeoclueGpsd *gpsd;
-
-
 
 /* Geoclue interface */
 static gboolean
@@ -228,47 +226,46 @@ equal_or_nan (double a, double b)
 	return a == b;
 }
 
-static void
-geoclue_gpsd_update_position (GeoclueGpsd *gpsd, NmeaTag nmea_tag)
+static gboolean
+geoclue_gpsd_update_position (GeoclueGpsd *gpsd)
 {
 	gps_fix *fix = &gpsd->gpsdata->fix;
 	gps_fix *last_fix = gpsd->last_fix;
+	double altitude;
 	
-	last_fix->time = fix->time;
-	
-	/* If a flag is not set, bail out.*/
-	if (!((gpsd->gpsdata->set & LATLON_SET) || (gpsd->gpsdata->set & ALTITUDE_SET))) {
-		return;
-	}
-	gpsd->gpsdata->set &= ~(LATLON_SET | ALTITUDE_SET);
+	/* altitude is only valid in a 3D fix */
+	altitude = (fix->mode == MODE_3D) ? fix->altitude : NAN;
 	
 	if (equal_or_nan (fix->latitude, last_fix->latitude) &&
 	    equal_or_nan (fix->longitude, last_fix->longitude) &&
-	    equal_or_nan (fix->altitude, last_fix->altitude)) {
+	    equal_or_nan (altitude, last_fix->altitude) &&
+	    equal_or_nan (fix->eph, last_fix->eph) &&
+	    equal_or_nan (fix->epv, last_fix->epv) &&
+	    gpsd->last_pos_fields != GEOCLUE_POSITION_FIELDS_NONE) {
 		/* position has not changed */
-		return;
+		return FALSE;
 	}
 	
 	/* save values */
 	last_fix->latitude = fix->latitude;
 	last_fix->longitude = fix->longitude;
-	last_fix->altitude = fix->altitude;
+	last_fix->altitude = altitude;
+	last_fix->eph = fix->eph;
+	last_fix->epv = fix->epv;
 	
-	/* Could use fix.eph for accuracy, but eph is 
-	 * often NaN... what then? 
-	 * Could also use fix mode (2d/3d) to decide vertical accuracy, 
-	 * but gpsd updates that so erratically that I couldn't
-	 * be arsed so far */
 	geoclue_accuracy_set_details (gpsd->last_accuracy,
 	                              GEOCLUE_ACCURACY_LEVEL_DETAILED,
-	                              24, 60);
+	                              isnan (fix->eph) ? 
+	                              DEFAULT_HORIZONTAL_ACCURACY : fix->eph,
+	                              isnan (fix->epv) ? 
+	                              DEFAULT_VERTICAL_ACCURACY : fix->epv);
 	
 	gpsd->last_pos_fields = GEOCLUE_POSITION_FIELDS_NONE;
-	gpsd->last_pos_fields |= (isnan (fix->latitude)) ? 
+	gpsd->last_pos_fields |= (isnan (last_fix->latitude)) ? 
 	                         0 : GEOCLUE_POSITION_FIELDS_LATITUDE;
-	gpsd->last_pos_fields |= (isnan (fix->longitude)) ? 
+	gpsd->last_pos_fields |= (isnan (last_fix->longitude)) ? 
 	                         0 : GEOCLUE_POSITION_FIELDS_LONGITUDE;
-	gpsd->last_pos_fields |= (isnan (fix->altitude)) ? 
+	gpsd->last_pos_fields |= (isnan (last_fix->altitude)) ? 
 	                         0 : GEOCLUE_POSITION_FIELDS_ALTITUDE;
 	
 	gc_iface_position_emit_position_changed 
@@ -276,131 +273,143 @@ geoclue_gpsd_update_position (GeoclueGpsd *gpsd, NmeaTag nmea_tag)
 		 (int)(last_fix->time+0.5), 
 		 last_fix->latitude, last_fix->longitude, last_fix->altitude, 
 		 gpsd->last_accuracy);
-	
+	return TRUE;
 }
 
-static void
-geoclue_gpsd_update_velocity (GeoclueGpsd *gpsd, NmeaTag nmea_tag)
+static gboolean
+geoclue_gpsd_update_velocity (GeoclueGpsd *gpsd)
 {
 	gps_fix *fix = &gpsd->gpsdata->fix;
 	gps_fix *last_fix = gpsd->last_fix;
-	gboolean changed = FALSE;
+	double climb;
 	
-	/* at least with my devices, gpsd updates
-	 *  - climb on GGA, GSA and GSV messages (speed and track are set to NaN).
-	 *  - speed and track on RMC message (climb is set to NaN).
-	 * 
-	 * couldn't think of an smart way to handle this, I don't think there is one
-	 */
+	/* climb is only valid in a 3D fix */
+	climb = (fix->mode == MODE_3D) ? fix->climb : NAN;
 	
-	if (((gpsd->gpsdata->set & TRACK_SET) || (gpsd->gpsdata->set & SPEED_SET)) &&
-	    nmea_tag == NMEA_RMC) {
-		
-		gpsd->gpsdata->set &= ~(TRACK_SET | SPEED_SET);
-		
-		last_fix->time = fix->time;
-		
-		if (!equal_or_nan (fix->track, last_fix->track) ||
-		    !equal_or_nan (fix->speed, last_fix->speed)){
-			
-			/* velocity has changed */
-			changed = TRUE;
-			last_fix->track = fix->track;
-			last_fix->speed = fix->speed;
-		}
-	} else if ((gpsd->gpsdata->set & CLIMB_SET) &&
-	           (nmea_tag == NMEA_GGA || 
-	            nmea_tag == NMEA_GSA || 
-	            nmea_tag == NMEA_GSV)) {
-		
-		gpsd->gpsdata->set &= ~(CLIMB_SET);
-		
-		last_fix->time = fix->time;
-		
-		if (!equal_or_nan (fix->climb, last_fix->climb)){
-			
-			/* velocity has changed */
-			changed = TRUE;
-			last_fix->climb = fix->climb;
-		}
+	if (equal_or_nan (fix->track, last_fix->track) &&
+	    equal_or_nan (fix->speed, last_fix->speed) &&
+	    equal_or_nan (climb, last_fix->climb) &&
+	    gpsd->last_velo_fields != GEOCLUE_VELOCITY_FIELDS_NONE) {
+		/* velocity has not changed */
+		return FALSE;
 	}
 	
-	if (changed) {
-		gpsd->last_velo_fields = GEOCLUE_VELOCITY_FIELDS_NONE;
-		gpsd->last_velo_fields |= (isnan (last_fix->track)) ?
-			0 : GEOCLUE_VELOCITY_FIELDS_DIRECTION;
-		gpsd->last_velo_fields |= (isnan (last_fix->speed)) ?
-			0 : GEOCLUE_VELOCITY_FIELDS_SPEED;
-		gpsd->last_velo_fields |= (isnan (last_fix->climb)) ?
-			0 : GEOCLUE_VELOCITY_FIELDS_CLIMB;
-		
-		gc_iface_velocity_emit_velocity_changed 
-			(GC_IFACE_VELOCITY (gpsd), gpsd->last_velo_fields,
-			 (int)(last_fix->time+0.5),
-			 last_fix->speed, last_fix->track, last_fix->climb);
-	}
+	last_fix->track = fix->track;
+	last_fix->speed = fix->speed;
+	last_fix->climb = climb;
+	
+	gpsd->last_velo_fields = GEOCLUE_VELOCITY_FIELDS_NONE;
+	gpsd->last_velo_fields |= (isnan (last_fix->track)) ?
+		0 : GEOCLUE_VELOCITY_FIELDS_DIRECTION;
+	gpsd->last_velo_fields |= (isnan (last_fix->speed)) ?
+		0 : GEOCLUE_VELOCITY_FIELDS_SPEED;
+	gpsd->last_velo_fields |= (isnan (last_fix->climb)) ?
+		0 : GEOCLUE_VELOCITY_FIELDS_CLIMB;
+	
+	gc_iface_velocity_emit_velocity_changed 
+		(GC_IFACE_VELOCITY (gpsd), gpsd->last_velo_fields,
+		 (int)(last_fix->time+0.5),
+		 last_fix->speed, last_fix->track, last_fix->climb);
+	return TRUE;
 }
 
+/* A TPV report carries the fix mode, position, velocity and the
+ * error estimates together, so everything is updated from it at once.
+ * Other reports (SKY, DEVICE...) are not used. */
 static void
-geoclue_gpsd_update_status (GeoclueGpsd *gpsd, NmeaTag nmea_tag)
+geoclue_gpsd_handle_report (GeoclueGpsd *gpsd)
 {
-	GeoclueStatus status;
+	gps_data *gpsdata = gpsd->gpsdata;
+	gps_fix *last_fix = gpsd->last_fix;
+	gboolean position_changed, velocity_changed;
 	
-	/* gpsdata->online is supposedly always up-to-date */
-	if (gpsd->gpsdata->online <= 0) {
-		status = GEOCLUE_STATUS_UNAVAILABLE;
-	} else if (gpsd->gpsdata->set & STATUS_SET) {
-		gpsd->gpsdata->set &= ~(STATUS_SET);
-		
-		if (gpsd->gpsdata->status > 0) {
-			status = GEOCLUE_STATUS_AVAILABLE;
-		} else {
-			status = GEOCLUE_STATUS_ACQUIRING;
-		}
-	} else {
+	if (!(gpsdata->set & MODE_SET)) {
 		return;
 	}
+	gpsdata->set &= ~TPV_SET;
 	
-	geoclue_gpsd_set_status (gpsd, status);
-}
-
-static void 
-gpsd_raw_hook (struct gps_data_t *gpsdata, char *message, size_t len)
-{
-	char *tag_str = gpsd->gpsdata->tag;
-	NmeaTag nmea_tag = NMEA_NONE;
-	
-	if (tag_str[0] == 'G' && tag_str[1] == 'S' && tag_str[2] == 'A') {
-		nmea_tag = NMEA_GSA;
-	} else if (tag_str[0] == 'G' && tag_str[1] == 'G' && tag_str[2] == 'A') {
-		nmea_tag = NMEA_GGA;
-	} else if (tag_str[0] == 'G' && tag_str[1] == 'S' && tag_str[2] == 'V') {
-		nmea_tag = NMEA_GSV;
-	} else if (tag_str[0] == 'R' && tag_str[1] == 'M' && tag_str[2] == 'C') {
-		nmea_tag = NMEA_RMC;
+	if (gpsdata->fix.mode < MODE_2D) {
+		geoclue_gpsd_set_status (gpsd, GEOCLUE_STATUS_ACQUIRING);
+		return;
+	}
+	
+	last_fix->time = gpsdata->fix.time;
+	position_changed = geoclue_gpsd_update_position (gpsd);
+	velocity_changed = geoclue_gpsd_update_velocity (gpsd);
+	if (position_changed || velocity_changed) {
+		gc_iface_fix_emit_position_and_velocity_changed
+			(GC_IFACE_FIX (gpsd),
+			 gpsd->last_pos_fields, gpsd->last_velo_fields,
+			 (int)(last_fix->time+0.5),
+			 last_fix->latitude, last_fix->longitude, last_fix->altitude,
+			 last_fix->speed, last_fix->track, last_fix->climb,
+			 gpsd->last_accuracy);
 	}
 	
-	geoclue_gpsd_update_status (gpsd, nmea_tag);
-	geoclue_gpsd_update_position (gpsd, nmea_tag);
-	geoclue_gpsd_update_velocity (gpsd, nmea_tag);
+	/* after updating, so the values are valid when clients
+	 * react to the status change */
+	geoclue_gpsd_set_status (gpsd, GEOCLUE_STATUS_AVAILABLE);
 }
 
 static void
 geoclue_gpsd_stop_gpsd (GeoclueGpsd *self)
 {
+	if (self->watch_id) {
+		g_source_remove (self->watch_id);
+		self->watch_id = 0;
+	}
+	if (self->channel) {
+		g_io_channel_unref (self->channel);
+		self->channel = NULL;
+	}
 	if (self->gpsdata) {
 		gps_close (self->gpsdata);
 		self->gpsdata = NULL;
 	}
 }
 
+/* Reads whatever gpsd has sent as soon as it arrives: there is 
+ * no wakeup while the receiver is silent */
+static gboolean
+gpsd_watch (GIOChannel   *source,
+            GIOCondition  condition,
+            gpointer      data)
+{
+	GeoclueGpsd *self = (GeoclueGpsd*)data;
+	
+	if (condition & G_IO_IN) {
+		/* handle every report that is already waiting, not just
+		 * one per wakeup, so a burst does not leave us behind */
+		do {
+			if (gps_poll (self->gpsdata) < 0) {
+				condition |= G_IO_ERR;
+				break;
+			}
+			geoclue_gpsd_handle_report (self);
+		} while (gps_waiting (self->gpsdata));
+	}
+	if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+		/* returning FALSE removes the watch */
+		self->watch_id = 0;
+		geoclue_gpsd_set_status (self, GEOCLUE_STATUS_ERROR);
+		geoclue_gpsd_stop_gpsd (self);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static gboolean
 geoclue_gpsd_start_gpsd (GeoclueGpsd *self)
 {
 	self->gpsdata = gps_open (self->host, self->port);
 	if (self->gpsdata) {
-		gps_stream(self->gpsdata, WATCH_ENABLE | WATCH_NMEA | POLL_NONBLOCK, NULL);
-		gps_set_raw_hook (self->gpsdata, gpsd_raw_hook);
+		/* structured reports only, no raw NMEA */
+		gps_stream(self->gpsdata, WATCH_ENABLE | WATCH_JSON | POLL_NONBLOCK, NULL);
+		
+		self->channel = g_io_channel_unix_new (self->gpsdata->gps_fd);
+		self->watch_id = g_io_add_watch (self->channel,
+		                                 G_IO_IN | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+		                                 gpsd_watch, self);
 		return TRUE;
 	} else {
 		g_warning ("gps_open() failed, is gpsd running (host=%s,port=%s)?", self->host, self->port);
@@ -408,24 +417,12 @@ geoclue_gpsd_start_gpsd (GeoclueGpsd *self)
 	}
 }
 
-gboolean
-gpsd_poll(gpointer data)
-{
-	GeoclueGpsd *self = (GeoclueGpsd*)data;
-	if (self->gpsdata) {
-		if (gps_poll(self->gpsdata) < 0) {
-			geoclue_gpsd_set_status (self, GEOCLUE_STATUS_ERROR);
-			geoclue_gpsd_stop_gpsd(self);
-			return FALSE;
-		}
-	}
-	return TRUE;
-}
-
 static void
 geoclue_gpsd_init (GeoclueGpsd *self)
 {
 	self->gpsdata = NULL;
+	self->channel = NULL;
+	self->watch_id = 0;
 	self->last_fix = g_new0 (gps_fix, 1);
 	
 	self->last_pos_fields = GEOCLUE_POSITION_FIELDS_NONE;
@@ -503,12 +500,13 @@ int
 main (int    argc,
       char **argv)
 {
+	GeoclueGpsd *gpsd;
+	
 	g_type_init ();
 	
 	gpsd = g_object_new (GEOCLUE_TYPE_GPSD, NULL);
 	
 	gpsd->loop = g_main_loop_new (NULL, TRUE);
-	g_timeout_add(500, gpsd_poll, (gpointer)gpsd);
 
 	g_main_loop_run (gpsd->loop);
 	
@@ -69,6 +69,11 @@
 #define OPENCELLID_LON "/rsp/cell/@lon"
 #define OPENCELLID_CID "/rsp/cell/@cellId"
 
+/* cell locations rarely change */
+#define OPENCELLID_CACHE_TTL (24 * 60 * 60)
+#define OPENCELLID_CACHE_SIZE (64 * 1024)
+#define OPENCELLID_DISK_CACHE_TTL (30 * 24 * 60 * 60)
+
 #define GEOCLUE_TYPE_GSMLOC (geoclue_gsmloc_get_type ())
 #define GEOCLUE_GSMLOC(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GEOCLUE_TYPE_GSMLOC, GeoclueGsmloc))
 
@@ -92,6 +97,11 @@ struct _GeoclueGsmloc {
 	double last_lat;
 	double last_lon;
 
+	/* opencellid query serial, used to ignore stale replies */
+	guint query_serial;
+	/* GetPosition calls waiting for a query to finish */
+	GSList *pending_position_calls;
+
 	GHashTable *address;
 };
 
@@ -142,48 +152,33 @@ shutdown (GcProvider *provider)
 	g_main_loop_quit (gsmloc->loop);
 }
 
-static gboolean
-geoclue_gsmloc_query_opencellid (GeoclueGsmloc *gsmloc)
-{
-	double lat, lon;
-	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
-	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
-
-	if (gsmloc->mcc && gsmloc->mnc &&
-	    gsmloc->lac && gsmloc->cid) {
+typedef struct _OpencellidQuery {
+	GeoclueGsmloc *gsmloc;
+	guint serial;
+} OpencellidQuery;
 
-		if (gc_web_service_query (gsmloc->web_service, NULL,
-		                          "mcc", gsmloc->mcc,
-		                          "mnc", gsmloc->mnc,
-		                          "lac", gsmloc->lac,
-		                          "cellid", gsmloc->cid,
-		                          (char *)0)) {
+static void
+geoclue_gsmloc_return_position (GeoclueGsmloc         *gsmloc,
+                                DBusGMethodInvocation *context)
+{
+	GeoclueAccuracy *acc;
 
-			if (gc_web_service_get_double (gsmloc->web_service, 
-			                               &lat, OPENCELLID_LAT)) {
-				fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-			}
-			if (gc_web_service_get_double (gsmloc->web_service, 
-			                               &lon, OPENCELLID_LON)) {
-				fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
-			}
+	acc = geoclue_accuracy_new (gsmloc->last_accuracy_level, 0, 0);
+	dbus_g_method_return (context, gsmloc->last_position_fields,
+	                      (int)time (NULL),
+	                      gsmloc->last_lat, gsmloc->last_lon, 0.0,
+	                      acc);
+	geoclue_accuracy_free (acc);
+}
 
-			if (fields != GEOCLUE_POSITION_FIELDS_NONE) {
-				char *retval_cid;
-				/* if cellid is not present, location is for the local area code.
-				 * the accuracy might be an overstatement -- I have no idea how 
-				 * big LACs typically are */
-				level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
-				if (gc_web_service_get_string (gsmloc->web_service, 
-				                               &retval_cid, OPENCELLID_CID)) {
-					if (retval_cid && strlen (retval_cid) != 0) {
-						level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
-					}
-					g_free (retval_cid);
-				}
-			}
-		}
-	}
+static void
+geoclue_gsmloc_set_position (GeoclueGsmloc         *gsmloc,
+                             GeocluePositionFields  fields,
+                             double                 lat,
+                             double                 lon,
+                             GeoclueAccuracyLevel   level)
+{
+	GSList *l;
 
 	if (fields != gsmloc->last_position_fields ||
 	    (fields != GEOCLUE_POSITION_FIELDS_NONE &&
@@ -206,10 +201,98 @@ geoclue_gsmloc_query_opencellid (GeoclueGsmloc *gsmloc)
 		                                         lat, lon, 0.0,
 		                                         acc);
 		geoclue_accuracy_free (acc);
-		return TRUE;
 	}
 
-	return FALSE;
+	/* answer the GetPosition calls that waited for this */
+	for (l = gsmloc->pending_position_calls; l; l = l->next) {
+		geoclue_gsmloc_return_position (gsmloc, l->data);
+	}
+	g_slist_free (gsmloc->pending_position_calls);
+	gsmloc->pending_position_calls = NULL;
+}
+
+static void
+opencellid_query_done (GObject      *source,
+                       GAsyncResult *result,
+                       gpointer      userdata)
+{
+	GcWebService *web_service = GC_WEB_SERVICE (source);
+	OpencellidQuery *query = userdata;
+	GeoclueGsmloc *gsmloc = query->gsmloc;
+	double lat = 0.0, lon = 0.0;
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	gboolean success;
+
+	success = gc_web_service_query_finish (web_service, result, NULL);
+
+	/* cell has changed since this query was started: 
+	 * a newer query is on its way */
+	if (query->serial != gsmloc->query_serial) {
+		g_object_unref (gsmloc);
+		g_free (query);
+		return;
+	}
+
+	if (success) {
+		if (gc_web_service_get_double (web_service, 
+		                               &lat, OPENCELLID_LAT)) {
+			fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+		}
+		if (gc_web_service_get_double (web_service, 
+		                               &lon, OPENCELLID_LON)) {
+			fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
+		}
+
+		if (fields != GEOCLUE_POSITION_FIELDS_NONE) {
+			char *retval_cid;
+			/* if cellid is not present, location is for the local area code.
+			 * the accuracy might be an overstatement -- I have no idea how 
+			 * big LACs typically are */
+			level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
+			if (gc_web_service_get_string (web_service, 
+			                               &retval_cid, OPENCELLID_CID)) {
+				if (retval_cid && strlen (retval_cid) != 0) {
+					level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
+				}
+				g_free (retval_cid);
+			}
+		}
+	}
+
+	geoclue_gsmloc_set_position (gsmloc, fields, lat, lon, level);
+
+	g_object_unref (gsmloc);
+	g_free (query);
+}
+
+/* Start an opencellid lookup for the current cell. The result is
+ * handled in opencellid_query_done() */
+static void
+geoclue_gsmloc_query_opencellid (GeoclueGsmloc *gsmloc)
+{
+	OpencellidQuery *query;
+
+	gsmloc->query_serial++;
+
+	if (!gsmloc->mcc || !gsmloc->mnc ||
+	    !gsmloc->lac || !gsmloc->cid) {
+		geoclue_gsmloc_set_position (gsmloc, GEOCLUE_POSITION_FIELDS_NONE,
+		                             0.0, 0.0, GEOCLUE_ACCURACY_LEVEL_NONE);
+		return;
+	}
+
+	query = g_new0 (OpencellidQuery, 1);
+	query->gsmloc = g_object_ref (gsmloc);
+	query->serial = gsmloc->query_serial;
+
+	gc_web_service_query_async (gsmloc->web_service, NULL,
+	                            opencellid_query_done, query,
+	                            "mcc", gsmloc->mcc,
+	                            "mnc", gsmloc->mnc,
+	                            "lac", gsmloc->lac,
+	                            "cellid", gsmloc->cid,
+	                            (char *)0);
 }
 
 static void
@@ -291,43 +374,29 @@ network_data_changed_cb (gpointer connection_manager,
 
 /* Position interface implementation */
 
-static gboolean 
-geoclue_gsmloc_get_position (GcIfacePosition        *iface,
-                             GeocluePositionFields  *fields,
-                             int                    *timestamp,
-                             double                 *latitude,
-                             double                 *longitude,
-                             double                 *altitude,
-                             GeoclueAccuracy       **accuracy,
-                             GError                **error)
+static void
+geoclue_gsmloc_get_position_async (GcIfacePosition       *iface,
+                                   DBusGMethodInvocation *context)
 {
 	GeoclueGsmloc *gsmloc;
 
 	gsmloc = (GEOCLUE_GSMLOC (iface));
 
-	if (gsmloc->last_position_fields == GEOCLUE_POSITION_FIELDS_NONE) {
-		/* re-query in case there was a network problem */
-		geoclue_gsmloc_query_opencellid (gsmloc);
-	}
+	if (gsmloc->last_position_fields == GEOCLUE_POSITION_FIELDS_NONE &&
+	    gsmloc->mcc && gsmloc->mnc && gsmloc->lac && gsmloc->cid) {
+		/* re-query in case there was a network problem, 
+		 * and reply when it's done */
+		gboolean query_running = (gsmloc->pending_position_calls != NULL);
 
-	if (timestamp) {
-		*timestamp = time (NULL);
-	}
-
-	if (fields) {
-		*fields = gsmloc->last_position_fields;
-	}
-	if (latitude) {
-		*latitude = gsmloc->last_lat;
-	}
-	if (longitude) {
-		*longitude = gsmloc->last_lon;
-	}
-	if (accuracy) {
-		*accuracy = geoclue_accuracy_new (gsmloc->last_accuracy_level, 0, 0);
+		gsmloc->pending_position_calls = 
+			g_slist_prepend (gsmloc->pending_position_calls, context);
+		if (!query_running) {
+			geoclue_gsmloc_query_opencellid (gsmloc);
+		}
+		return;
 	}
 
-	return TRUE;
+	geoclue_gsmloc_return_position (gsmloc, context);
 }
 
 /* Address interface implementation */
@@ -414,6 +483,10 @@ geoclue_gsmloc_init (GeoclueGsmloc *gsmloc)
 
 	gsmloc->web_service = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (gsmloc->web_service, OPENCELLID_URL);
+	gc_web_service_set_cache (gsmloc->web_service,
+	                          OPENCELLID_CACHE_TTL, OPENCELLID_CACHE_SIZE);
+	gc_web_service_set_disk_cache (gsmloc->web_service, "gsmloc",
+	                               OPENCELLID_DISK_CACHE_TTL);
 
 	geoclue_gsmloc_set_cell (gsmloc, NULL, NULL, NULL, NULL);
 
@@ -433,7 +506,7 @@ geoclue_gsmloc_init (GeoclueGsmloc *gsmloc)
 static void
 geoclue_gsmloc_position_init (GcIfacePositionClass  *iface)
 {
-	iface->get_position = geoclue_gsmloc_get_position;
+	iface->get_position_async = geoclue_gsmloc_get_position_async;
 }
 
 static void
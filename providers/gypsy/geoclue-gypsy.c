@@ -33,6 +33,7 @@
 #include <geoclue/gc-provider.h>
 #include <geoclue/gc-iface-position.h>
 #include <geoclue/gc-iface-velocity.h>
+#include <geoclue/gc-iface-fix.h>
 
 typedef struct {
 	GcProvider parent;
@@ -64,6 +65,9 @@ typedef struct {
 	double climb;
 
 	GeoclueAccuracy *accuracy;
+
+	/* pending PositionAndVelocityChanged */
+	guint fix_idle_id;
 } GeoclueGypsy;
 
 typedef struct {
@@ -80,7 +84,8 @@ G_DEFINE_TYPE_WITH_CODE (GeoclueGypsy, geoclue_gypsy, GC_TYPE_PROVIDER,
 			 G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_POSITION,
 						geoclue_gypsy_position_init)
 			 G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_VELOCITY,
-						geoclue_gypsy_velocity_init))
+						geoclue_gypsy_velocity_init)
+			 G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_FIX, NULL))
 
 
 /* GcIfaceGeoclue methods */
@@ -143,6 +148,33 @@ gypsy_course_to_geoclue (GypsyCourseFields fields)
 	return gc_fields;
 }
 
+static gboolean
+emit_fix (gpointer data)
+{
+	GeoclueGypsy *gypsy = data;
+
+	gypsy->fix_idle_id = 0;
+	gc_iface_fix_emit_position_and_velocity_changed 
+		(GC_IFACE_FIX (gypsy),
+		 gypsy_position_to_geoclue (gypsy->position_fields),
+		 gypsy_course_to_geoclue (gypsy->course_fields),
+		 gypsy->timestamp,
+		 gypsy->latitude, gypsy->longitude, gypsy->altitude,
+		 gypsy->speed, gypsy->direction, gypsy->climb,
+		 gypsy->accuracy);
+	return FALSE;
+}
+
+/* Gypsy sends position, course and accuracy separately: changes that
+ * arrive together are sent on as one PositionAndVelocityChanged */
+static void
+queue_fix (GeoclueGypsy *gypsy)
+{
+	if (gypsy->fix_idle_id == 0) {
+		gypsy->fix_idle_id = g_idle_add (emit_fix, gypsy);
+	}
+}
+
 static void
 position_changed (GypsyPosition      *position,
 		  GypsyPositionFields fields,
@@ -192,6 +224,7 @@ position_changed (GypsyPosition      *position,
 			(GC_IFACE_POSITION (gypsy), fields,
 			 timestamp, gypsy->latitude, gypsy->longitude, 
 			 gypsy->altitude, gypsy->accuracy);
+		queue_fix (gypsy);
 	}
 }
 
@@ -241,6 +274,7 @@ course_changed (GypsyCourse      *course,
 		gc_iface_velocity_emit_velocity_changed 
 			(GC_IFACE_VELOCITY (gypsy), fields,
 			 timestamp, gypsy->speed, gypsy->direction, gypsy->climb);
+		queue_fix (gypsy);
 	}
 }
 		
@@ -287,6 +321,7 @@ accuracy_changed (GypsyAccuracy      *accuracy,
 			(GC_IFACE_POSITION (gypsy), fields,
 			 gypsy->timestamp, gypsy->latitude, gypsy->longitude, 
 			 gypsy->altitude, gypsy->accuracy);
+		queue_fix (gypsy);
 	}
 }
 
@@ -494,6 +529,11 @@ dispose (GObject *object)
 {
 	GeoclueGypsy *gypsy = GEOCLUE_GYPSY (object);
 
+	if (gypsy->fix_idle_id) {
+		g_source_remove (gypsy->fix_idle_id);
+		gypsy->fix_idle_id = 0;
+	}
+
 	if (gypsy->control) {
 		g_object_unref (gypsy->control);
 		gypsy->control = NULL;
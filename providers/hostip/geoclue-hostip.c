@@ -80,129 +80,150 @@ shutdown (GcProvider *provider)
 
 /* Position interface implementation */
 
-static gboolean 
-geoclue_hostip_get_position (GcIfacePosition        *iface,
-                                 GeocluePositionFields  *fields,
-                                 int                    *timestamp,
-                                 double                 *latitude,
-                                 double                 *longitude,
-                                 double                 *altitude,
-                                 GeoclueAccuracy       **accuracy,
-                                 GError                **error)
+static void
+geoclue_hostip_position_query_done (GObject      *source,
+                                    GAsyncResult *result,
+                                    gpointer      userdata)
 {
-	GeoclueHostip *obj = (GEOCLUE_HOSTIP (iface));
+	GcWebService *web_service = GC_WEB_SERVICE (source);
+	DBusGMethodInvocation *context = userdata;
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double latitude = 0.0, longitude = 0.0;
+	GeoclueAccuracy *accuracy;
 	gchar *coord_str = NULL;
+	GError *error = NULL;
 	
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	
-	if (!gc_web_service_query (obj->web_service, error, (char *)0)) {
-		return FALSE;
+	if (!gc_web_service_query_finish (web_service, result, &error)) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
 	}
 	
-	if (gc_web_service_get_string (obj->web_service, 
+	if (gc_web_service_get_string (web_service, 
 	                                &coord_str, HOSTIP_LATLON_XPATH)) {
-		if (sscanf (coord_str, "%lf,%lf", longitude , latitude) == 2) {
-			*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
-			*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+		if (sscanf (coord_str, "%lf,%lf", &longitude , &latitude) == 2) {
+			fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
+			fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
 		}
 		g_free (coord_str);
 	}
 	
-	time ((time_t *)timestamp);
-	
-	if (*fields == GEOCLUE_POSITION_FIELDS_NONE) {
-		*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
-		                                  0, 0); 
+	if (fields == GEOCLUE_POSITION_FIELDS_NONE) {
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+		                                 0, 0); 
 	} else {
-		*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_LOCALITY,
-		                                  0, 0);
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_LOCALITY,
+		                                 0, 0);
 	}
-	return TRUE;
+	
+	dbus_g_method_return (context, fields, (int)time (NULL),
+	                      latitude, longitude, 0.0, accuracy);
+	geoclue_accuracy_free (accuracy);
+}
+
+static void
+geoclue_hostip_get_position_async (GcIfacePosition       *iface,
+                                   DBusGMethodInvocation *context)
+{
+	GeoclueHostip *obj = GEOCLUE_HOSTIP (iface);
+	
+	gc_web_service_query_async (obj->web_service, NULL,
+	                            geoclue_hostip_position_query_done,
+	                            context, (char *)0);
 }
 
 /* Address interface implementation */
 
-static gboolean 
-geoclue_hostip_get_address (GcIfaceAddress   *iface,
-                            int              *timestamp,
-                            GHashTable      **address,
-                            GeoclueAccuracy **accuracy,
-                            GError          **error)
+static void
+geoclue_hostip_address_query_done (GObject      *source,
+                                   GAsyncResult *result,
+                                   gpointer      userdata)
 {
-	GeoclueHostip *obj = GEOCLUE_HOSTIP (iface);
+	GcWebService *web_service = GC_WEB_SERVICE (source);
+	DBusGMethodInvocation *context = userdata;
+	GHashTable *address;
+	GeoclueAccuracy *accuracy;
 	gchar *locality = NULL;
 	gchar *country = NULL;
 	gchar *country_code = NULL;
+	GError *error = NULL;
 	
-	if (!gc_web_service_query (obj->web_service, error, (char *)0)) {
-		return FALSE;
+	if (!gc_web_service_query_finish (web_service, result, &error)) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
 	}
 	
-	if (address) {
-		*address = geoclue_address_details_new ();
-		if (gc_web_service_get_string (obj->web_service, 
-					       &locality, HOSTIP_LOCALITY_XPATH)) {
-			/* hostip "sctructured data" for the win... */
-			if (g_ascii_strcasecmp (locality, "(Unknown city)") == 0 ||
-			    g_ascii_strcasecmp (locality, "(Unknown City?)") == 0) {
-
-				g_free (locality);
-				locality = NULL;
-			} else {
-				geoclue_address_details_insert (*address,
-				                                GEOCLUE_ADDRESS_KEY_LOCALITY,
-				                                locality);
-			}
-		}
-		
-		if (gc_web_service_get_string (obj->web_service, 
-					       &country_code, HOSTIP_COUNTRYCODE_XPATH)) {
-			if (g_ascii_strcasecmp (country_code, "XX") == 0) {
-				g_free (country_code);
-				country_code = NULL;
-			} else {
-				geoclue_address_details_insert (*address,
-				                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
-				                                country_code);
-				geoclue_address_details_set_country_from_code (*address);
-			}
-		}
+	address = geoclue_address_details_new ();
+	if (gc_web_service_get_string (web_service, 
+				       &locality, HOSTIP_LOCALITY_XPATH)) {
+		/* hostip "sctructured data" for the win... */
+		if (g_ascii_strcasecmp (locality, "(Unknown city)") == 0 ||
+		    g_ascii_strcasecmp (locality, "(Unknown City?)") == 0) {
 
-		if (!g_hash_table_lookup (*address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
-		    gc_web_service_get_string (obj->web_service, 
-		                               &country, HOSTIP_COUNTRY_XPATH)) {
-			if (g_ascii_strcasecmp (country, "(Unknown Country?)") == 0) {
-				g_free (country);
-				country = NULL;
-			} else {
-				geoclue_address_details_insert (*address,
-				                                GEOCLUE_ADDRESS_KEY_COUNTRY,
-				                                country);
-			}
+			g_free (locality);
+			locality = NULL;
+		} else {
+			geoclue_address_details_insert (address,
+			                                GEOCLUE_ADDRESS_KEY_LOCALITY,
+			                                locality);
 		}
 	}
-
-	if (timestamp) {
-		*timestamp = time (NULL);
+	
+	if (gc_web_service_get_string (web_service, 
+				       &country_code, HOSTIP_COUNTRYCODE_XPATH)) {
+		if (g_ascii_strcasecmp (country_code, "XX") == 0) {
+			g_free (country_code);
+			country_code = NULL;
+		} else {
+			geoclue_address_details_insert (address,
+			                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
+			                                country_code);
+			geoclue_address_details_set_country_from_code (address);
+		}
 	}
 
-	if (accuracy) {
-		if (locality && country) {
-			*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_LOCALITY,
-							  0, 0);
-		} else if (country) {
-			*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_COUNTRY,
-							  0, 0);
+	if (!g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
+	    gc_web_service_get_string (web_service, 
+	                               &country, HOSTIP_COUNTRY_XPATH)) {
+		if (g_ascii_strcasecmp (country, "(Unknown Country?)") == 0) {
+			g_free (country);
+			country = NULL;
 		} else {
-			*accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
-							  0, 0);
+			geoclue_address_details_insert (address,
+			                                GEOCLUE_ADDRESS_KEY_COUNTRY,
+			                                country);
 		}
 	}
+
+	if (locality && country) {
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_LOCALITY,
+						 0, 0);
+	} else if (country) {
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_COUNTRY,
+						 0, 0);
+	} else {
+		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+						 0, 0);
+	}
 	g_free (locality);
 	g_free (country);
 	g_free (country_code);
 
-	return TRUE;
+	dbus_g_method_return (context, (int)time (NULL), address, accuracy);
+	g_hash_table_destroy (address);
+	geoclue_accuracy_free (accuracy);
+}
+
+static void
+geoclue_hostip_get_address_async (GcIfaceAddress        *iface,
+                                  DBusGMethodInvocation *context)
+{
+	GeoclueHostip *obj = GEOCLUE_HOSTIP (iface);
+	
+	gc_web_service_query_async (obj->web_service, NULL,
+	                            geoclue_hostip_address_query_done,
+	                            context, (char *)0);
 }
 
 static void
@@ -247,13 +268,13 @@ geoclue_hostip_init (GeoclueHostip *obj)
 static void
 geoclue_hostip_position_init (GcIfacePositionClass  *iface)
 {
-	iface->get_position = geoclue_hostip_get_position;
+	iface->get_position_async = geoclue_hostip_get_position_async;
 }
 
 static void
 geoclue_hostip_address_init (GcIfaceAddressClass  *iface)
 {
-	iface->get_address = geoclue_hostip_get_address;
+	iface->get_address_async = geoclue_hostip_get_address_async;
 }
 
 int 
@@ -34,27 +34,87 @@
 #define GEOCODE_URL "http://nominatim.openstreetmap.org/search"
 #define REV_GEOCODE_URL "http://nominatim.openstreetmap.org/reverse"
 
-#define NOMINATIM_HOUSE "//reversegeocode/addressparts/house"
-#define NOMINATIM_ROAD "//reversegeocode/addressparts/road"
-#define NOMINATIM_VILLAGE "//reversegeocode/addressparts/village"
-#define NOMINATIM_SUBURB "//reversegeocode/addressparts/suburb"
-#define NOMINATIM_CITY "//reversegeocode/addressparts/city"
-#define NOMINATIM_POSTCODE "//reversegeocode/addressparts/postcode"
-#define NOMINATIM_COUNTY "//reversegeocode/addressparts/county"
-#define NOMINATIM_COUNTRY "//reversegeocode/addressparts/country"
-#define NOMINATIM_COUNTRYCODE "//reversegeocode/addressparts/country_code"
-
-#define NOMINATIM_LAT "//searchresults/place[1]/@lat"
-#define NOMINATIM_LON "//searchresults/place[1]/@lon"
-#define NOMINATIM_LATLON_HOUSE "//searchresults/place[1]/house"
-#define NOMINATIM_LATLON_ROAD "//searchresults/place[1]/road"
-#define NOMINATIM_LATLON_VILLAGE "//searchresults/place[1]/village"
-#define NOMINATIM_LATLON_SUBURB "//searchresults/place[1]/suburb"
-#define NOMINATIM_LATLON_POSTCODE "//searchresults/place[1]/postcode"
-#define NOMINATIM_LATLON_CITY "//searchresults/place[1]/city"
-#define NOMINATIM_LATLON_COUNTY "//searchresults/place[1]/county"
-#define NOMINATIM_LATLON_COUNTRY "//searchresults/place[1]/country"
-#define NOMINATIM_LATLON_COUNTRYCODE "//searchresults/place[1]/countrycode"
+/* per web service response cache */
+#define CACHE_TTL (60 * 60)
+#define CACHE_SIZE (256 * 1024)
+#define DISK_CACHE_TTL (7 * 24 * 60 * 60)
+
+/* Root element paths: unlike "//" they don't scan the whole document */
+#define NOMINATIM_HOUSE "/reversegeocode/addressparts/house"
+#define NOMINATIM_ROAD "/reversegeocode/addressparts/road"
+#define NOMINATIM_VILLAGE "/reversegeocode/addressparts/village"
+#define NOMINATIM_SUBURB "/reversegeocode/addressparts/suburb"
+#define NOMINATIM_CITY "/reversegeocode/addressparts/city"
+#define NOMINATIM_POSTCODE "/reversegeocode/addressparts/postcode"
+#define NOMINATIM_COUNTY "/reversegeocode/addressparts/county"
+#define NOMINATIM_COUNTRY "/reversegeocode/addressparts/country"
+#define NOMINATIM_COUNTRYCODE "/reversegeocode/addressparts/country_code"
+
+#define NOMINATIM_LAT "/searchresults/place[1]/@lat"
+#define NOMINATIM_LON "/searchresults/place[1]/@lon"
+#define NOMINATIM_LATLON_HOUSE "/searchresults/place[1]/house"
+#define NOMINATIM_LATLON_ROAD "/searchresults/place[1]/road"
+#define NOMINATIM_LATLON_VILLAGE "/searchresults/place[1]/village"
+#define NOMINATIM_LATLON_SUBURB "/searchresults/place[1]/suburb"
+#define NOMINATIM_LATLON_POSTCODE "/searchresults/place[1]/postcode"
+#define NOMINATIM_LATLON_CITY "/searchresults/place[1]/city"
+#define NOMINATIM_LATLON_COUNTY "/searchresults/place[1]/county"
+#define NOMINATIM_LATLON_COUNTRY "/searchresults/place[1]/country"
+#define NOMINATIM_LATLON_COUNTRYCODE "/searchresults/place[1]/countrycode"
+
+/* Fields extracted from geocode responses, in gc_web_service_add_field() order */
+enum {
+	GEOCODE_LAT,
+	GEOCODE_LON,
+	GEOCODE_HOUSE,
+	GEOCODE_ROAD,
+	GEOCODE_VILLAGE,
+	GEOCODE_SUBURB,
+	GEOCODE_POSTCODE,
+	GEOCODE_CITY,
+	GEOCODE_COUNTY,
+	GEOCODE_COUNTRY,
+	GEOCODE_COUNTRYCODE,
+	N_GEOCODE_FIELDS
+};
+
+static const char *geocode_fields[N_GEOCODE_FIELDS] = {
+	NOMINATIM_LAT,
+	NOMINATIM_LON,
+	NOMINATIM_LATLON_HOUSE,
+	NOMINATIM_LATLON_ROAD,
+	NOMINATIM_LATLON_VILLAGE,
+	NOMINATIM_LATLON_SUBURB,
+	NOMINATIM_LATLON_POSTCODE,
+	NOMINATIM_LATLON_CITY,
+	NOMINATIM_LATLON_COUNTY,
+	NOMINATIM_LATLON_COUNTRY,
+	NOMINATIM_LATLON_COUNTRYCODE
+};
+
+/* Fields extracted from reverse geocode responses */
+enum {
+	REV_HOUSE,
+	REV_ROAD,
+	REV_VILLAGE,
+	REV_CITY,
+	REV_POSTCODE,
+	REV_COUNTY,
+	REV_COUNTRY,
+	REV_COUNTRYCODE,
+	N_REV_FIELDS
+};
+
+static const char *rev_fields[N_REV_FIELDS] = {
+	NOMINATIM_HOUSE,
+	NOMINATIM_ROAD,
+	NOMINATIM_VILLAGE,
+	NOMINATIM_CITY,
+	NOMINATIM_POSTCODE,
+	NOMINATIM_COUNTY,
+	NOMINATIM_COUNTRY,
+	NOMINATIM_COUNTRYCODE
+};
  
 static void geoclue_nominatim_init (GeoclueNominatim *obj);
 static void geoclue_nominatim_geocode_init (GcIfaceGeocodeClass *iface);
@@ -103,34 +163,35 @@ search_string_append (GString *str, const char *val)
 	g_string_append (str, val);
 }
 
+static void
+free_fields (char **values, int n_fields)
+{
+	int i;
+
+	for (i = 0; i < n_fields; i++) {
+		g_free (values[i]);
+	}
+}
+
 static GeoclueAccuracy*
-get_geocode_accuracy (GcWebService *geocoder)
+get_geocode_accuracy (char **values)
 {
-	char *str;
 	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
 
-	if (gc_web_service_get_string (geocoder, &str, NOMINATIM_LATLON_HOUSE)) {
+	if (values[GEOCODE_HOUSE]) {
 		level = GEOCLUE_ACCURACY_LEVEL_DETAILED;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_ROAD)) {
+	} else if (values[GEOCODE_ROAD]) {
 		level = GEOCLUE_ACCURACY_LEVEL_STREET;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_SUBURB) ||
-	           gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_POSTCODE) ||
-	           gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_VILLAGE)) {
+	} else if (values[GEOCODE_SUBURB] ||
+	           values[GEOCODE_POSTCODE] ||
+	           values[GEOCODE_VILLAGE]) {
 		level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_CITY)) {
+	} else if (values[GEOCODE_CITY]) {
 		level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_COUNTY)) {
+	} else if (values[GEOCODE_COUNTY]) {
 		level = GEOCLUE_ACCURACY_LEVEL_REGION;
-	} else if (gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_COUNTRY) ||
-	           gc_web_service_get_string (geocoder, &str,
-	                                      NOMINATIM_LATLON_COUNTRYCODE)) {
+	} else if (values[GEOCODE_COUNTRY] ||
+	           values[GEOCODE_COUNTRYCODE]) {
 		level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
 	}
 
@@ -138,17 +199,88 @@ get_geocode_accuracy (GcWebService *geocoder)
 }
 
 /* Geocode interface implementation */
-static gboolean
-geoclue_nominatim_address_to_position (GcIfaceGeocode        *iface,
-                                       GHashTable            *address,
-                                       GeocluePositionFields *fields,
-                                       double                *latitude,
-                                       double                *longitude,
-                                       double                *altitude,
-                                       GeoclueAccuracy      **accuracy,
-                                       GError               **error)
+
+/* A single query is answered through context, a query that is part
+ * of an AddressesToPositions call through batch */
+typedef struct _GeocodeQuery {
+	GeoclueNominatim *obj;  /* held while the web query runs */
+	DBusGMethodInvocation *context;
+	GcIfaceGeocodeBatch *batch;
+	guint index;
+} GeocodeQuery;
+
+/* GAsyncReadyCallback for all geocode queries */
+static void
+geocode_query_done (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      userdata)
+{
+	GcWebService *geocoder = GC_WEB_SERVICE (source);
+	GeocodeQuery *query = userdata;
+	GeoclueNominatim *obj = query->obj;
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double latitude = 0.0, longitude = 0.0;
+	GeoclueAccuracy *accuracy;
+	char *values[N_GEOCODE_FIELDS];
+	GError *error = NULL;
+
+	if (!gc_web_service_query_finish (geocoder, result, &error)) {
+		if (query->batch) {
+			gc_iface_geocode_batch_return (query->batch, query->index,
+			                               fields, 0.0, 0.0, 0.0, NULL);
+		} else {
+			dbus_g_method_return_error (query->context, error);
+		}
+		g_error_free (error);
+		g_free (query);
+		g_object_unref (obj);
+		return;
+	}
+
+	gc_web_service_get_fields (geocoder, values);
+
+	if (values[GEOCODE_LAT]) {
+		latitude = g_ascii_strtod (values[GEOCODE_LAT], NULL);
+		fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+	}
+	if (values[GEOCODE_LON]) {
+		longitude = g_ascii_strtod (values[GEOCODE_LON], NULL);
+		fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
+	}
+
+	accuracy = get_geocode_accuracy (values); 
+	free_fields (values, N_GEOCODE_FIELDS);
+
+	if (query->batch) {
+		gc_iface_geocode_batch_return (query->batch, query->index, fields,
+		                               latitude, longitude, 0.0, accuracy);
+	} else {
+		dbus_g_method_return (query->context, fields,
+		                      latitude, longitude, 0.0, accuracy);
+	}
+	geoclue_accuracy_free (accuracy);
+	g_free (query);
+	g_object_unref (obj);
+}
+
+static void
+geocode_query_start (GeoclueNominatim *obj,
+                     const char       *search,
+                     GeocodeQuery     *query)
+{
+	query->obj = g_object_ref (obj);
+	gc_web_service_query_async (obj->geocoder, NULL,
+	                            geocode_query_done, query,
+	                            "q", search,
+	                            "format", "xml",
+	                            "polygon", "0",
+	                            "addressdetails", "1",
+	                            (char *)0);
+}
+
+static char *
+get_search_string (GHashTable *address)
 {
-	GeoclueNominatim *obj = GEOCLUE_NOMINATIM (iface);
 	gchar *country, *region, *locality, *postalcode, *street;
 	GString *str;
 
@@ -165,196 +297,240 @@ geoclue_nominatim_address_to_position (GcIfaceGeocode        *iface,
 	search_string_append (str, postalcode);
 	search_string_append (str, country);
 
-	if (!gc_web_service_query (obj->geocoder, error,
-	                           "q", str->str,
-	                           "format", "xml",
-	                           "polygon", "0",
-	                           "addressdetails", "1",
-	                           (char *)0)) {
-		g_string_free (str, TRUE);
-		return FALSE;
-	}
-	g_string_free (str, TRUE);
-
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	if (latitude && gc_web_service_get_double (obj->geocoder, 
-	                                           latitude, NOMINATIM_LAT)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-	}
+	return g_string_free (str, FALSE);
+}
 
-	if (longitude &&  gc_web_service_get_double (obj->geocoder, 
-	                                             longitude, NOMINATIM_LON)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
-	}
+static void
+geoclue_nominatim_address_to_position_async (GcIfaceGeocode        *iface,
+                                             GHashTable            *address,
+                                             DBusGMethodInvocation *context)
+{
+	GeocodeQuery *query;
+	char *search;
 
-	if (accuracy) {
-		*accuracy = get_geocode_accuracy (obj->geocoder); 
-	}
+	query = g_new0 (GeocodeQuery, 1);
+	query->context = context;
 
-	return TRUE;
+	search = get_search_string (address);
+	geocode_query_start (GEOCLUE_NOMINATIM (iface), search, query);
+	g_free (search);
 }
 
-static gboolean
-geoclue_nominatim_freeform_address_to_position (GcIfaceGeocode        *iface,
-                                                const char            *address,
-                                                GeocluePositionFields *fields,
-                                                double                *latitude,
-                                                double                *longitude,
-                                                double                *altitude,
-                                                GeoclueAccuracy      **accuracy,
-                                                GError               **error)
+static void
+geoclue_nominatim_freeform_address_to_position_async (GcIfaceGeocode        *iface,
+                                                      const char            *address,
+                                                      DBusGMethodInvocation *context)
 {
-	GeoclueNominatim *obj = GEOCLUE_NOMINATIM (iface);
-
-	if (!gc_web_service_query (obj->geocoder, error,
-	                           "q", address,
-	                           "format", "xml",
-	                           "polygon", "0",
-	                           "addressdetails", "1",
-	                           (char *)0)) {
-		return FALSE;
-	}
+	GeocodeQuery *query;
 
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	if (latitude && gc_web_service_get_double (obj->geocoder,
-	                                           latitude, NOMINATIM_LAT)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-	}
+	query = g_new0 (GeocodeQuery, 1);
+	query->context = context;
 
-	if (longitude &&  gc_web_service_get_double (obj->geocoder,
-	                                             longitude, NOMINATIM_LON)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
-	}
+	geocode_query_start (GEOCLUE_NOMINATIM (iface), address, query);
+}
 
-	if (accuracy) {
-		*accuracy = get_geocode_accuracy (obj->geocoder);
-	}
+static void
+geoclue_nominatim_batch_address_to_position (GcIfaceGeocode      *iface,
+                                             GHashTable          *address,
+                                             GcIfaceGeocodeBatch *batch,
+                                             guint                index)
+{
+	GeocodeQuery *query;
+	char *search;
 
-	return TRUE;
+	query = g_new0 (GeocodeQuery, 1);
+	query->batch = batch;
+	query->index = index;
+
+	search = get_search_string (address);
+	geocode_query_start (GEOCLUE_NOMINATIM (iface), search, query);
+	g_free (search);
 }
 
 /* ReverseGeocode interface implementation */
 
-static gboolean
-geoclue_nominatim_position_to_address (GcIfaceReverseGeocode  *iface,
-                                       double                  latitude,
-                                       double                  longitude,
-                                       GeoclueAccuracy        *position_accuracy,
-                                       GHashTable            **address,
-                                       GeoclueAccuracy       **address_accuracy,
-                                       GError                **error)
+/* A single query is answered through context, a query that is part
+ * of a PositionsToAddresses call through batch */
+typedef struct _ReverseGeocodeQuery {
+	GeoclueNominatim *obj;  /* held while the web query runs */
+	DBusGMethodInvocation *context;
+	GcIfaceReverseGeocodeBatch *batch;
+	guint index;
+	GeoclueAccuracyLevel in_acc;
+} ReverseGeocodeQuery;
+
+static GHashTable *
+get_reverse_geocode_address (char                 **values,
+                             GeoclueAccuracyLevel   in_acc)
 {
-	GeoclueNominatim *obj = GEOCLUE_NOMINATIM (iface);
-	gchar *locality = NULL;
-	gchar *region = NULL;
-	gchar *country = NULL;
-	gchar *countrycode = NULL;
-	gchar *area = NULL;
-	gchar *street = NULL;
-	gchar *postcode = NULL;
-
-	GeoclueAccuracyLevel in_acc = GEOCLUE_ACCURACY_LEVEL_DETAILED;
-	gchar lat[G_ASCII_DTOSTR_BUF_SIZE];
-	gchar lon[G_ASCII_DTOSTR_BUF_SIZE];
-
-	if (!address) {
-		return TRUE;
-	}
-
-	g_ascii_dtostr (lat, G_ASCII_DTOSTR_BUF_SIZE, latitude);
-	g_ascii_dtostr (lon, G_ASCII_DTOSTR_BUF_SIZE, longitude);
-	if (!gc_web_service_query (obj->rev_geocoder, error,
-	                           "lat", lat,
-	                           "lon", lon,
-	                           "format", "xml",
-	                           "zoom", "18", /* could set this based on position_accuracy */
-                               "addressdetails", "1",
-	                           (char *)0)) {
-		return FALSE;
-	}
-
-	if (position_accuracy) {
-		geoclue_accuracy_get_details (position_accuracy, &in_acc, NULL, NULL);
-	}
+	GHashTable *address;
 
-	*address = geoclue_address_details_new ();
+	address = geoclue_address_details_new ();
 
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &countrycode, NOMINATIM_COUNTRYCODE)) {
-		geoclue_address_details_insert (*address,
+	    values[REV_COUNTRYCODE]) {
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
-		                                countrycode);
-		g_free (countrycode);
-		geoclue_address_details_set_country_from_code (*address);
+		                                values[REV_COUNTRYCODE]);
+		geoclue_address_details_set_country_from_code (address);
 	}
-	if (!g_hash_table_lookup (*address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
+	if (!g_hash_table_lookup (address, GEOCLUE_ADDRESS_KEY_COUNTRY) &&
 	    in_acc >= GEOCLUE_ACCURACY_LEVEL_COUNTRY && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &country, NOMINATIM_COUNTRY)) {
-		geoclue_address_details_insert (*address,
+	    values[REV_COUNTRY]) {
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_COUNTRY,
-		                                country);
-		g_free (country);
+		                                values[REV_COUNTRY]);
 	}
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_REGION && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &region, NOMINATIM_COUNTY)) {
-		geoclue_address_details_insert (*address,
+	    values[REV_COUNTY]) {
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_REGION,
-		                                region);
-		g_free (region);
+		                                values[REV_COUNTY]);
 	}
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_LOCALITY && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &locality, NOMINATIM_CITY)) {
-		geoclue_address_details_insert (*address,
+	    values[REV_CITY]) {
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_LOCALITY,
-		                                locality);
-		g_free (locality);
+		                                values[REV_CITY]);
 	}
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_POSTALCODE && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &area, NOMINATIM_VILLAGE)) {
-		geoclue_address_details_insert (*address,
+	    values[REV_VILLAGE]) {
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_AREA,
-		                                area);
-		g_free (area);
+		                                values[REV_VILLAGE]);
 	}
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_POSTALCODE && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &postcode, NOMINATIM_POSTCODE)) {
-		geoclue_address_details_insert (*address,
+	    values[REV_POSTCODE]) {
+		geoclue_address_details_insert (address,
 		                                GEOCLUE_ADDRESS_KEY_POSTALCODE,
-		                                postcode);
-		g_free (postcode);
+		                                values[REV_POSTCODE]);
 	}
 	if (in_acc >= GEOCLUE_ACCURACY_LEVEL_STREET && 
-	    gc_web_service_get_string (obj->rev_geocoder,
-	                               &street, NOMINATIM_ROAD)) {
-		char *nr;
-
-		if (gc_web_service_get_string (obj->rev_geocoder,
-		                               &nr, NOMINATIM_HOUSE)) {
-			char *full_street = g_strdup_printf ("%s %s", street, nr);
-			geoclue_address_details_insert (*address,
+	    values[REV_ROAD]) {
+		if (values[REV_HOUSE]) {
+			char *full_street = g_strdup_printf ("%s %s", 
+			                                     values[REV_ROAD],
+			                                     values[REV_HOUSE]);
+			geoclue_address_details_insert (address,
 			                                GEOCLUE_ADDRESS_KEY_STREET,
 			                                full_street);
-			g_free (nr);
 			g_free (full_street);
 		} else  {
-			geoclue_address_details_insert (*address,
+			geoclue_address_details_insert (address,
 			                                GEOCLUE_ADDRESS_KEY_STREET,
-			                                street);
+			                                values[REV_ROAD]);
 		}
-		g_free (street);
 	}
 
-	if (address_accuracy) { 
-		GeoclueAccuracyLevel level = geoclue_address_details_get_accuracy_level (*address);
-		*address_accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
+	return address;
+}
+
+static void
+reverse_geocode_query_done (GObject      *source,
+                            GAsyncResult *result,
+                            gpointer      userdata)
+{
+	GcWebService *rev_geocoder = GC_WEB_SERVICE (source);
+	ReverseGeocodeQuery *query = userdata;
+	GeoclueNominatim *obj = query->obj;
+	GHashTable *address;
+	GeoclueAccuracy *address_accuracy;
+	GeoclueAccuracyLevel level;
+	char *values[N_REV_FIELDS];
+	GError *error = NULL;
+
+	if (!gc_web_service_query_finish (rev_geocoder, result, &error)) {
+		if (query->batch) {
+			gc_iface_reverse_geocode_batch_return (query->batch,
+			                                       query->index,
+			                                       NULL, NULL);
+		} else {
+			dbus_g_method_return_error (query->context, error);
+		}
+		g_error_free (error);
+		g_free (query);
+		g_object_unref (obj);
+		return;
 	}
-	return TRUE;
+
+	gc_web_service_get_fields (rev_geocoder, values);
+	address = get_reverse_geocode_address (values, query->in_acc);
+	free_fields (values, N_REV_FIELDS);
+	level = geoclue_address_details_get_accuracy_level (address);
+	address_accuracy = geoclue_accuracy_new (level, 0.0, 0.0);
+
+	if (query->batch) {
+		gc_iface_reverse_geocode_batch_return (query->batch, query->index,
+		                                       address, address_accuracy);
+	} else {
+		dbus_g_method_return (query->context, address, address_accuracy);
+	}
+	g_hash_table_destroy (address);
+	geoclue_accuracy_free (address_accuracy);
+	g_free (query);
+	g_object_unref (obj);
+}
+
+static void
+reverse_geocode_query_start (GeoclueNominatim    *obj,
+                             double               latitude,
+                             double               longitude,
+                             GeoclueAccuracy     *position_accuracy,
+                             ReverseGeocodeQuery *query)
+{
+	gchar lat[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar lon[G_ASCII_DTOSTR_BUF_SIZE];
+
+	query->in_acc = GEOCLUE_ACCURACY_LEVEL_DETAILED;
+	if (position_accuracy) {
+		geoclue_accuracy_get_details (position_accuracy, &query->in_acc, NULL, NULL);
+	}
+
+	g_ascii_dtostr (lat, G_ASCII_DTOSTR_BUF_SIZE, latitude);
+	g_ascii_dtostr (lon, G_ASCII_DTOSTR_BUF_SIZE, longitude);
+	query->obj = g_object_ref (obj);
+	gc_web_service_query_async (obj->rev_geocoder, NULL,
+	                            reverse_geocode_query_done, query,
+	                            "lat", lat,
+	                            "lon", lon,
+	                            "format", "xml",
+	                            "zoom", "18", /* could set this based on position_accuracy */
+	                            "addressdetails", "1",
+	                            (char *)0);
+}
+
+static void
+geoclue_nominatim_position_to_address_async (GcIfaceReverseGeocode  *iface,
+                                             double                  latitude,
+                                             double                  longitude,
+                                             GeoclueAccuracy        *position_accuracy,
+                                             DBusGMethodInvocation  *context)
+{
+	ReverseGeocodeQuery *query;
+
+	query = g_new0 (ReverseGeocodeQuery, 1);
+	query->context = context;
+	reverse_geocode_query_start (GEOCLUE_NOMINATIM (iface),
+	                             latitude, longitude,
+	                             position_accuracy, query);
+}
+
+static void
+geoclue_nominatim_batch_position_to_address (GcIfaceReverseGeocode      *iface,
+                                             double                      latitude,
+                                             double                      longitude,
+                                             GeoclueAccuracy            *position_accuracy,
+                                             GcIfaceReverseGeocodeBatch *batch,
+                                             guint                       index)
+{
+	ReverseGeocodeQuery *query;
+
+	query = g_new0 (ReverseGeocodeQuery, 1);
+	query->batch = batch;
+	query->index = index;
+	reverse_geocode_query_start (GEOCLUE_NOMINATIM (iface),
+	                             latitude, longitude,
+	                             position_accuracy, query);
 }
 
 static void
@@ -399,6 +575,8 @@ geoclue_nominatim_class_init (GeoclueNominatimClass *klass)
 static void
 geoclue_nominatim_init (GeoclueNominatim *obj)
 {
+	int i;
+
 	gc_provider_set_details (GC_PROVIDER (obj), 
 	                         GEOCLUE_NOMINATIM_DBUS_SERVICE,
 	                         GEOCLUE_NOMINATIM_DBUS_PATH,
@@ -406,22 +584,37 @@ geoclue_nominatim_init (GeoclueNominatim *obj)
 
 	obj->geocoder = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (obj->geocoder, GEOCODE_URL);
+	gc_web_service_set_cache (obj->geocoder, CACHE_TTL, CACHE_SIZE);
+	gc_web_service_set_disk_cache (obj->geocoder, "nominatim", DISK_CACHE_TTL);
 	
 	obj->rev_geocoder = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (obj->rev_geocoder, REV_GEOCODE_URL);
+	gc_web_service_set_cache (obj->rev_geocoder, CACHE_TTL, CACHE_SIZE);
+	gc_web_service_set_disk_cache (obj->rev_geocoder, "nominatim", DISK_CACHE_TTL);
+	
+	for (i = 0; i < N_GEOCODE_FIELDS; i++) {
+		gc_web_service_add_field (obj->geocoder, geocode_fields[i]);
+	}
+	for (i = 0; i < N_REV_FIELDS; i++) {
+		gc_web_service_add_field (obj->rev_geocoder, rev_fields[i]);
+	}
+	gc_web_service_set_streaming (obj->geocoder, TRUE);
+	gc_web_service_set_streaming (obj->rev_geocoder, TRUE);
 }
 
 static void
 geoclue_nominatim_geocode_init (GcIfaceGeocodeClass *iface)
 {
-	iface->address_to_position = geoclue_nominatim_address_to_position;
-	iface->freeform_address_to_position = geoclue_nominatim_freeform_address_to_position;
+	iface->address_to_position_async = geoclue_nominatim_address_to_position_async;
+	iface->freeform_address_to_position_async = geoclue_nominatim_freeform_address_to_position_async;
+	iface->batch_address_to_position = geoclue_nominatim_batch_address_to_position;
 }
 
 static void
 geoclue_nominatim_reverse_geocode_init (GcIfaceReverseGeocodeClass *iface)
 {
-	iface->position_to_address = geoclue_nominatim_position_to_address;
+	iface->position_to_address_async = geoclue_nominatim_position_to_address_async;
+	iface->batch_position_to_address = geoclue_nominatim_batch_position_to_address;
 }
 
 int 
@@ -102,207 +102,233 @@ geoclue_plazes_set_status (GeocluePlazes *self, GeoclueStatus status)
     }
 }
 
-static char *
-mac_strdown (char *mac)
-{
-	guint i;
-	for (i = 0; mac[i] != '\0' ; i++) {
-		if (g_ascii_isalpha (mac[i]))
-			mac[i] = g_ascii_tolower (mac[i]);
-	}
-	return mac;
-}
-/* Position interface implementation */
+typedef struct _GeocluePlazesQuery {
+	GeocluePlazes *plazes;
+	DBusGMethodInvocation *context;
+} GeocluePlazesQuery;
 
-static gboolean 
-geoclue_plazes_get_position (GcIfacePosition        *iface,
-                             GeocluePositionFields  *fields,
-                             int                    *timestamp,
-                             double                 *latitude,
-                             double                 *longitude,
-                             double                 *altitude,
-                             GeoclueAccuracy       **accuracy,
-                             GError                **error)
+/* Start an asynchronous query for the current router mac. On failure
+ * the D-Bus call is completed with an error and FALSE is returned */
+static gboolean
+geoclue_plazes_query_async (GeocluePlazes         *plazes,
+                            DBusGMethodInvocation *context,
+                            GAsyncReadyCallback    callback)
 {
-	GeocluePlazes *plazes;
+	GeocluePlazesQuery *query;
 	char *mac, *mac_lc;
+	GError *error = NULL;
 	
-	plazes = (GEOCLUE_PLAZES (iface));
-	
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-	if (timestamp) {
-		*timestamp = time (NULL);
-	}
-
 	mac = geoclue_connectivity_get_router_mac (plazes->conn);
 	if (mac == NULL) {
-		g_set_error (error, GEOCLUE_ERROR, 
+		g_set_error (&error, GEOCLUE_ERROR, 
 		             GEOCLUE_ERROR_NOT_AVAILABLE, 
 		             "Router mac address query failed");
 		geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_ERROR);
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
 		return FALSE;
 	}
-
-	mac = mac_strdown (mac);
-
+	
 	geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_ACQUIRING);
-
+	
 	mac_lc = g_ascii_strdown (mac, -1);
 	g_free (mac);
-	if (!gc_web_service_query (plazes->web_service, error,
-	                           PLAZES_KEY_MAC, mac,
-	                           (char *)0)) {
-		g_free (mac_lc);
-        // did not get a reply; we can try again later
-		geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_AVAILABLE);
-		g_set_error (error, GEOCLUE_ERROR,
-		             GEOCLUE_ERROR_NOT_AVAILABLE,
-		             "Did not get reply from server");
+	
+	query = g_new0 (GeocluePlazesQuery, 1);
+	query->plazes = g_object_ref (plazes);
+	query->context = context;
+	
+	gc_web_service_query_async (plazes->web_service, NULL,
+	                            callback, query,
+	                            PLAZES_KEY_MAC, mac_lc,
+	                            (char *)0);
+	g_free (mac_lc);
+	return TRUE;
+}
+
+/* Finish a query started with geoclue_plazes_query_async(). On failure
+ * the D-Bus call is completed with an error and FALSE is returned */
+static gboolean
+geoclue_plazes_query_finish (GeocluePlazesQuery *query,
+                             GAsyncResult       *result)
+{
+	GError *error = NULL;
+	
+	if (!gc_web_service_query_finish (query->plazes->web_service, 
+	                                  result, &error)) {
+		g_error_free (error);
+		/* did not get a reply; we can try again later */
+		geoclue_plazes_set_status (query->plazes, GEOCLUE_STATUS_AVAILABLE);
+		error = g_error_new (GEOCLUE_ERROR,
+		                     GEOCLUE_ERROR_NOT_AVAILABLE,
+		                     "Did not get reply from server");
+		dbus_g_method_return_error (query->context, error);
+		g_error_free (error);
 		return FALSE;
 	}
+	return TRUE;
+}
 
-	g_free (mac);
+static void
+geoclue_plazes_query_free (GeocluePlazesQuery *query)
+{
+	g_object_unref (query->plazes);
+	g_free (query);
+}
+
+/* Reply with "Could not understand reply from server". It would 
+ * probably be the same next time, so status is set to error */
+static void
+geoclue_plazes_return_parse_error (GeocluePlazesQuery *query)
+{
+	GError *error;
+	
+	geoclue_plazes_set_status (query->plazes, GEOCLUE_STATUS_ERROR);
+	error = g_error_new (GEOCLUE_ERROR, 
+	                     GEOCLUE_ERROR_NOT_AVAILABLE, 
+	                     "Could not understand reply from server");
+	dbus_g_method_return_error (query->context, error);
+	g_error_free (error);
+}
+
+/* Position interface implementation */
 
-	if (latitude && gc_web_service_get_double (plazes->web_service, 
-	                                           latitude, PLAZES_LAT_XPATH)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+static void
+geoclue_plazes_position_query_done (GObject      *source,
+                                    GAsyncResult *result,
+                                    gpointer      userdata)
+{
+	GeocluePlazesQuery *query = userdata;
+	GcWebService *web_service = query->plazes->web_service;
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double latitude = 0.0, longitude = 0.0;
+	GeoclueAccuracy *accuracy;
+	
+	if (!geoclue_plazes_query_finish (query, result)) {
+		geoclue_plazes_query_free (query);
+		return;
 	}
-	if (longitude && gc_web_service_get_double (plazes->web_service, 
-	                                            longitude, PLAZES_LON_XPATH)) {
-		*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
+	
+	if (gc_web_service_get_double (web_service, 
+	                               &latitude, PLAZES_LAT_XPATH)) {
+		fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
+	}
+	if (gc_web_service_get_double (web_service, 
+	                               &longitude, PLAZES_LON_XPATH)) {
+		fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
 	}
 	
-	if (accuracy) {
-        /* Educated guess. Plazes are typically hand pointed on 
-         * a map, or geocoded from address, so should be fairly 
-         * accurate */
-        *accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_STREET, 0, 0);
+	if (!(fields & GEOCLUE_POSITION_FIELDS_LATITUDE &&
+	      fields & GEOCLUE_POSITION_FIELDS_LONGITUDE)) {
+		geoclue_plazes_return_parse_error (query);
+		geoclue_plazes_query_free (query);
+		return;
 	}
 	
-    if (!(*fields & GEOCLUE_POSITION_FIELDS_LATITUDE &&
-         *fields & GEOCLUE_POSITION_FIELDS_LONGITUDE)) {
-
-        // we got a reply, but could not exploit it. It would probably be the
-        // same next time.
-		geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_ERROR);
-		g_set_error (error, GEOCLUE_ERROR, 
-		             GEOCLUE_ERROR_NOT_AVAILABLE, 
-		             "Could not understand reply from server");
-		return FALSE;
-    }
+	geoclue_plazes_set_status (query->plazes, GEOCLUE_STATUS_AVAILABLE);
+	
+	/* Educated guess. Plazes are typically hand pointed on 
+	 * a map, or geocoded from address, so should be fairly 
+	 * accurate */
+	accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_STREET, 0, 0);
 	
-	geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_AVAILABLE);
+	dbus_g_method_return (query->context, fields, (int)time (NULL),
+	                      latitude, longitude, 0.0, accuracy);
+	geoclue_accuracy_free (accuracy);
+	geoclue_plazes_query_free (query);
+}
 
-	return TRUE;
+static void
+geoclue_plazes_get_position_async (GcIfacePosition       *iface,
+                                   DBusGMethodInvocation *context)
+{
+	geoclue_plazes_query_async (GEOCLUE_PLAZES (iface), context,
+	                            geoclue_plazes_position_query_done);
 }
 
 /* Address interface implementation */
 
-static gboolean 
-geoclue_plazes_get_address (GcIfaceAddress   *iface,
-                            int              *timestamp,
-                            GHashTable      **address,
-                            GeoclueAccuracy **accuracy,
-                            GError          **error)
+static void
+geoclue_plazes_address_query_done (GObject      *source,
+                                   GAsyncResult *result,
+                                   gpointer      userdata)
 {
-	
-	GeocluePlazes *plazes = GEOCLUE_PLAZES (iface);
-	char *mac, *mac_lc;
-
+	GeocluePlazesQuery *query = userdata;
+	GcWebService *web_service = query->plazes->web_service;
 	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
+	GHashTable *address;
+	GeoclueAccuracy *accuracy;
+	char *str;
 	
-	if (timestamp) {
-		*timestamp = time (NULL);
-	}
-
-	mac = geoclue_connectivity_get_router_mac (plazes->conn);
-
-	if (mac == NULL) {
-		g_set_error (error, GEOCLUE_ERROR, 
-		             GEOCLUE_ERROR_NOT_AVAILABLE, 
-		             "Router mac address query failed");
-		geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_ERROR);
-		return FALSE;
+	if (!geoclue_plazes_query_finish (query, result)) {
+		geoclue_plazes_query_free (query);
+		return;
 	}
 	
-    geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_ACQUIRING);
-
-	mac_lc = g_ascii_strdown (mac, -1);
-	g_free (mac);
-	if (!gc_web_service_query (plazes->web_service, error,
-	                           PLAZES_KEY_MAC, mac_lc, 
-	                           (char *)0)) {
-		g_free (mac_lc);
-		geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_AVAILABLE);
-		g_set_error (error, GEOCLUE_ERROR, 
-		             GEOCLUE_ERROR_NOT_AVAILABLE, 
-		             "Did not get reply from server");
-		return FALSE;
+	address = geoclue_address_details_new ();
+	
+	if (gc_web_service_get_string (web_service, 
+	                               &str, "//plaze/country")) {
+		geoclue_address_details_insert (address,
+		                                GEOCLUE_ADDRESS_KEY_COUNTRY,
+		                                str);
+		g_free (str);
+		level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
 	}
-	g_free (mac_lc);
-
-	if (address) {
-		char *str;
-		
-		*address = geoclue_address_details_new ();
-		
-		if (gc_web_service_get_string (plazes->web_service, 
-		                               &str, "//plaze/country")) {
-			geoclue_address_details_insert (*address,
-			                                GEOCLUE_ADDRESS_KEY_COUNTRY,
-			                                str);
-			g_free (str);
-			level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
-		}
-		if (gc_web_service_get_string (plazes->web_service, 
-		                               &str, "//plaze/country_code")) {
-			geoclue_address_details_insert (*address,
-			                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
-			                                str);
-			g_free (str);
-			level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
-		}
-		if (gc_web_service_get_string (plazes->web_service, 
-		                               &str, "//plaze/city")) {
-			geoclue_address_details_insert (*address,
-			                                GEOCLUE_ADDRESS_KEY_LOCALITY,
-			                                str);
-			g_free (str);
-			level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
-		}
-		if (gc_web_service_get_string (plazes->web_service, 
-		                               &str, "//plaze/zip_code")) {
-			geoclue_address_details_insert (*address,
-			                                GEOCLUE_ADDRESS_KEY_POSTALCODE,
-			                                str);
-			g_free (str);
-			level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
-		}
-		if (gc_web_service_get_string (plazes->web_service, 
-		                               &str, "//plaze/address")) {
-			geoclue_address_details_insert (*address,
-			                                GEOCLUE_ADDRESS_KEY_STREET,
-			                                str);
-			g_free (str);
-			level = GEOCLUE_ACCURACY_LEVEL_STREET;
-		}
+	if (gc_web_service_get_string (web_service, 
+	                               &str, "//plaze/country_code")) {
+		geoclue_address_details_insert (address,
+		                                GEOCLUE_ADDRESS_KEY_COUNTRYCODE,
+		                                str);
+		g_free (str);
+		level = GEOCLUE_ACCURACY_LEVEL_COUNTRY;
 	}
-
-    if (level == GEOCLUE_ACCURACY_LEVEL_NONE) {
-        // we got a reply, but could not exploit it. It would probably be the
-        // same next time.
-		geoclue_plazes_set_status (plazes, GEOCLUE_STATUS_ERROR);
-		g_set_error (error, GEOCLUE_ERROR, 
-		             GEOCLUE_ERROR_NOT_AVAILABLE, 
-		             "Could not understand reply from server");
-		return FALSE;
-    }
-
-	if (accuracy) {
-		*accuracy = geoclue_accuracy_new (level, 0, 0);
+	if (gc_web_service_get_string (web_service, 
+	                               &str, "//plaze/city")) {
+		geoclue_address_details_insert (address,
+		                                GEOCLUE_ADDRESS_KEY_LOCALITY,
+		                                str);
+		g_free (str);
+		level = GEOCLUE_ACCURACY_LEVEL_LOCALITY;
+	}
+	if (gc_web_service_get_string (web_service, 
+	                               &str, "//plaze/zip_code")) {
+		geoclue_address_details_insert (address,
+		                                GEOCLUE_ADDRESS_KEY_POSTALCODE,
+		                                str);
+		g_free (str);
+		level = GEOCLUE_ACCURACY_LEVEL_POSTALCODE;
+	}
+	if (gc_web_service_get_string (web_service, 
+	                               &str, "//plaze/address")) {
+		geoclue_address_details_insert (address,
+		                                GEOCLUE_ADDRESS_KEY_STREET,
+		                                str);
+		g_free (str);
+		level = GEOCLUE_ACCURACY_LEVEL_STREET;
 	}
 	
-	return TRUE;
+	if (level == GEOCLUE_ACCURACY_LEVEL_NONE) {
+		geoclue_plazes_return_parse_error (query);
+		g_hash_table_destroy (address);
+		geoclue_plazes_query_free (query);
+		return;
+	}
+	
+	accuracy = geoclue_accuracy_new (level, 0, 0);
+	dbus_g_method_return (query->context, (int)time (NULL),
+	                      address, accuracy);
+	g_hash_table_destroy (address);
+	geoclue_accuracy_free (accuracy);
+	geoclue_plazes_query_free (query);
+}
+
+static void
+geoclue_plazes_get_address_async (GcIfaceAddress        *iface,
+                                  DBusGMethodInvocation *context)
+{
+	geoclue_plazes_query_async (GEOCLUE_PLAZES (iface), context,
+	                            geoclue_plazes_address_query_done);
 }
 
 static void
@@ -351,13 +377,13 @@ geoclue_plazes_init (GeocluePlazes *plazes)
 static void
 geoclue_plazes_position_init (GcIfacePositionClass  *iface)
 {
-	iface->get_position = geoclue_plazes_get_position;
+	iface->get_position_async = geoclue_plazes_get_position_async;
 }
 
 static void
 geoclue_plazes_address_init (GcIfaceAddressClass  *iface)
 {
-	iface->get_address = geoclue_plazes_get_address;
+	iface->get_address_async = geoclue_plazes_get_address_async;
 }
 
 int 
@@ -35,6 +35,7 @@
 
 #define YAHOO_GEOCLUE_APP_ID "zznSbDjV34HRU5CXQc4D3qE1DzCsJTaKvWTLhNJxbvI_JTp1hIncJ4xTSJFRgjE-"
 #define YAHOO_BASE_URL "http://api.local.yahoo.com/MapsService/V1/geocode"
+#define DISK_CACHE_TTL (7 * 24 * 60 * 60)
 #define GEOCLUE_TYPE_YAHOO (geoclue_yahoo_get_type ())
 #define GEOCLUE_YAHOO(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GEOCLUE_TYPE_YAHOO, GeoclueYahoo))
 
@@ -94,12 +95,12 @@ get_address_value (GHashTable *address, char *key)
 }
 
 static GeoclueAccuracyLevel
-get_query_accuracy_level (GeoclueYahoo *yahoo)
+get_query_accuracy_level (GcWebService *web_service)
 {
 	char *precision = NULL;
 	GeoclueAccuracyLevel level = GEOCLUE_ACCURACY_LEVEL_NONE;
 
-	gc_web_service_get_string (yahoo->web_service,
+	gc_web_service_get_string (web_service,
 							   &precision, "//yahoo:Result/attribute::precision");
 	if (precision) {
 		if ((strcmp (precision, "street") == 0) ||
@@ -122,22 +123,73 @@ get_query_accuracy_level (GeoclueYahoo *yahoo)
 }
 
 /* Geocode interface implementation */
-static gboolean
-geoclue_yahoo_address_to_position (GcIfaceGeocode        *iface,
-                                   GHashTable            *address,
-                                   GeocluePositionFields *fields,
-                                   double                *latitude,
-                                   double                *longitude,
-                                   double                *altitude,
-                                   GeoclueAccuracy      **accuracy,
-                                   GError               **error)
+
+/* A single query is answered through context, a query that is part
+ * of an AddressesToPositions call through batch */
+typedef struct _GeocodeQuery {
+	GeoclueYahoo *yahoo;  /* held while the web query runs */
+	DBusGMethodInvocation *context;
+	GcIfaceGeocodeBatch *batch;
+	guint index;
+} GeocodeQuery;
+
+/* GAsyncReadyCallback for all geocode queries */
+static void
+geocode_query_done (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      userdata)
 {
-	GeoclueYahoo *yahoo;
-	char *street, *postalcode, *locality, *region;
+	GcWebService *web_service = GC_WEB_SERVICE (source);
+	GeocodeQuery *query = userdata;
+	GeoclueYahoo *yahoo = query->yahoo;
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double latitude = 0.0, longitude = 0.0;
+	GeoclueAccuracy *accuracy;
+	GError *error = NULL;
 	
-	yahoo = GEOCLUE_YAHOO (iface);
+	if (!gc_web_service_query_finish (web_service, result, &error)) {
+		if (query->batch) {
+			gc_iface_geocode_batch_return (query->batch, query->index,
+			                               fields, 0.0, 0.0, 0.0, NULL);
+		} else {
+			dbus_g_method_return_error (query->context, error);
+		}
+		g_error_free (error);
+		g_free (query);
+		g_object_unref (yahoo);
+		return;
+	}
+	
+	if (gc_web_service_get_double (web_service,
+	                               &latitude, "//yahoo:Latitude")) {
+		fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
+	}
+	if (gc_web_service_get_double (web_service,
+	                               &longitude, "//yahoo:Longitude")) {
+		fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
+	}
+	
+	accuracy = geoclue_accuracy_new (get_query_accuracy_level (web_service),
+	                                 0, 0);
 	
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
+	if (query->batch) {
+		gc_iface_geocode_batch_return (query->batch, query->index, fields,
+		                               latitude, longitude, 0.0, accuracy);
+	} else {
+		dbus_g_method_return (query->context, fields,
+		                      latitude, longitude, 0.0, accuracy);
+	}
+	geoclue_accuracy_free (accuracy);
+	g_free (query);
+	g_object_unref (yahoo);
+}
+
+static void
+geocode_address (GeoclueYahoo *yahoo,
+                 GHashTable   *address,
+                 GeocodeQuery *query)
+{
+	char *street, *postalcode, *locality, *region;
 	
 	/* weird: the results are all over the globe, but country is not an input parameter... */
 	street = get_address_value (address, GEOCLUE_ADDRESS_KEY_STREET);
@@ -145,84 +197,66 @@ geoclue_yahoo_address_to_position (GcIfaceGeocode        *iface,
 	locality = get_address_value (address, GEOCLUE_ADDRESS_KEY_LOCALITY);
 	region = get_address_value (address, GEOCLUE_ADDRESS_KEY_REGION);
 	
-	if (!gc_web_service_query (yahoo->web_service, error,
-	                           "appid", YAHOO_GEOCLUE_APP_ID,
-	                           "street", street,
-	                           "zip", postalcode,
-	                           "city", locality,
-	                           "state", region,
-	                           (char *)0)) {
-		return FALSE;
-	}
-	
-	if (latitude) {
-		if (gc_web_service_get_double (yahoo->web_service,
-		                               latitude, "//yahoo:Latitude")) {
-			*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE; 
-		}
-	}
-	if (longitude) {
-		if (gc_web_service_get_double (yahoo->web_service,
-		                               longitude, "//yahoo:Longitude")) {
-			*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE; 
-		}
-	}
-	
-	if (accuracy) {
-		*accuracy = geoclue_accuracy_new (get_query_accuracy_level (yahoo),
-		                                  0, 0);
-	}
+	query->yahoo = g_object_ref (yahoo);
+	gc_web_service_query_async (yahoo->web_service, NULL,
+	                            geocode_query_done, query,
+	                            "appid", YAHOO_GEOCLUE_APP_ID,
+	                            "street", street,
+	                            "zip", postalcode,
+	                            "city", locality,
+	                            "state", region,
+	                            (char *)0);
 	
 	g_free (street);
 	g_free (postalcode);
 	g_free (locality);
 	g_free (region);
+}
+
+static void
+geoclue_yahoo_address_to_position_async (GcIfaceGeocode        *iface,
+                                         GHashTable            *address,
+                                         DBusGMethodInvocation *context)
+{
+	GeocodeQuery *query;
 	
-	return TRUE;
+	query = g_new0 (GeocodeQuery, 1);
+	query->context = context;
+	geocode_address (GEOCLUE_YAHOO (iface), address, query);
 }
 
-static gboolean
-geoclue_yahoo_freeform_address_to_position (GcIfaceGeocode        *iface,
-                                            const char            *address,
-                                            GeocluePositionFields *fields,
-                                            double                *latitude,
-                                            double                *longitude,
-                                            double                *altitude,
-                                            GeoclueAccuracy      **accuracy,
-                                            GError               **error)
+static void
+geoclue_yahoo_batch_address_to_position (GcIfaceGeocode      *iface,
+                                         GHashTable          *address,
+                                         GcIfaceGeocodeBatch *batch,
+                                         guint                index)
+{
+	GeocodeQuery *query;
+	
+	query = g_new0 (GeocodeQuery, 1);
+	query->batch = batch;
+	query->index = index;
+	geocode_address (GEOCLUE_YAHOO (iface), address, query);
+}
+
+static void
+geoclue_yahoo_freeform_address_to_position_async (GcIfaceGeocode        *iface,
+                                                  const char            *address,
+                                                  DBusGMethodInvocation *context)
 {
 	GeoclueYahoo *yahoo;
+	GeocodeQuery *query;
 
 	yahoo = GEOCLUE_YAHOO (iface);
 
-	*fields = GEOCLUE_POSITION_FIELDS_NONE;
-
-	if (!gc_web_service_query (yahoo->web_service, error,
-	                           "appid", YAHOO_GEOCLUE_APP_ID,
-	                           "location", address,
-	                           (char *)0)) {
-		return FALSE;
-	}
-
-	if (latitude) {
-		if (gc_web_service_get_double (yahoo->web_service,
-		                               latitude, "//yahoo:Latitude")) {
-			*fields |= GEOCLUE_POSITION_FIELDS_LATITUDE;
-		}
-	}
-	if (longitude) {
-		if (gc_web_service_get_double (yahoo->web_service,
-		                               longitude, "//yahoo:Longitude")) {
-			*fields |= GEOCLUE_POSITION_FIELDS_LONGITUDE;
-		}
-	}
-
-	if (accuracy) {
-		*accuracy = geoclue_accuracy_new (get_query_accuracy_level (yahoo),
-		                                  0, 0);
-	}
-
-	return TRUE;
+	query = g_new0 (GeocodeQuery, 1);
+	query->context = context;
+	query->yahoo = g_object_ref (yahoo);
+	gc_web_service_query_async (yahoo->web_service, NULL,
+	                            geocode_query_done, query,
+	                            "appid", YAHOO_GEOCLUE_APP_ID,
+	                            "location", address,
+	                            (char *)0);
 }
 
 static void
@@ -263,15 +297,19 @@ geoclue_yahoo_init (GeoclueYahoo *yahoo)
 	yahoo->web_service = g_object_new (GC_TYPE_WEB_SERVICE, NULL);
 	gc_web_service_set_base_url (yahoo->web_service, YAHOO_BASE_URL);
 	gc_web_service_add_namespace (yahoo->web_service, "yahoo", "urn:yahoo:maps");
+	gc_web_service_set_disk_cache (yahoo->web_service, "yahoo", DISK_CACHE_TTL);
 }
 
 
 static void
 geoclue_yahoo_geocode_init (GcIfaceGeocodeClass *iface)
 {
-	iface->address_to_position = geoclue_yahoo_address_to_position;
-	iface->freeform_address_to_position =
-			geoclue_yahoo_freeform_address_to_position;
+	iface->address_to_position_async = 
+			geoclue_yahoo_address_to_position_async;
+	iface->freeform_address_to_position_async =
+			geoclue_yahoo_freeform_address_to_position_async;
+	iface->batch_address_to_position =
+			geoclue_yahoo_batch_address_to_position;
 }
 
 int 
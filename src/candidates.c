@@ -0,0 +1,603 @@
+/*
+ * Geoclue
+ * candidates.c - Provider selection shared by master clients
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * GcCandidates is the requirement group for one interface: it keeps
+ * the providers that are good enough for one set of client requirements
+ * sorted by gc_master_provider_compare() and chooses the provider to
+ * use. GcMaster hands out one instance per distinct set of requirements,
+ * so sorting, subscribing and choosing is done once for all clients that
+ * share the requirements: they only follow "selection-changed".
+ *
+ * When a provider's accuracy changes only that provider is moved to
+ * its new place in the list instead of sorting the whole list again.
+ *
+ * In fusion mode (the "fuse-positions" setting) a position group keeps
+ * all its providers running and combines their positions in a
+ * GcPositionFilter. Clients then follow "position-changed" of the group
+ * instead of the chosen provider: the position does not jump when the
+ * choice changes, and coarse providers answer while the GPS is still
+ * acquiring. The chosen provider is still reported to clients.
+ **/
+
+#include <config.h>
+
+#include <geoclue/geoclue-marshal.h>
+
+#include "candidates.h"
+
+enum {
+	SELECTION_CHANGED,
+	POSITION_CHANGED,
+	LAST_SIGNAL
+};
+static guint32 signals[LAST_SIGNAL] = {0, };
+
+typedef struct _GcFusedPosition {
+	GeocluePositionFields fields;
+	int timestamp;
+	double latitude;
+	double longitude;
+	double altitude;
+	double horizontal;
+	double vertical;
+} GcFusedPosition;
+
+G_DEFINE_TYPE (GcCandidates, gc_candidates, G_TYPE_OBJECT)
+
+static void gc_candidates_select (GcCandidates *candidates);
+
+static gint
+compare_providers (gconstpointer a,
+                   gconstpointer b,
+                   gpointer      user_data)
+{
+	GcCandidates *candidates = user_data;
+	GcInterfaceAccuracy accuracy_data;
+
+	accuracy_data.interface = candidates->iface;
+	accuracy_data.accuracy_level = candidates->min_accuracy;
+
+	return gc_master_provider_compare ((GcMasterProvider *)a,
+	                                   (GcMasterProvider *)b,
+	                                   &accuracy_data);
+}
+
+static void
+subscribe_providers (GcCandidates *candidates,
+                     GList        *provider_list)
+{
+	while (provider_list) {
+		gc_master_provider_subscribe (provider_list->data,
+		                              candidates,
+		                              candidates->iface);
+		provider_list = provider_list->next;
+	}
+}
+
+static void
+unsubscribe_providers (GcCandidates *candidates,
+                       GList        *provider_list)
+{
+	while (provider_list) {
+		gc_master_provider_unsubscribe (provider_list->data,
+		                                candidates,
+		                                candidates->iface);
+		provider_list = provider_list->next;
+	}
+}
+
+/* get_best_provider will return the best provider with status == GEOCLUE_STATUS_AVAILABLE.
+ * It will also "subscribe" to that provider and all better ones, and unsubscribe from worse
+ * (in fusion mode worse ones are subscribed too).
+ *
+ * The list is walked exactly once. Providers start asynchronously, so all
+ * providers better than the chosen one are starting in parallel and stay
+ * subscribed: if they turn out to be better than the chosen one (through
+ * status-changed or accuracy-changed) a new selection is queued instead
+ * of restarting this one. */
+static GcMasterProvider *
+gc_candidates_get_best_provider (GcCandidates *candidates)
+{
+	GList *providers, *l;
+	GcMasterProvider *best = NULL;
+	/* TODO: should maybe choose a acquiring provider if better ones are are not available */
+
+	g_debug ("candidates: choosing best provider");
+
+	/* starting a provider may re-sort the list (accuracy-changed),
+	 * so walk a copy of the current order */
+	providers = g_list_copy (candidates->providers);
+
+	for (l = providers; l; l = l->next) {
+		GcMasterProvider *provider = l->data;
+
+		g_debug ("        ...trying provider %s", gc_master_provider_get_name (provider));
+		if (gc_master_provider_subscribe (provider, candidates, candidates->iface)) {
+			g_debug ("        ...started %s (status %d)",
+			         gc_master_provider_get_name (provider),
+			         gc_master_provider_get_status (provider));
+		}
+
+		/* TODO: currently returning even providers that are worse than min_accuracy,
+		 * if nothing else is available */
+		if (gc_master_provider_get_status (provider) == GEOCLUE_STATUS_AVAILABLE) {
+			if (candidates->filter) {
+				subscribe_providers (candidates, l->next);
+			} else {
+				/* unsubscribe from all providers worse than this */
+				unsubscribe_providers (candidates, l->next);
+			}
+			best = provider;
+			break;
+		}
+	}
+
+	if (!best) {
+		/* no provider found: keep the ones that are still starting up
+		 * (or otherwise acquiring), their status-changed will tell */
+		for (l = providers; l; l = l->next) {
+			if (gc_master_provider_get_status (l->data) != GEOCLUE_STATUS_ACQUIRING) {
+				gc_master_provider_unsubscribe (l->data, candidates, candidates->iface);
+			}
+		}
+	}
+	g_list_free (providers);
+
+	return best;
+}
+
+static gboolean
+reselect (gpointer data)
+{
+	GcCandidates *candidates = data;
+
+	candidates->reselect_id = 0;
+	gc_candidates_select (candidates);
+	return FALSE;
+}
+
+/* Choose the provider to use and tell the clients if it changed. Any
+ * number of changes during one choice result in a single new choice */
+static void
+gc_candidates_select (GcCandidates *candidates)
+{
+	GcMasterProvider *best;
+
+	if (candidates->selecting) {
+		g_debug ("        ...but provider choice in progress");
+		if (candidates->reselect_id == 0) {
+			candidates->reselect_id = g_idle_add (reselect, candidates);
+		}
+		return;
+	}
+
+	candidates->selecting = TRUE;
+	best = gc_candidates_get_best_provider (candidates);
+	candidates->selecting = FALSE;
+
+	if (best == candidates->selected) {
+		return;
+	}
+	candidates->selected = best;
+
+	g_debug ("candidates: provider changed (to %s)",
+	         best ? gc_master_provider_get_name (best) : "NULL");
+	g_signal_emit (candidates, signals[SELECTION_CHANGED], 0);
+}
+
+/* Adds a position of provider to the fused position and tells the
+ * clients about the new estimate */
+static void
+gc_candidates_fuse_position (GcCandidates         *candidates,
+                             GcMasterProvider     *provider,
+                             GeocluePositionFields fields,
+                             int                   timestamp,
+                             double                latitude,
+                             double                longitude,
+                             double                altitude,
+                             GeoclueAccuracy      *accuracy)
+{
+	GcFusedPosition *last;
+	GeoclueAccuracy *fused_accuracy;
+	double horizontal = 0.0, vertical = 0.0;
+
+	if (accuracy) {
+		geoclue_accuracy_get_details (accuracy, NULL,
+		                              &horizontal, &vertical);
+	}
+
+	/* a cached position is seen again when a provider becomes
+	 * available again: it must not count twice. Fixes within the
+	 * same second share the timestamp, so compare the values too */
+	last = g_hash_table_lookup (candidates->fused_positions, provider);
+	if (last &&
+	    last->fields == fields &&
+	    last->timestamp == timestamp &&
+	    last->latitude == latitude &&
+	    last->longitude == longitude &&
+	    last->altitude == altitude &&
+	    last->horizontal == horizontal &&
+	    last->vertical == vertical) {
+		return;
+	}
+	if (!gc_position_filter_update (candidates->filter,
+	                                fields, timestamp,
+	                                latitude, longitude, altitude,
+	                                accuracy)) {
+		return;
+	}
+	if (!last) {
+		last = g_new (GcFusedPosition, 1);
+		g_hash_table_insert (candidates->fused_positions, provider, last);
+	}
+	last->fields = fields;
+	last->timestamp = timestamp;
+	last->latitude = latitude;
+	last->longitude = longitude;
+	last->altitude = altitude;
+	last->horizontal = horizontal;
+	last->vertical = vertical;
+
+	fields = gc_position_filter_get_position (candidates->filter,
+	                                          &timestamp,
+	                                          &latitude, &longitude, &altitude,
+	                                          &fused_accuracy);
+	g_signal_emit (candidates, signals[POSITION_CHANGED], 0,
+	               fields, timestamp,
+	               latitude, longitude, altitude,
+	               fused_accuracy);
+	geoclue_accuracy_free (fused_accuracy);
+}
+
+static void
+gc_candidates_fuse_current_position (GcCandidates     *candidates,
+                                     GcMasterProvider *provider)
+{
+	GeocluePositionFields fields;
+	int timestamp;
+	double latitude, longitude, altitude;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+
+	fields = gc_master_provider_get_position (provider,
+	                                          &timestamp,
+	                                          &latitude, &longitude, &altitude,
+	                                          &accuracy,
+	                                          &error);
+	if (error) {
+		g_debug ("candidates: no position from %s: %s",
+		         gc_master_provider_get_name (provider), error->message);
+		g_error_free (error);
+	} else {
+		gc_candidates_fuse_position (candidates, provider,
+		                             fields, timestamp,
+		                             latitude, longitude, altitude,
+		                             accuracy);
+	}
+	geoclue_accuracy_free (accuracy);
+}
+
+static void
+position_changed (GcMasterProvider     *provider,
+                  GeocluePositionFields fields,
+                  int                   timestamp,
+                  double                latitude,
+                  double                longitude,
+                  double                altitude,
+                  GeoclueAccuracy      *accuracy,
+                  GcCandidates         *candidates)
+{
+	if (gc_master_provider_get_status (provider) != GEOCLUE_STATUS_AVAILABLE) {
+		return;
+	}
+	gc_candidates_fuse_position (candidates, provider,
+	                             fields, timestamp,
+	                             latitude, longitude, altitude,
+	                             accuracy);
+}
+
+/*if changed_provider status changes, do we need to choose a new provider? */
+static gboolean
+status_change_requires_provider_change (GList            *provider_list,
+                                        GcMasterProvider *current_provider,
+                                        GcMasterProvider *changed_provider,
+                                        GeoclueStatus     status)
+{
+	if (!provider_list) {
+		return FALSE;
+
+	} else if (current_provider == NULL) {
+		return (status == GEOCLUE_STATUS_AVAILABLE);
+
+	} else if (current_provider == changed_provider) {
+		return (status != GEOCLUE_STATUS_AVAILABLE);
+
+	}else if (status != GEOCLUE_STATUS_AVAILABLE) {
+		return FALSE;
+
+	}
+
+	while (provider_list) {
+		GcMasterProvider *p = provider_list->data;
+		if (p == current_provider) {
+			/* not interested in worse-than-current providers */
+			return FALSE;
+		}
+		if (p == changed_provider) {
+			/* changed_provider is better than current */
+			return (status == GEOCLUE_STATUS_AVAILABLE);
+		}
+		provider_list = provider_list->next;
+	}
+	return FALSE;
+}
+
+static void
+status_changed (GcMasterProvider *provider,
+                GeoclueStatus     status,
+                GcCandidates     *candidates)
+{
+	g_debug ("candidates: provider %s status changed: %d",
+	         gc_master_provider_get_name (provider), status);
+
+	/* If we're choosing a provider already, the status may be stale
+	 * in that choice: check again afterwards */
+	if (candidates->selecting ||
+	    status_change_requires_provider_change (candidates->providers,
+	                                            candidates->selected,
+	                                            provider, status)) {
+		gc_candidates_select (candidates);
+	}
+
+	if (candidates->filter && status == GEOCLUE_STATUS_AVAILABLE) {
+		gc_candidates_fuse_current_position (candidates, provider);
+	}
+}
+
+static void
+accuracy_changed (GcMasterProvider     *provider,
+                  GcInterfaceFlags      interface,
+                  GeoclueAccuracyLevel  level,
+                  GcCandidates         *candidates)
+{
+	/* may concern several interfaces, e.g. velocity follows position */
+	if (!(interface & candidates->iface)) {
+		return;
+	}
+
+	g_debug ("candidates: %s accuracy changed (%d)",
+	         gc_master_provider_get_name (provider), level);
+
+	/* the rest of the list is still in order */
+	candidates->providers = g_list_remove (candidates->providers, provider);
+	candidates->providers = g_list_insert_sorted_with_data (candidates->providers,
+	                                                        provider,
+	                                                        compare_providers,
+	                                                        candidates);
+	gc_candidates_select (candidates);
+}
+
+static gboolean
+gc_candidates_insert (GcCandidates     *candidates,
+                      GcMasterProvider *provider)
+{
+	if (g_list_find (candidates->providers, provider) ||
+	    !gc_master_provider_is_good (provider,
+	                                 candidates->iface,
+	                                 candidates->min_accuracy,
+	                                 candidates->require_updates,
+	                                 candidates->allowed_resources)) {
+		return FALSE;
+	}
+
+	g_signal_connect (provider, "status-changed",
+	                  G_CALLBACK (status_changed), candidates);
+	g_signal_connect (provider, "accuracy-changed",
+	                  G_CALLBACK (accuracy_changed), candidates);
+	if (candidates->filter) {
+		g_signal_connect (provider, "position-changed",
+		                  G_CALLBACK (position_changed), candidates);
+	}
+	candidates->providers = g_list_insert_sorted_with_data (candidates->providers,
+	                                                        provider,
+	                                                        compare_providers,
+	                                                        candidates);
+	return TRUE;
+}
+
+static void
+dispose (GObject *object)
+{
+	GcCandidates *candidates = GC_CANDIDATES (object);
+	GList *l;
+
+	if (candidates->reselect_id) {
+		g_source_remove (candidates->reselect_id);
+		candidates->reselect_id = 0;
+	}
+
+	for (l = candidates->providers; l; l = l->next) {
+		g_signal_handlers_disconnect_matched (l->data,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0, 0, NULL, NULL,
+		                                      candidates);
+	}
+	unsubscribe_providers (candidates, candidates->providers);
+	g_list_free (candidates->providers);
+	candidates->providers = NULL;
+	candidates->selected = NULL;
+
+	if (candidates->filter) {
+		gc_position_filter_free (candidates->filter);
+		candidates->filter = NULL;
+		g_hash_table_destroy (candidates->fused_positions);
+		candidates->fused_positions = NULL;
+	}
+
+	G_OBJECT_CLASS (gc_candidates_parent_class)->dispose (object);
+}
+
+static void
+gc_candidates_class_init (GcCandidatesClass *klass)
+{
+	GObjectClass *o_class = (GObjectClass *) klass;
+
+	o_class->dispose = dispose;
+
+	signals[SELECTION_CHANGED] = g_signal_new ("selection-changed",
+	                                           G_TYPE_FROM_CLASS (klass),
+	                                           G_SIGNAL_RUN_LAST,
+	                                           G_STRUCT_OFFSET (GcCandidatesClass, selection_changed),
+	                                           NULL, NULL,
+	                                           g_cclosure_marshal_VOID__VOID,
+	                                           G_TYPE_NONE, 0);
+	signals[POSITION_CHANGED] = g_signal_new ("position-changed",
+	                                          G_TYPE_FROM_CLASS (klass),
+	                                          G_SIGNAL_RUN_FIRST |
+	                                          G_SIGNAL_NO_RECURSE,
+	                                          G_STRUCT_OFFSET (GcCandidatesClass, position_changed),
+	                                          NULL, NULL,
+	                                          geoclue_marshal_VOID__INT_INT_DOUBLE_DOUBLE_DOUBLE_BOXED,
+	                                          G_TYPE_NONE, 6,
+	                                          G_TYPE_INT, G_TYPE_INT,
+	                                          G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE,
+	                                          G_TYPE_POINTER);
+}
+
+static void
+gc_candidates_init (GcCandidates *candidates)
+{
+	candidates->providers = NULL;
+	candidates->selected = NULL;
+	candidates->selecting = FALSE;
+	candidates->reselect_id = 0;
+	candidates->filter = NULL;
+	candidates->fused_positions = NULL;
+}
+
+/* The providers meeting the requirements are started and the best one
+ * selected right away. fuse selects fusion mode for a position group */
+GcCandidates *
+gc_candidates_new (GcInterfaceFlags      iface,
+                   GeoclueAccuracyLevel  min_accuracy,
+                   gboolean              require_updates,
+                   GeoclueResourceFlags  allowed_resources,
+                   gboolean              fuse,
+                   GList                *providers)
+{
+	GcCandidates *candidates;
+
+	candidates = g_object_new (GC_TYPE_CANDIDATES, NULL);
+	candidates->iface = iface;
+	candidates->min_accuracy = min_accuracy;
+	candidates->require_updates = require_updates;
+	candidates->allowed_resources = allowed_resources;
+
+	if (iface == GC_IFACE_POSITION && fuse) {
+		candidates->filter = gc_position_filter_new ();
+		candidates->fused_positions = g_hash_table_new_full (g_direct_hash,
+		                                                     g_direct_equal,
+		                                                     NULL, g_free);
+	}
+
+	for (; providers; providers = providers->next) {
+		gc_candidates_insert (candidates, providers->data);
+	}
+	g_debug ("candidates: %d providers matching requirements found",
+	         g_list_length (candidates->providers));
+
+	gc_candidates_select (candidates);
+
+	if (candidates->filter) {
+		GList *l;
+
+		/* providers that were running already */
+		for (l = candidates->providers; l; l = l->next) {
+			if (gc_master_provider_get_status (l->data) == GEOCLUE_STATUS_AVAILABLE) {
+				gc_candidates_fuse_current_position (candidates, l->data);
+			}
+		}
+	}
+
+	return candidates;
+}
+
+/* Adds provider if it meets the requirements. Returns TRUE if it did */
+gboolean
+gc_candidates_add (GcCandidates     *candidates,
+                   GcMasterProvider *provider)
+{
+	if (!gc_candidates_insert (candidates, provider)) {
+		return FALSE;
+	}
+	gc_candidates_select (candidates);
+
+	if (candidates->filter &&
+	    gc_master_provider_get_status (provider) == GEOCLUE_STATUS_AVAILABLE) {
+		gc_candidates_fuse_current_position (candidates, provider);
+	}
+	return TRUE;
+}
+
+/* Returns TRUE if provider was in the list */
+gboolean
+gc_candidates_remove (GcCandidates     *candidates,
+                      GcMasterProvider *provider)
+{
+	GList *link;
+
+	link = g_list_find (candidates->providers, provider);
+	if (!link) {
+		return FALSE;
+	}
+
+	g_signal_handlers_disconnect_matched (provider,
+	                                      G_SIGNAL_MATCH_DATA,
+	                                      0, 0, NULL, NULL,
+	                                      candidates);
+	gc_master_provider_unsubscribe (provider, candidates, candidates->iface);
+	candidates->providers = g_list_delete_link (candidates->providers, link);
+	if (candidates->fused_positions) {
+		g_hash_table_remove (candidates->fused_positions, provider);
+	}
+
+	/* if it was selected, the new choice is always a change */
+	gc_candidates_select (candidates);
+	return TRUE;
+}
+
+/* The fused position in fusion mode, see gc_master_provider_get_position() */
+GeocluePositionFields
+gc_candidates_get_position (GcCandidates     *candidates,
+                            int              *timestamp,
+                            double           *latitude,
+                            double           *longitude,
+                            double           *altitude,
+                            GeoclueAccuracy **accuracy)
+{
+	g_assert (candidates->filter);
+
+	return gc_position_filter_get_position (candidates->filter,
+	                                        timestamp,
+	                                        latitude, longitude, altitude,
+	                                        accuracy);
+}
@@ -0,0 +1,96 @@
+/*
+ * Geoclue
+ * candidates.h - Sorted provider lists shared by master clients
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _CANDIDATES_H_
+#define _CANDIDATES_H_
+
+#include <glib-object.h>
+#include <geoclue/geoclue-types.h>
+
+#include "master-provider.h"
+#include "position-filter.h"
+
+G_BEGIN_DECLS
+
+#define GC_TYPE_CANDIDATES (gc_candidates_get_type ())
+#define GC_CANDIDATES(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GC_TYPE_CANDIDATES, GcCandidates))
+
+/* The providers that meet one set of requirements for one interface,
+ * best first, and the one currently chosen for those requirements.
+ * Read-only for users, "selection-changed" is emitted when the
+ * chosen provider changes */
+typedef struct {
+	GObject parent;
+
+	GcInterfaceFlags iface;
+	GeoclueAccuracyLevel min_accuracy;
+	gboolean require_updates;
+	GeoclueResourceFlags allowed_resources;
+
+	GList *providers;
+	GcMasterProvider *selected;
+
+	gboolean selecting;
+	guint reselect_id;
+
+	/* position groups in fusion mode: all providers are used and
+	 * "position-changed" carries the filtered position */
+	GcPositionFilter *filter;
+	GHashTable *fused_positions; /* last position used, per provider */
+} GcCandidates;
+
+typedef struct {
+	GObjectClass parent_class;
+
+	void (* selection_changed) (GcCandidates *candidates);
+	void (* position_changed) (GcCandidates         *candidates,
+	                           GeocluePositionFields fields,
+	                           int                   timestamp,
+	                           double                latitude,
+	                           double                longitude,
+	                           double                altitude,
+	                           GeoclueAccuracy      *accuracy);
+} GcCandidatesClass;
+
+GType gc_candidates_get_type (void);
+
+GcCandidates *gc_candidates_new (GcInterfaceFlags      iface,
+                                 GeoclueAccuracyLevel  min_accuracy,
+                                 gboolean              require_updates,
+                                 GeoclueResourceFlags  allowed_resources,
+                                 gboolean              fuse,
+                                 GList                *providers);
+
+gboolean gc_candidates_add (GcCandidates     *candidates,
+                            GcMasterProvider *provider);
+gboolean gc_candidates_remove (GcCandidates     *candidates,
+                               GcMasterProvider *provider);
+
+GeocluePositionFields gc_candidates_get_position (GcCandidates     *candidates,
+                                                  int              *timestamp,
+                                                  double           *latitude,
+                                                  double           *longitude,
+                                                  double           *altitude,
+                                                  GeoclueAccuracy **accuracy);
+
+G_END_DECLS
+
+#endif
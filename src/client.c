@@ -34,12 +34,17 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include <geoclue/geoclue-error.h>
 #include <geoclue/geoclue-marshal.h>
+#include <geoclue/geoclue-address-details.h>
 
 #include <geoclue/gc-provider.h>
 #include <geoclue/gc-iface-position.h>
 #include <geoclue/gc-iface-address.h>
+#include <geoclue/gc-iface-velocity.h>
+#include <geoclue/gc-iface-fix.h>
 
 #include "client.h"
 
@@ -49,6 +54,8 @@
 enum {
 	ADDRESS_PROVIDER_CHANGED,
 	POSITION_PROVIDER_CHANGED,
+	VELOCITY_PROVIDER_CHANGED,
+	RELEASED,
 	LAST_SIGNAL
 };
 static guint32 signals[LAST_SIGNAL] = {0, };
@@ -57,12 +64,44 @@ static guint32 signals[LAST_SIGNAL] = {0, };
 enum {
 	POSITION_CHANGED, /* signal id of current provider */
 	ADDRESS_CHANGED, /* signal id of current provider */
+	VELOCITY_CHANGED, /* signal id of current provider */
+	FIX_CHANGED, /* signal id of fix_provider */
 	LAST_PRIVATE_SIGNAL
 };
 
+/* Latest values received during a min_time throttle period */
+typedef struct _GcPendingPosition {
+	GeocluePositionFields fields;
+	int timestamp;
+	double latitude;
+	double longitude;
+	double altitude;
+	GeoclueAccuracy *accuracy;
+} GcPendingPosition;
+
+typedef struct _GcPendingVelocity {
+	GeoclueVelocityFields fields;
+	int timestamp;
+	double speed;
+	double direction;
+	double climb;
+} GcPendingVelocity;
+
+typedef struct _GcPendingAddress {
+	int timestamp;
+	GeoclueAddressDetails *details;
+	GeoclueAccuracy *accuracy;
+} GcPendingAddress;
+
 typedef struct _GcMasterClientPrivate {
 	guint32 signals[LAST_PRIVATE_SIGNAL];
 
+	/* unique name of the peer that called Create, NULL once it is gone */
+	char *owner;
+	/* unique name -> AddReference count */
+	GHashTable *connections;
+	gboolean released;
+
 	GeoclueAccuracyLevel min_accuracy;
 	int min_time;
 	gboolean require_updates;
@@ -70,15 +109,30 @@ typedef struct _GcMasterClientPrivate {
 
 	gboolean position_started;
 	GcMasterProvider *position_provider;
-	GList *position_providers;
-	gboolean position_provider_choice_in_progress;
-	time_t last_position_changed;
+	GcCandidates *position_candidates;
+	gint64 last_position_changed;
+	guint position_throttle_id;
+	GcPendingPosition *pending_position;
 
 	gboolean address_started;
 	GcMasterProvider *address_provider;
-	GList *address_providers;
-	gboolean address_provider_choice_in_progress;
-	time_t last_address_changed;
+	GcCandidates *address_candidates;
+	gint64 last_address_changed;
+	guint address_throttle_id;
+	GcPendingAddress *pending_address;
+
+	gboolean velocity_started;
+	GcMasterProvider *velocity_provider;
+	GcCandidates *velocity_candidates;
+	gint64 last_velocity_changed;
+	guint velocity_throttle_id;
+	GcPendingVelocity *pending_velocity;
+
+	/* position_provider if it is also the velocity_provider: 
+	 * its fixes are sent as PositionAndVelocityChanged */
+	GcMasterProvider *fix_provider;
+	gint64 last_fix_changed;
+	guint fix_throttle_id;
 
 } GcMasterClientPrivate;
 
@@ -94,6 +148,7 @@ static gboolean gc_iface_master_client_set_requirements (GcMasterClient       *c
                                                          GError              **error);
 static gboolean gc_iface_master_client_position_start (GcMasterClient *client, GError **error);
 static gboolean gc_iface_master_client_address_start (GcMasterClient *client, GError **error);
+static gboolean gc_iface_master_client_velocity_start (GcMasterClient *client, GError **error);
 static gboolean gc_iface_master_client_get_address_provider (GcMasterClient  *client,
                                                              char           **name,
                                                              char           **description,
@@ -106,10 +161,17 @@ static gboolean gc_iface_master_client_get_position_provider (GcMasterClient  *c
                                                               char           **service,
                                                               char           **path,
                                                               GError         **error);
+static gboolean gc_iface_master_client_get_velocity_provider (GcMasterClient  *client,
+                                                              char           **name,
+                                                              char           **description,
+                                                              char           **service,
+                                                              char           **path,
+                                                              GError         **error);
 
 static void gc_master_client_geoclue_init (GcIfaceGeoclueClass *iface);
 static void gc_master_client_position_init (GcIfacePositionClass *iface);
 static void gc_master_client_address_init (GcIfaceAddressClass *iface);
+static void gc_master_client_velocity_init (GcIfaceVelocityClass *iface);
 
 G_DEFINE_TYPE_WITH_CODE (GcMasterClient, gc_master_client, G_TYPE_OBJECT,
 			 G_IMPLEMENT_INTERFACE(GC_TYPE_IFACE_GEOCLUE,
@@ -117,275 +179,475 @@ G_DEFINE_TYPE_WITH_CODE (GcMasterClient, gc_master_client, G_TYPE_OBJECT,
 			 G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_POSITION,
 						gc_master_client_position_init)
 			 G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_ADDRESS,
-						gc_master_client_address_init))
+						gc_master_client_address_init)
+			 G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_VELOCITY,
+						gc_master_client_velocity_init)
+			 G_IMPLEMENT_INTERFACE (GC_TYPE_IFACE_FIX, NULL))
 
 #include "gc-iface-master-client-glue.h"
 
 
-static gboolean status_change_requires_provider_change (GList            *provider_list,
-                                                        GcMasterProvider *current_provider,
-                                                        GcMasterProvider *changed_provider,
-                                                        GeoclueStatus     status);
 static void gc_master_client_emit_position_changed (GcMasterClient *client);
 static void gc_master_client_emit_address_changed (GcMasterClient *client);
-static gboolean gc_master_client_choose_position_provider (GcMasterClient  *client, 
-                                                           GList           *providers);
-static gboolean gc_master_client_choose_address_provider (GcMasterClient  *client, 
-                                                          GList           *providers);
+static void gc_master_client_emit_velocity_changed (GcMasterClient *client);
+static gboolean gc_master_client_follow_position_provider (GcMasterClient *client);
+static gboolean gc_master_client_follow_address_provider (GcMasterClient *client);
+static gboolean gc_master_client_follow_velocity_provider (GcMasterClient *client);
 
 
-static void
-status_changed (GcMasterProvider *provider,
-                GeoclueStatus     status,
-                GcMasterClient   *client)
+/* positions come from the requirement group instead of a provider */
+static gboolean
+gc_master_client_fuses_position (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	
-	g_debug ("client: provider %s status changed: %d", gc_master_provider_get_name (provider), status);
-	
-	/* change providers if needed (and if we're not choosing provider already) */
-	
-	if (!priv->position_provider_choice_in_progress &&
-	    status_change_requires_provider_change (priv->position_providers,
-	                                            priv->position_provider,
-	                                            provider, status) &&
-	    gc_master_client_choose_position_provider (client, 
-	                                               priv->position_providers)) {
-		
+
+	return (priv->position_candidates && priv->position_candidates->filter);
+}
+
+/* the requirement group chose a new provider */
+static void
+position_selection_changed (GcCandidates   *candidates,
+                            GcMasterClient *client)
+{
+	if (gc_master_client_follow_position_provider (client)) {
 		/* we have a new position provider, force-emit position_changed */
 		gc_master_client_emit_position_changed (client);
 	}
-	
-	if (!priv->address_provider_choice_in_progress &&
-	    status_change_requires_provider_change (priv->address_providers,
-	                                            priv->address_provider,
-	                                            provider, status) &&
-	    gc_master_client_choose_address_provider (client, 
-	                                              priv->address_providers)) {
-		
+}
+
+static void
+address_selection_changed (GcCandidates   *candidates,
+                           GcMasterClient *client)
+{
+	if (gc_master_client_follow_address_provider (client)) {
 		/* we have a new address provider, force-emit address_changed */
 		gc_master_client_emit_address_changed (client);
 	}
 }
 
 static void
-accuracy_changed (GcMasterProvider     *provider,
-                  GcInterfaceFlags      interface,
-                  GeoclueAccuracyLevel  level,
-                  GcMasterClient       *client)
+velocity_selection_changed (GcCandidates   *candidates,
+                            GcMasterClient *client)
+{
+	if (gc_master_client_follow_velocity_provider (client)) {
+		/* we have a new velocity provider, force-emit velocity_changed */
+		gc_master_client_emit_velocity_changed (client);
+	}
+}
+
+/* milliseconds */
+static gint64
+get_time (void)
+{
+	GTimeVal now;
+
+	g_get_current_time (&now);
+	return (gint64) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+/* Returns the number of milliseconds until min_time has passed since
+ * the last emit at last_changed, 0 if a signal can be emitted now */
+static guint
+get_throttle_delay (GcMasterClientPrivate *priv, gint64 last_changed)
+{
+	gint64 elapsed;
+
+	if (priv->min_time <= 0) {
+		return 0;
+	}
+
+	elapsed = get_time () - last_changed;
+	if (elapsed < 0 || elapsed >= (gint64) priv->min_time * 1000) {
+		/* clock went backwards or min_time has passed */
+		return 0;
+	}
+	return (guint) ((gint64) priv->min_time * 1000 - elapsed);
+}
+
+static void
+gc_master_client_clear_pending_position (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcInterfaceAccuracy *accuracy_data;
-	
-	accuracy_data = g_new0 (GcInterfaceAccuracy, 1);
-	g_debug ("client: %s accuracy changed (%d)", 
-	         gc_master_provider_get_name (provider), level);
-	
-	accuracy_data->interface = interface;
-	accuracy_data->accuracy_level = priv->min_accuracy;
-	switch (interface) {
-		case GC_IFACE_POSITION:
-			priv->position_providers = 
-				g_list_sort_with_data (priv->position_providers, 
-						       (GCompareDataFunc)gc_master_provider_compare,
-						       accuracy_data);
-			if (priv->position_provider_choice_in_progress) {
-				g_debug ("        ...but provider choice in progress");
-			} else if (gc_master_client_choose_position_provider (client, 
-									      priv->position_providers)) {
-				gc_master_client_emit_position_changed (client);
-			}
-			break;
-			
-		case GC_IFACE_ADDRESS:
-			priv->address_providers = 
-				g_list_sort_with_data (priv->address_providers, 
-						       (GCompareDataFunc)gc_master_provider_compare,
-						       accuracy_data);
-			if (priv->address_provider_choice_in_progress) {
-				g_debug ("        ...but provider choice in progress");
-			} else if (gc_master_client_choose_address_provider (client, 
-								      priv->address_providers)) {
-				gc_master_client_emit_address_changed (client);
-			}
-			break;
-			
-		default:
-			g_assert_not_reached ();
-	}
-	g_free (accuracy_data);
+
+	if (priv->position_throttle_id > 0) {
+		g_source_remove (priv->position_throttle_id);
+		priv->position_throttle_id = 0;
+	}
+	if (priv->pending_position) {
+		geoclue_accuracy_free (priv->pending_position->accuracy);
+		g_free (priv->pending_position);
+		priv->pending_position = NULL;
+	}
 }
 
 static void
-position_changed (GcMasterProvider     *provider,
-                  GeocluePositionFields fields,
-                  int                   timestamp,
-                  double                latitude,
-                  double                longitude,
-                  double                altitude,
-                  GeoclueAccuracy      *accuracy,
-                  GcMasterClient       *client)
+gc_master_client_clear_pending_address (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	time_t now;
 
-	now = time (NULL);
-	if (priv->min_time > (now - priv->last_position_changed)) {
-		/* NOTE: currently no-one makes sure there is an emit
-		 * after min_time */
-		return;
+	if (priv->address_throttle_id > 0) {
+		g_source_remove (priv->address_throttle_id);
+		priv->address_throttle_id = 0;
+	}
+	if (priv->pending_address) {
+		geoclue_address_details_unref (priv->pending_address->details);
+		geoclue_accuracy_free (priv->pending_address->accuracy);
+		g_free (priv->pending_address);
+		priv->pending_address = NULL;
 	}
-	priv->last_position_changed = now;
+}
+
+/* Emits the latest position received during the throttle period */
+static gboolean
+flush_pending_position (gpointer data)
+{
+	GcMasterClient *client = data;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcPendingPosition *pending = priv->pending_position;
+
+	priv->position_throttle_id = 0;
+	priv->pending_position = NULL;
+	priv->last_position_changed = get_time ();
 
 	gc_iface_position_emit_position_changed
 		(GC_IFACE_POSITION (client),
-		 fields,
+		 pending->fields,
+		 pending->timestamp,
+		 pending->latitude, pending->longitude, pending->altitude,
+		 pending->accuracy);
+
+	geoclue_accuracy_free (pending->accuracy);
+	g_free (pending);
+	return FALSE;
+}
+
+static void
+gc_master_client_clear_pending_velocity (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+
+	if (priv->velocity_throttle_id > 0) {
+		g_source_remove (priv->velocity_throttle_id);
+		priv->velocity_throttle_id = 0;
+	}
+	if (priv->pending_velocity) {
+		g_free (priv->pending_velocity);
+		priv->pending_velocity = NULL;
+	}
+}
+
+static void
+gc_master_client_clear_pending_fix (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+
+	if (priv->fix_throttle_id > 0) {
+		g_source_remove (priv->fix_throttle_id);
+		priv->fix_throttle_id = 0;
+	}
+}
+
+static gboolean
+flush_pending_velocity (gpointer data)
+{
+	GcMasterClient *client = data;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcPendingVelocity *pending = priv->pending_velocity;
+
+	priv->velocity_throttle_id = 0;
+	priv->pending_velocity = NULL;
+	priv->last_velocity_changed = get_time ();
+
+	gc_iface_velocity_emit_velocity_changed
+		(GC_IFACE_VELOCITY (client),
+		 pending->fields,
+		 pending->timestamp,
+		 pending->speed, pending->direction, pending->climb);
+
+	g_free (pending);
+	return FALSE;
+}
+
+/* The fix is read from the provider caches when it is emitted,
+ * so a throttled fix needs no copy of the values */
+static gboolean
+flush_pending_fix (gpointer data)
+{
+	GcMasterClient *client = data;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GeocluePositionFields position_fields;
+	GeoclueVelocityFields velocity_fields;
+	int timestamp;
+	double latitude, longitude, altitude;
+	double speed, direction, climb;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+
+	priv->fix_throttle_id = 0;
+	priv->last_fix_changed = get_time ();
+
+	position_fields = gc_master_provider_get_position
+		(priv->fix_provider,
+		 &timestamp,
+		 &latitude, &longitude, &altitude,
+		 &accuracy,
+		 &error);
+	if (error) {
+		g_error_free (error);
+		geoclue_accuracy_free (accuracy);
+		return FALSE;
+	}
+	/* the position timestamp is used for the fix */
+	velocity_fields = gc_master_provider_get_velocity
+		(priv->fix_provider,
+		 NULL,
+		 &speed, &direction, &climb,
+		 &error);
+	if (error) {
+		g_error_free (error);
+		velocity_fields = GEOCLUE_VELOCITY_FIELDS_NONE;
+	}
+
+	gc_iface_fix_emit_position_and_velocity_changed
+		(GC_IFACE_FIX (client),
+		 position_fields, velocity_fields,
 		 timestamp,
 		 latitude, longitude, altitude,
+		 speed, direction, climb,
 		 accuracy);
+	geoclue_accuracy_free (accuracy);
+	return FALSE;
 }
 
+static gboolean
+flush_pending_address (gpointer data)
+{
+	GcMasterClient *client = data;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcPendingAddress *pending = priv->pending_address;
+
+	priv->address_throttle_id = 0;
+	priv->pending_address = NULL;
+	priv->last_address_changed = get_time ();
+
+	gc_iface_address_emit_address_changed
+		(GC_IFACE_ADDRESS (client),
+		 pending->timestamp,
+		 geoclue_address_details_get_hash (pending->details),
+		 pending->accuracy);
+
+	geoclue_address_details_unref (pending->details);
+	geoclue_accuracy_free (pending->accuracy);
+	g_free (pending);
+	return FALSE;
+}
+
+/* Provider signals are rate-limited to one per min_time seconds: 
+ * updates within the period replace each other and only the latest 
+ * one is emitted when the period ends */
 static void
-address_changed (GcMasterProvider     *provider,
-                 int                   timestamp,
-                 GHashTable           *details,
-                 GeoclueAccuracy      *accuracy,
-                 GcMasterClient       *client)
+position_changed (GcMasterProvider     *provider,
+                  GeocluePositionFields fields,
+                  int                   timestamp,
+                  double                latitude,
+                  double                longitude,
+                  double                altitude,
+                  GeoclueAccuracy      *accuracy,
+                  GcMasterClient       *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	time_t now;
+	GcPendingPosition *pending;
+	guint delay;
 
-	now = time (NULL);
-	if (priv->min_time > (now - priv->last_address_changed)) {
-		/* NOTE: currently no-one makes sure there is an emit
-		 * after min_time */
+	delay = get_throttle_delay (priv, priv->last_position_changed);
+	if (delay == 0 && priv->position_throttle_id == 0) {
+		priv->last_position_changed = get_time ();
+		gc_iface_position_emit_position_changed
+			(GC_IFACE_POSITION (client),
+			 fields,
+			 timestamp,
+			 latitude, longitude, altitude,
+			 accuracy);
 		return;
 	}
-	priv->last_address_changed = now;
 
-	gc_iface_address_emit_address_changed
-		(GC_IFACE_ADDRESS (client),
-		 timestamp,
-		 details,
-		 accuracy);
+	pending = priv->pending_position;
+	if (!pending) {
+		pending = priv->pending_position = g_new0 (GcPendingPosition, 1);
+	}
+	pending->fields = fields;
+	pending->timestamp = timestamp;
+	pending->latitude = latitude;
+	pending->longitude = longitude;
+	pending->altitude = altitude;
+	geoclue_accuracy_free (pending->accuracy);
+	pending->accuracy = geoclue_accuracy_copy (accuracy);
+
+	if (priv->position_throttle_id == 0) {
+		priv->position_throttle_id = g_timeout_add (delay,
+		                                            flush_pending_position,
+		                                            client);
+	}
 }
 
-/*if changed_provider status changes, do we need to choose a new provider? */
-static gboolean
-status_change_requires_provider_change (GList            *provider_list,
-                                        GcMasterProvider *current_provider,
-                                        GcMasterProvider *changed_provider,
-                                        GeoclueStatus     status)
+static void
+fused_position_changed (GcCandidates         *candidates,
+                        GeocluePositionFields fields,
+                        int                   timestamp,
+                        double                latitude,
+                        double                longitude,
+                        double                altitude,
+                        GeoclueAccuracy      *accuracy,
+                        GcMasterClient       *client)
 {
-	if (!provider_list) {
-		return FALSE;
-		
-	} else if (current_provider == NULL) {
-		return (status == GEOCLUE_STATUS_AVAILABLE);
-		
-	} else if (current_provider == changed_provider) {
-		return (status != GEOCLUE_STATUS_AVAILABLE);
-		
-	}else if (status != GEOCLUE_STATUS_AVAILABLE) {
-		return FALSE;
-		
+	position_changed (NULL, fields, timestamp,
+	                  latitude, longitude, altitude,
+	                  accuracy, client);
+}
+
+static void
+velocity_changed (GcMasterProvider     *provider,
+                  GeoclueVelocityFields fields,
+                  int                   timestamp,
+                  double                speed,
+                  double                direction,
+                  double                climb,
+                  GcMasterClient       *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcPendingVelocity *pending;
+	guint delay;
+
+	delay = get_throttle_delay (priv, priv->last_velocity_changed);
+	if (delay == 0 && priv->velocity_throttle_id == 0) {
+		priv->last_velocity_changed = get_time ();
+		gc_iface_velocity_emit_velocity_changed
+			(GC_IFACE_VELOCITY (client),
+			 fields,
+			 timestamp,
+			 speed, direction, climb);
+		return;
 	}
-	
-	while (provider_list) {
-		GcMasterProvider *p = provider_list->data;
-		if (p == current_provider) {
-			/* not interested in worse-than-current providers */
-			return FALSE;
-		}
-		if (p == changed_provider) {
-			/* changed_provider is better than current */
-			return (status == GEOCLUE_STATUS_AVAILABLE);
-		}
-		provider_list = provider_list->next;
+
+	pending = priv->pending_velocity;
+	if (!pending) {
+		pending = priv->pending_velocity = g_new0 (GcPendingVelocity, 1);
+	}
+	pending->fields = fields;
+	pending->timestamp = timestamp;
+	pending->speed = speed;
+	pending->direction = direction;
+	pending->climb = climb;
+
+	if (priv->velocity_throttle_id == 0) {
+		priv->velocity_throttle_id = g_timeout_add (delay,
+		                                            flush_pending_velocity,
+		                                            client);
 	}
-	return FALSE;
 }
 
 static void
-gc_master_client_connect_common_signals (GcMasterClient *client, GList *providers)
+fix_changed (GcMasterProvider *provider,
+             GcMasterClient   *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GList *l;
-	
-	/* connect to common signals if the provider is not already connected */
-	l = providers;
-	while (l) {
-		GcMasterProvider *p = l->data;
-		if (!g_list_find (priv->address_providers, p) &&
-		    !g_list_find (priv->position_providers, p)) {
-			g_debug ("client: connecting to '%s' accuracy-changed and status-changed", gc_master_provider_get_name (p));
-			g_signal_connect (G_OBJECT (p),
-					  "status-changed",
-					  G_CALLBACK (status_changed),
-					  client);
-			g_signal_connect (G_OBJECT (p),
-					  "accuracy-changed",
-					  G_CALLBACK (accuracy_changed),
-					  client);
-		}
-		l = l->next;
+	guint delay;
+
+	if (priv->fix_throttle_id > 0) {
+		return;
+	}
+	delay = get_throttle_delay (priv, priv->last_fix_changed);
+	if (delay == 0) {
+		flush_pending_fix (client);
+	} else {
+		priv->fix_throttle_id = g_timeout_add (delay,
+		                                       flush_pending_fix,
+		                                       client);
 	}
 }
 
+/* details and its hash table are shared by all the clients of the 
+ * provider: only references are taken here */
 static void
-gc_master_client_unsubscribe_providers (GcMasterClient *client, GList *provider_list, GcInterfaceFlags iface)
+address_changed (GcMasterProvider      *provider,
+                 int                    timestamp,
+                 GeoclueAddressDetails *details,
+                 GeoclueAccuracy       *accuracy,
+                 GcMasterClient        *client)
 {
-	while (provider_list) {
-		GcMasterProvider *provider = provider_list->data;
-		
-		gc_master_provider_unsubscribe (provider, client, iface);
-		provider_list = provider_list->next;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcPendingAddress *pending;
+	guint delay;
+
+	delay = get_throttle_delay (priv, priv->last_address_changed);
+	if (delay == 0 && priv->address_throttle_id == 0) {
+		priv->last_address_changed = get_time ();
+		gc_iface_address_emit_address_changed
+			(GC_IFACE_ADDRESS (client),
+			 timestamp,
+			 geoclue_address_details_get_hash (details),
+			 accuracy);
+		return;
+	}
+
+	pending = priv->pending_address;
+	if (!pending) {
+		pending = priv->pending_address = g_new0 (GcPendingAddress, 1);
+	} else {
+		geoclue_address_details_unref (pending->details);
+		geoclue_accuracy_free (pending->accuracy);
+	}
+	pending->timestamp = timestamp;
+	pending->details = geoclue_address_details_ref (details);
+	pending->accuracy = geoclue_accuracy_copy (accuracy);
+
+	if (priv->address_throttle_id == 0) {
+		priv->address_throttle_id = g_timeout_add (delay,
+		                                           flush_pending_address,
+		                                           client);
 	}
-	
 }
 
-/* get_best_provider will return the best provider with status == GEOCLUE_STATUS_AVAILABLE.
- * It will also "subscribe" to that provider and all better ones, and unsubscribe from worse.*/
-static GcMasterProvider *
-gc_master_client_get_best_provider (GcMasterClient    *client,
-                                    GList            **provider_list,
-                                    GcInterfaceFlags   iface)
+/* Emits the position of a newly chosen provider, once it has 
+ * answered. The client may have switched providers again meanwhile */
+static void
+emit_position_callback (GcMasterProvider     *provider,
+                        GeocluePositionFields fields,
+                        int                   timestamp,
+                        double                latitude,
+                        double                longitude,
+                        double                altitude,
+                        GeoclueAccuracy      *accuracy,
+                        GError               *error,
+                        gpointer              userdata)
 {
-	GList *l = *provider_list;
-	/* TODO: should maybe choose a acquiring provider if better ones are are not available */
-	
-	g_debug ("client: choosing best provider");
+	GcMasterClient *client = userdata;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	while (l) {
-		GcMasterProvider *provider = l->data;
-		
-		g_debug ("        ...trying provider %s", gc_master_provider_get_name (provider));
-		if (gc_master_provider_subscribe (provider, client, iface)) {
-			/* provider was started, so accuracy may have changed 
-			   (which re-sorts provider lists), restart provider selection */
-			/* TODO re-think this: restarting provider selection leads to potentially
-			   never-ending looping */
-			g_debug ("        ...started %s (status %d), re-starting provider selection",
-			         gc_master_provider_get_name (provider),
-			         gc_master_provider_get_status (provider));
-			l = *provider_list;
-			continue;
-		}
-		/* provider did not need to be started */
-		
-		/* TODO: currently returning even providers that are worse than priv->min_accuracy,
-		 * if nothing else is available */
-		if (gc_master_provider_get_status (provider) == GEOCLUE_STATUS_AVAILABLE) {
-			/* unsubscribe from all providers worse than this */
-			gc_master_client_unsubscribe_providers (client, l->next, iface);
-			return provider;
-		}
-		l = l->next;
+	if (provider != priv->position_provider ||
+	    gc_master_client_fuses_position (client)) {
+		/* ignore */
+	} else if (error) {
+		/*TODO what now?*/
+		g_warning ("client: failed to get position from %s: %s", 
+		           gc_master_provider_get_name (provider),
+		           error->message);
+	} else {
+		gc_iface_position_emit_position_changed
+			(GC_IFACE_POSITION (client),
+			 fields,
+			 timestamp,
+			 latitude, longitude, altitude,
+			 accuracy);
 	}
 	
-	/* no provider found */
-	gc_master_client_unsubscribe_providers (client, *provider_list, iface);
-	return NULL;
+	if (accuracy) {
+		geoclue_accuracy_free (accuracy);
+	}
+	if (error) {
+		g_error_free (error);
+	}
+	g_object_unref (client);
 }
 
 static void
@@ -396,8 +658,26 @@ gc_master_client_emit_position_changed (GcMasterClient *client)
 	int timestamp;
 	double latitude, longitude, altitude;
 	GeoclueAccuracy *accuracy = NULL;
-	GError *error = NULL;
 	
+	/* this emit supersedes any throttled update */
+	gc_master_client_clear_pending_position (client);
+	priv->last_position_changed = get_time ();
+	
+	if (gc_master_client_fuses_position (client)) {
+		fields = gc_candidates_get_position
+			(priv->position_candidates,
+			 &timestamp,
+			 &latitude, &longitude, &altitude,
+			 &accuracy);
+		gc_iface_position_emit_position_changed
+			(GC_IFACE_POSITION (client),
+			 fields,
+			 timestamp,
+			 latitude, longitude, altitude,
+			 accuracy);
+		geoclue_accuracy_free (accuracy);
+		return;
+	}
 	
 	if (priv->position_provider == NULL) {
 		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
@@ -411,36 +691,59 @@ gc_master_client_emit_position_changed (GcMasterClient *client)
 		return;
 	}
 	
-	fields = gc_master_provider_get_position
-		(priv->position_provider,
-		 &timestamp,
-		 &latitude, &longitude, &altitude,
-		 &accuracy,
-		 &error);
-	if (error) {
+	gc_master_provider_get_position_async (priv->position_provider,
+	                                       emit_position_callback,
+	                                       g_object_ref (client));
+}
+
+static void
+emit_address_callback (GcMasterProvider *provider,
+                       int               timestamp,
+                       GHashTable       *details,
+                       GeoclueAccuracy  *accuracy,
+                       GError           *error,
+                       gpointer          userdata)
+{
+	GcMasterClient *client = userdata;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	if (provider != priv->address_provider) {
+		/* ignore */
+	} else if (error) {
 		/*TODO what now?*/
-		g_warning ("client: failed to get position from %s: %s", 
-		           gc_master_provider_get_name (priv->position_provider),
+		g_warning ("client: failed to get address from %s: %s", 
+		           gc_master_provider_get_name (provider),
 		           error->message);
+	} else {
+		gc_iface_address_emit_address_changed
+			(GC_IFACE_ADDRESS (client),
+			 timestamp,
+			 details,
+			 accuracy);
+	}
+	
+	if (details) {
+		g_hash_table_unref (details);
+	}
+	if (accuracy) {
+		geoclue_accuracy_free (accuracy);
+	}
+	if (error) {
 		g_error_free (error);
-		return;
 	}
-	gc_iface_position_emit_position_changed
-		(GC_IFACE_POSITION (client),
-		 fields,
-		 timestamp,
-		 latitude, longitude, altitude,
-		 accuracy);
+	g_object_unref (client);
 }
 
 static void 
 gc_master_client_emit_address_changed (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	int timestamp;
 	GHashTable *details = NULL;
 	GeoclueAccuracy *accuracy = NULL;
-	GError *error = NULL;
+	
+	/* this emit supersedes any throttled update */
+	gc_master_client_clear_pending_address (client);
+	priv->last_address_changed = get_time ();
 	
 	if (priv->address_provider == NULL) {
 		accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0.0, 0.0);
@@ -450,44 +753,114 @@ gc_master_client_emit_address_changed (GcMasterClient *client)
 			 time (NULL),
 			 details,
 			 accuracy);
-		g_hash_table_destroy (details);
+		g_hash_table_unref (details);
 		geoclue_accuracy_free (accuracy);
 		return;
 	}
-	if (!gc_master_provider_get_address
-		(priv->address_provider,
-		 &timestamp,
-		 &details,
-		 &accuracy,
-		 &error)) {
-		/*TODO what now?*/
-		g_warning ("client: failed to get address from %s: %s", 
-		           gc_master_provider_get_name (priv->address_provider),
+	gc_master_provider_get_address_async (priv->address_provider,
+	                                      emit_address_callback,
+	                                      g_object_ref (client));
+}
+
+static void
+emit_velocity_callback (GcMasterProvider     *provider,
+                        GeoclueVelocityFields fields,
+                        int                   timestamp,
+                        double                speed,
+                        double                direction,
+                        double                climb,
+                        GError               *error,
+                        gpointer              userdata)
+{
+	GcMasterClient *client = userdata;
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	if (provider != priv->velocity_provider) {
+		/* ignore */
+	} else if (error) {
+		g_warning ("client: failed to get velocity from %s: %s", 
+		           gc_master_provider_get_name (provider),
 		           error->message);
+	} else {
+		gc_iface_velocity_emit_velocity_changed
+			(GC_IFACE_VELOCITY (client),
+			 fields,
+			 timestamp,
+			 speed, direction, climb);
+	}
+	
+	if (error) {
 		g_error_free (error);
+	}
+	g_object_unref (client);
+}
+
+static void 
+gc_master_client_emit_velocity_changed (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	/* this emit supersedes any throttled update */
+	gc_master_client_clear_pending_velocity (client);
+	priv->last_velocity_changed = get_time ();
+	
+	if (priv->velocity_provider == NULL) {
+		gc_iface_velocity_emit_velocity_changed
+			(GC_IFACE_VELOCITY (client),
+			 GEOCLUE_VELOCITY_FIELDS_NONE,
+			 time (NULL),
+			 0.0, 0.0, 0.0);
 		return;
 	}
-	gc_iface_address_emit_address_changed
-		(GC_IFACE_ADDRESS (client),
-		 timestamp,
-		 details,
-		 accuracy);
+	
+	gc_master_provider_get_velocity_async (priv->velocity_provider,
+	                                       emit_velocity_callback,
+	                                       g_object_ref (client));
 }
 
-/* return true if a _new_ provider was chosen */
+/* Position and velocity from the same provider are also sent as 
+ * combined fixes: follow "fix-changed" of that provider */
+static void
+gc_master_client_update_fix_provider (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcMasterProvider *new_p = NULL;
+	
+	if (priv->position_provider &&
+	    priv->position_provider == priv->velocity_provider &&
+	    !gc_master_client_fuses_position (client)) {
+		new_p = priv->position_provider;
+	}
+	if (new_p == priv->fix_provider) {
+		return;
+	}
+	
+	gc_master_client_clear_pending_fix (client);
+	if (priv->signals[FIX_CHANGED] > 0) {
+		g_signal_handler_disconnect (priv->fix_provider, 
+		                             priv->signals[FIX_CHANGED]);
+		priv->signals[FIX_CHANGED] = 0;
+	}
+	
+	priv->fix_provider = new_p;
+	if (priv->fix_provider) {
+		priv->signals[FIX_CHANGED] =
+			g_signal_connect (G_OBJECT (priv->fix_provider),
+			                  "fix-changed",
+			                  G_CALLBACK (fix_changed),
+			                  client);
+	}
+}
+
+/* switch to the provider chosen for our requirements,
+ * return true if it is a _new_ provider */
 static gboolean
-gc_master_client_choose_position_provider (GcMasterClient *client, 
-                                           GList *providers)
+gc_master_client_follow_position_provider (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	GcMasterProvider *new_p;
 	
-	/* choose and start provider */
-	priv->position_provider_choice_in_progress = TRUE;
-	new_p = gc_master_client_get_best_provider (client, 
-	                                            &priv->position_providers, 
-	                                            GC_IFACE_POSITION);
-	priv->position_provider_choice_in_progress = FALSE;
+	new_p = priv->position_candidates->selected;
 	
 	if (priv->position_provider && new_p == priv->position_provider) {
 		return FALSE;
@@ -500,6 +873,7 @@ gc_master_client_choose_position_provider (GcMasterClient *client,
 	}
 	
 	priv->position_provider = new_p;
+	gc_master_client_update_fix_provider (client);
 	
 	if (priv->position_provider == NULL) {
 		g_debug ("client: position provider changed (to NULL)");
@@ -514,29 +888,25 @@ gc_master_client_choose_position_provider (GcMasterClient *client,
 		       gc_master_provider_get_description (priv->position_provider),
 		       gc_master_provider_get_service (priv->position_provider),
 		       gc_master_provider_get_path (priv->position_provider));
-	priv->signals[POSITION_CHANGED] =
-		g_signal_connect (G_OBJECT (priv->position_provider),
-				  "position-changed",
-				  G_CALLBACK (position_changed),
-				  client);
+	if (!gc_master_client_fuses_position (client)) {
+		priv->signals[POSITION_CHANGED] =
+			g_signal_connect (G_OBJECT (priv->position_provider),
+					  "position-changed",
+					  G_CALLBACK (position_changed),
+					  client);
+	}
 	return TRUE;
 }
 
-/* return true if a _new_ provider was chosen */
+/* switch to the provider chosen for our requirements,
+ * return true if it is a _new_ provider */
 static gboolean
-gc_master_client_choose_address_provider (GcMasterClient *client, 
-                                          GList *providers)
+gc_master_client_follow_address_provider (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	GcMasterProvider *new_p;
 	
-	
-	/* choose and start provider */
-	priv->address_provider_choice_in_progress = TRUE;
-	new_p = gc_master_client_get_best_provider (client, 
-	                                            &priv->address_providers, 
-	                                            GC_IFACE_ADDRESS);
-	priv->address_provider_choice_in_progress = FALSE;
+	new_p = priv->address_candidates->selected;
 	
 	if (priv->address_provider != NULL && new_p == priv->address_provider) {
 		/* keep using the same provider */
@@ -572,91 +942,155 @@ gc_master_client_choose_address_provider (GcMasterClient *client,
 	return TRUE;
 }
 
-static void
-gc_master_provider_set_position_providers (GcMasterClient *client, 
-                                           GList *providers)
+/* switch to the provider chosen for our requirements,
+ * return true if it is a _new_ provider */
+static gboolean
+gc_master_client_follow_velocity_provider (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcInterfaceAccuracy *accuracy_data;
+	GcMasterProvider *new_p;
 	
-	accuracy_data = g_new0(GcInterfaceAccuracy, 1);
-	accuracy_data->interface = GC_IFACE_POSITION;
-	accuracy_data->accuracy_level = priv->min_accuracy;
+	new_p = priv->velocity_candidates->selected;
 	
-	gc_master_client_connect_common_signals (client, providers);
-	priv->position_providers = 
-		g_list_sort_with_data (providers,
-		                       (GCompareDataFunc)gc_master_provider_compare,
-		                       accuracy_data);
+	if (priv->velocity_provider && new_p == priv->velocity_provider) {
+		return FALSE;
+	}
 	
-	g_free (accuracy_data);
+	if (priv->signals[VELOCITY_CHANGED] > 0) {
+		g_signal_handler_disconnect (priv->velocity_provider, 
+		                             priv->signals[VELOCITY_CHANGED]);
+		priv->signals[VELOCITY_CHANGED] = 0;
+	}
+	
+	priv->velocity_provider = new_p;
+	gc_master_client_update_fix_provider (client);
+	
+	if (priv->velocity_provider == NULL) {
+		g_debug ("client: velocity provider changed (to NULL)");
+		g_signal_emit (client, signals[VELOCITY_PROVIDER_CHANGED], 0, 
+		               NULL, NULL, NULL, NULL);
+		return TRUE;
+	}
+	
+	g_debug ("client: velocity provider changed (to %s)", gc_master_provider_get_name (priv->velocity_provider));
+	g_signal_emit (client, signals[VELOCITY_PROVIDER_CHANGED], 0, 
+		       gc_master_provider_get_name (priv->velocity_provider),
+		       gc_master_provider_get_description (priv->velocity_provider),
+		       gc_master_provider_get_service (priv->velocity_provider),
+		       gc_master_provider_get_path (priv->velocity_provider));
+	priv->signals[VELOCITY_CHANGED] =
+		g_signal_connect (G_OBJECT (priv->velocity_provider),
+				  "velocity-changed",
+				  G_CALLBACK (velocity_changed),
+				  client);
+	return TRUE;
 }
 
+/* leave the requirement group, e.g. when requirements change */
 static void
-gc_master_provider_set_address_providers (GcMasterClient *client, 
-                                           GList *providers)
+gc_master_client_drop_candidates (GcMasterClient  *client,
+                                  GcCandidates   **candidates)
 {
-	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GcInterfaceAccuracy *accuracy_data;
-	
-	accuracy_data = g_new0(GcInterfaceAccuracy, 1);
-	accuracy_data->interface = GC_IFACE_ADDRESS;
-	accuracy_data->accuracy_level = priv->min_accuracy;
-	
-	gc_master_client_connect_common_signals (client, providers);
-	priv->address_providers = 
-		g_list_sort_with_data (providers,
-		                       (GCompareDataFunc)gc_master_provider_compare,
-		                       accuracy_data);
-	
-	g_free (accuracy_data);
+	if (*candidates == NULL) {
+		return;
+	}
+	g_signal_handlers_disconnect_matched (*candidates,
+	                                      G_SIGNAL_MATCH_DATA,
+	                                      0, 0, NULL, NULL,
+	                                      client);
+	g_object_unref (*candidates);
+	*candidates = NULL;
 }
 
 static void
 gc_master_client_init_position_providers (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
-	GList *providers;
+	GcCandidates *cands;
+	gboolean was_fused;
 	
 	if (!priv->position_started) {
 		return;
 	}
-	 
-	/* TODO: free priv->position_providers */
 	
-	providers = gc_master_get_providers (GC_IFACE_POSITION,
-	                                     priv->min_accuracy,
-	                                     priv->require_updates,
-	                                     priv->allowed_resources,
-	                                     NULL);
+	/* join the new group before leaving the old one so that providers
+	 * both groups use are not stopped in between */
+	was_fused = gc_master_client_fuses_position (client);
+	cands = gc_master_get_candidates (GC_IFACE_POSITION,
+	                                  priv->min_accuracy,
+	                                  priv->require_updates,
+	                                  priv->allowed_resources);
+	gc_master_client_drop_candidates (client, &priv->position_candidates);
+	priv->position_candidates = cands;
+	
+	if (was_fused != gc_master_client_fuses_position (client)) {
+		/* the fusion setting changed: follow the provider anew
+		 * even if it stays the same */
+		if (priv->signals[POSITION_CHANGED] > 0) {
+			g_signal_handler_disconnect (priv->position_provider,
+			                             priv->signals[POSITION_CHANGED]);
+			priv->signals[POSITION_CHANGED] = 0;
+		}
+		priv->position_provider = NULL;
+	}
 	g_debug ("client: %d position providers matching requirements found, now choosing current provider", 
-	         g_list_length (providers));
+	         g_list_length (priv->position_candidates->providers));
 	
-	gc_master_provider_set_position_providers (client, providers);
-	gc_master_client_choose_position_provider (client, priv->position_providers);
+	g_signal_connect (priv->position_candidates, "selection-changed",
+	                  G_CALLBACK (position_selection_changed), client);
+	if (gc_master_client_fuses_position (client)) {
+		g_signal_connect (priv->position_candidates, "position-changed",
+		                  G_CALLBACK (fused_position_changed), client);
+	}
+	gc_master_client_follow_position_provider (client);
 }
+
 static void
 gc_master_client_init_address_providers (GcMasterClient *client)
 {
-	GList *providers;
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcCandidates *cands;
 	
 	if (!priv->address_started) {
 		return;
 	}
-	 
-	/* TODO: free priv->address_providers */
 	
-	providers = gc_master_get_providers (GC_IFACE_ADDRESS,
-	                                     priv->min_accuracy,
-	                                     priv->require_updates,
-	                                     priv->allowed_resources,
-	                                     NULL);
+	cands = gc_master_get_candidates (GC_IFACE_ADDRESS,
+	                                  priv->min_accuracy,
+	                                  priv->require_updates,
+	                                  priv->allowed_resources);
+	gc_master_client_drop_candidates (client, &priv->address_candidates);
+	priv->address_candidates = cands;
 	g_debug ("client: %d address providers matching requirements found, now choosing current provider", 
-	         g_list_length (providers));
+	         g_list_length (priv->address_candidates->providers));
 	
-	gc_master_provider_set_address_providers (client, providers);
-	gc_master_client_choose_address_provider (client, priv->address_providers);
+	g_signal_connect (priv->address_candidates, "selection-changed",
+	                  G_CALLBACK (address_selection_changed), client);
+	gc_master_client_follow_address_provider (client);
+}
+
+static void
+gc_master_client_init_velocity_providers (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GcCandidates *cands;
+	
+	if (!priv->velocity_started) {
+		return;
+	}
+	
+	cands = gc_master_get_candidates (GC_IFACE_VELOCITY,
+	                                  priv->min_accuracy,
+	                                  priv->require_updates,
+	                                  priv->allowed_resources);
+	gc_master_client_drop_candidates (client, &priv->velocity_candidates);
+	priv->velocity_candidates = cands;
+	g_debug ("client: %d velocity providers matching requirements found, now choosing current provider", 
+	         g_list_length (priv->velocity_candidates->providers));
+	
+	g_signal_connect (priv->velocity_candidates, "selection-changed",
+	                  G_CALLBACK (velocity_selection_changed), client);
+	gc_master_client_follow_velocity_provider (client);
 }
 
 static gboolean
@@ -676,6 +1110,7 @@ gc_iface_master_client_set_requirements (GcMasterClient        *client,
 	
 	gc_master_client_init_position_providers (client);
 	gc_master_client_init_address_providers (client);
+	gc_master_client_init_velocity_providers (client);
 	
 	return TRUE;
 }
@@ -687,7 +1122,7 @@ gc_iface_master_client_position_start (GcMasterClient *client,
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	if (priv->position_providers) {
+	if (priv->position_candidates) {
 		if (error) {
 			*error = g_error_new (GEOCLUE_ERROR,
 			                      GEOCLUE_ERROR_FAILED,
@@ -709,7 +1144,7 @@ gc_iface_master_client_address_start (GcMasterClient *client,
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	if (priv->address_providers) {
+	if (priv->address_candidates) {
 		if (error) {
 			*error = g_error_new (GEOCLUE_ERROR,
 					      GEOCLUE_ERROR_FAILED,
@@ -723,6 +1158,26 @@ gc_iface_master_client_address_start (GcMasterClient *client,
 	return TRUE;
 }
 
+static gboolean 
+gc_iface_master_client_velocity_start (GcMasterClient *client,
+                                       GError         **error)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	if (priv->velocity_candidates) {
+		if (error) {
+			*error = g_error_new (GEOCLUE_ERROR,
+			                      GEOCLUE_ERROR_FAILED,
+			                      "Velocity interface already started");
+		}
+		return FALSE;
+	}
+	
+	priv->velocity_started = TRUE;
+	gc_master_client_init_velocity_providers (client);
+	return TRUE;
+}
+
 static void
 get_master_provider_details (GcMasterProvider  *provider,
                              char             **name,
@@ -791,24 +1246,57 @@ gc_iface_master_client_get_position_provider (GcMasterClient  *client,
 	return TRUE;
 }
 
+static gboolean 
+gc_iface_master_client_get_velocity_provider (GcMasterClient  *client,
+                                              char           **name,
+                                              char           **description,
+                                              char           **service,
+                                              char           **path,
+                                              GError         **error)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	
+	get_master_provider_details (priv->velocity_provider,
+	                             name, description, service, path);
+	return TRUE;
+}
+
 static void
 finalize (GObject *object)
 {
 	GcMasterClient *client = GC_MASTER_CLIENT (object);
 	GcMasterClientPrivate *priv = GET_PRIVATE (object);
 	
-	/* do not free contents of the lists, Master takes care of them */
-	if (priv->position_providers) {
-		gc_master_client_unsubscribe_providers (client, priv->position_providers, GC_IFACE_ALL);
-		g_list_free (priv->position_providers);
-		priv->position_providers = NULL;
+	gc_master_client_clear_pending_position (client);
+	gc_master_client_clear_pending_address (client);
+	gc_master_client_clear_pending_velocity (client);
+	gc_master_client_clear_pending_fix (client);
+	
+	/* providers outlive clients: make sure they do not call us anymore */
+	if (priv->position_provider && priv->signals[POSITION_CHANGED] > 0) {
+		g_signal_handler_disconnect (priv->position_provider,
+		                             priv->signals[POSITION_CHANGED]);
+	}
+	if (priv->address_provider && priv->signals[ADDRESS_CHANGED] > 0) {
+		g_signal_handler_disconnect (priv->address_provider,
+		                             priv->signals[ADDRESS_CHANGED]);
+	}
+	if (priv->velocity_provider && priv->signals[VELOCITY_CHANGED] > 0) {
+		g_signal_handler_disconnect (priv->velocity_provider,
+		                             priv->signals[VELOCITY_CHANGED]);
 	}
-	if (priv->address_providers) {
-		gc_master_client_unsubscribe_providers (client, priv->address_providers, GC_IFACE_ALL);
-		g_list_free (priv->address_providers);
-		priv->address_providers = NULL;
+	if (priv->fix_provider && priv->signals[FIX_CHANGED] > 0) {
+		g_signal_handler_disconnect (priv->fix_provider,
+		                             priv->signals[FIX_CHANGED]);
 	}
 	
+	g_free (priv->owner);
+	g_hash_table_destroy (priv->connections);
+	
+	gc_master_client_drop_candidates (client, &priv->position_candidates);
+	gc_master_client_drop_candidates (client, &priv->address_candidates);
+	gc_master_client_drop_candidates (client, &priv->velocity_candidates);
+	
 	((GObjectClass *) gc_master_client_parent_class)->finalize (object);
 }
 
@@ -837,6 +1325,21 @@ gc_master_client_class_init (GcMasterClientClass *klass)
 		              geoclue_marshal_VOID__STRING_STRING_STRING_STRING,
 		              G_TYPE_NONE, 4,
 		              G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+	signals[VELOCITY_PROVIDER_CHANGED] = 
+		g_signal_new ("velocity-provider-changed",
+		              G_OBJECT_CLASS_TYPE (klass),
+		              G_SIGNAL_RUN_LAST, 0,
+		              NULL, NULL,
+		              geoclue_marshal_VOID__STRING_STRING_STRING_STRING,
+		              G_TYPE_NONE, 4,
+		              G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+	signals[RELEASED] = 
+		g_signal_new ("released",
+		              G_OBJECT_CLASS_TYPE (klass),
+		              G_SIGNAL_RUN_LAST, 0,
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__VOID,
+		              G_TYPE_NONE, 0);
 	
 	dbus_g_object_type_install_info (gc_master_client_get_type (),
 					 &dbus_glib_gc_iface_master_client_object_info);
@@ -849,74 +1352,235 @@ gc_master_client_init (GcMasterClient *client)
 {
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
 	
-	priv->position_provider_choice_in_progress = FALSE;
-	priv->address_provider_choice_in_progress = FALSE;
-	
 	priv->position_started = FALSE;
 	priv->position_provider = NULL;
-	priv->position_providers = NULL;
+	priv->position_candidates = NULL;
 	
 	priv->address_started = FALSE;
 	priv->address_provider = NULL;
-	priv->address_providers = NULL;
+	priv->address_candidates = NULL;
+	
+	priv->velocity_started = FALSE;
+	priv->velocity_provider = NULL;
+	priv->velocity_candidates = NULL;
+	priv->fix_provider = NULL;
+	
+	priv->connections = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 }
 
-static gboolean
-get_position (GcIfacePosition       *iface,
-	      GeocluePositionFields *fields,
-	      int                   *timestamp,
-	      double                *latitude,
-	      double                *longitude,
-	      double                *altitude,
-	      GeoclueAccuracy      **accuracy,
-	      GError               **error)
+/* The client emits "released" once owner has disconnected and no 
+ * other peer holds a reference (AddReference) to it */
+GcMasterClient *
+gc_master_client_new (const char *owner)
+{
+	GcMasterClient *client;
+	GcMasterClientPrivate *priv;
+
+	client = g_object_new (GC_TYPE_MASTER_CLIENT, NULL);
+	priv = GET_PRIVATE (client);
+	priv->owner = g_strdup (owner);
+
+	return client;
+}
+
+static void
+gc_master_client_check_released (GcMasterClient *client)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+
+	if (priv->released || priv->owner ||
+	    g_hash_table_size (priv->connections) > 0) {
+		return;
+	}
+
+	g_debug ("client: no peers left, releasing");
+	priv->released = TRUE;
+	g_signal_emit (client, signals[RELEASED], 0);
+}
+
+/* Forgets the ownership and references held by name, a peer that
+ * has left the bus */
+void
+gc_master_client_remove_peer (GcMasterClient *client,
+                              const char     *name)
+{
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+
+	if (priv->owner && strcmp (priv->owner, name) == 0) {
+		g_free (priv->owner);
+		priv->owner = NULL;
+	}
+	if (g_hash_table_remove (priv->connections, name)) {
+		g_warning ("Impolite client %s disconnected without unreferencing\n", name);
+	}
+
+	gc_master_client_check_released (client);
+}
+
+
+/* Replies to GetPosition once the provider has answered: providers 
+ * that do not provide updates are queried, which may take a while */
+static void
+get_position_callback (GcMasterProvider     *provider,
+                       GeocluePositionFields fields,
+                       int                   timestamp,
+                       double                latitude,
+                       double                longitude,
+                       double                altitude,
+                       GeoclueAccuracy      *accuracy,
+                       GError               *error,
+                       gpointer              userdata)
+{
+	DBusGMethodInvocation *context = userdata;
+	
+	if (error) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+	} else {
+		if (!accuracy) {
+			accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+			                                 0.0, 0.0);
+		}
+		dbus_g_method_return (context, fields, timestamp,
+		                      latitude, longitude, altitude, accuracy);
+	}
+	if (accuracy) {
+		geoclue_accuracy_free (accuracy);
+	}
+}
+
+static void
+get_position_async (GcIfacePosition       *iface,
+                    DBusGMethodInvocation *context)
 {
 	GcMasterClient *client = GC_MASTER_CLIENT (iface);
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GeocluePositionFields fields;
+	int timestamp;
+	double latitude, longitude, altitude;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error;
+	
+	if (gc_master_client_fuses_position (client)) {
+		fields = gc_candidates_get_position
+			(priv->position_candidates,
+			 &timestamp,
+			 &latitude, &longitude, &altitude,
+			 &accuracy);
+		get_position_callback (NULL, fields, timestamp,
+		                       latitude, longitude, altitude,
+		                       accuracy, NULL, context);
+		return;
+	}
 	
 	if (priv->position_provider == NULL) {
-		if (error) {
-			*error = g_error_new (GEOCLUE_ERROR,
-			                      GEOCLUE_ERROR_NOT_AVAILABLE,
-			                      "Geoclue master client has no usable Position providers");
-		}
-		return FALSE;
+		error = g_error_new (GEOCLUE_ERROR,
+		                     GEOCLUE_ERROR_NOT_AVAILABLE,
+		                     "Geoclue master client has no usable Position providers");
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
 	}
 	
-	*fields = gc_master_provider_get_position
-		(priv->position_provider,
-		 timestamp,
-		 latitude, longitude, altitude,
-		 accuracy,
-		 error);
-	return (!*error);
+	gc_master_provider_get_position_async (priv->position_provider,
+	                                       get_position_callback,
+	                                       context);
 }
 
-static gboolean 
-get_address (GcIfaceAddress   *iface,
-             int              *timestamp,
-             GHashTable      **address,
-             GeoclueAccuracy **accuracy,
-             GError          **error)
+static void
+get_address_callback (GcMasterProvider *provider,
+                      int               timestamp,
+                      GHashTable       *details,
+                      GeoclueAccuracy  *accuracy,
+                      GError           *error,
+                      gpointer          userdata)
+{
+	DBusGMethodInvocation *context = userdata;
+	
+	if (error) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+	} else {
+		if (!details) {
+			details = geoclue_address_details_new ();
+		}
+		if (!accuracy) {
+			accuracy = geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE,
+			                                 0.0, 0.0);
+		}
+		dbus_g_method_return (context, timestamp, details, accuracy);
+	}
+	if (details) {
+		g_hash_table_unref (details);
+	}
+	if (accuracy) {
+		geoclue_accuracy_free (accuracy);
+	}
+}
+
+static void
+get_address_async (GcIfaceAddress        *iface,
+                   DBusGMethodInvocation *context)
 {
 	GcMasterClient *client = GC_MASTER_CLIENT (iface);
 	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GError *error;
 	
 	if (priv->address_provider == NULL) {
-		if (error) {
-			*error = g_error_new (GEOCLUE_ERROR,
-			                      GEOCLUE_ERROR_NOT_AVAILABLE,
-			                      "Geoclue master client has no usable Address providers");
-		}
-		return FALSE;
+		error = g_error_new (GEOCLUE_ERROR,
+		                     GEOCLUE_ERROR_NOT_AVAILABLE,
+		                     "Geoclue master client has no usable Address providers");
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
 	}
 	
-	return gc_master_provider_get_address
-		(priv->address_provider,
-		 timestamp,
-		 address,
-		 accuracy,
-		 error);
+	gc_master_provider_get_address_async (priv->address_provider,
+	                                      get_address_callback,
+	                                      context);
+}
+
+static void
+get_velocity_callback (GcMasterProvider     *provider,
+                       GeoclueVelocityFields fields,
+                       int                   timestamp,
+                       double                speed,
+                       double                direction,
+                       double                climb,
+                       GError               *error,
+                       gpointer              userdata)
+{
+	DBusGMethodInvocation *context = userdata;
+	
+	if (error) {
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+	} else {
+		dbus_g_method_return (context, fields, timestamp,
+		                      speed, direction, climb);
+	}
+}
+
+static void
+get_velocity_async (GcIfaceVelocity       *iface,
+                    DBusGMethodInvocation *context)
+{
+	GcMasterClient *client = GC_MASTER_CLIENT (iface);
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	GError *error;
+	
+	if (priv->velocity_provider == NULL) {
+		error = g_error_new (GEOCLUE_ERROR,
+		                     GEOCLUE_ERROR_NOT_AVAILABLE,
+		                     "Geoclue master client has no usable Velocity providers");
+		dbus_g_method_return_error (context, error);
+		g_error_free (error);
+		return;
+	}
+	
+	gc_master_provider_get_velocity_async (priv->velocity_provider,
+	                                       get_velocity_callback,
+	                                       context);
 }
 
 static gboolean
@@ -959,7 +1623,20 @@ static void
 add_reference (GcIfaceGeoclue *geoclue,
                DBusGMethodInvocation *context)
 {
-	/* TODO implement if needed */
+	GcMasterClientPrivate *priv = GET_PRIVATE (geoclue);
+	char *sender;
+	int *pcount;
+	
+	sender = dbus_g_method_get_sender (context);
+	pcount = g_hash_table_lookup (priv->connections, sender);
+	if (!pcount) {
+		pcount = g_malloc0 (sizeof (int));
+		g_hash_table_insert (priv->connections, sender, pcount);
+	} else {
+		g_free (sender);
+	}
+	(*pcount)++;
+	
 	dbus_g_method_return (context);
 }
 
@@ -967,8 +1644,25 @@ static void
 remove_reference (GcIfaceGeoclue *geoclue,
                   DBusGMethodInvocation *context)
 {
-	/* TODO implement if needed */
+	GcMasterClient *client = GC_MASTER_CLIENT (geoclue);
+	GcMasterClientPrivate *priv = GET_PRIVATE (client);
+	char *sender;
+	int *pcount;
+	
+	sender = dbus_g_method_get_sender (context);
+	pcount = g_hash_table_lookup (priv->connections, sender);
+	if (!pcount) {
+		g_warning ("Unreffed by client that has not been referenced");
+	} else {
+		(*pcount)--;
+		if (*pcount == 0) {
+			g_hash_table_remove (priv->connections, sender);
+		}
+	}
+	g_free (sender);
+	
 	dbus_g_method_return (context);
+	gc_master_client_check_released (client);
 }
 
 static void
@@ -984,11 +1678,17 @@ gc_master_client_geoclue_init (GcIfaceGeoclueClass *iface)
 static void
 gc_master_client_position_init (GcIfacePositionClass *iface)
 {
-	iface->get_position = get_position;
+	iface->get_position_async = get_position_async;
 }
 
 static void
 gc_master_client_address_init (GcIfaceAddressClass *iface)
 {
-	iface->get_address = get_address;
+	iface->get_address_async = get_address_async;
+}
+
+static void
+gc_master_client_velocity_init (GcIfaceVelocityClass *iface)
+{
+	iface->get_velocity_async = get_velocity_async;
 }
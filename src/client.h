@@ -44,4 +44,8 @@ typedef struct {
 
 GType gc_master_client_get_type (void);
 
+GcMasterClient *gc_master_client_new (const char *owner);
+void gc_master_client_remove_peer (GcMasterClient *client,
+                                   const char     *name);
+
 #endif
@@ -26,6 +26,8 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include <glib.h>
 #include <gio/gio.h>
 
@@ -43,6 +45,8 @@ static GcMaster *master;
 
 #define GEOCLUE_SCHEMA_NAME "org.freedesktop.Geoclue"
 #define GEOCLUE_MASTER_NAME "org.freedesktop.Geoclue.Master"
+#define GEOCLUE_WARM_UP_KEY "warm-up-providers"
+#define GEOCLUE_FUSE_KEY "fuse-positions"
 
 static GValue *
 gvariant_value_to_value (GVariant *value)
@@ -113,6 +117,12 @@ gsettings_key_changed (GSettings *settings,
 	GVariant *v;
 	GValue *gvalue;
 
+	/* master settings, not provider options */
+	if (strcmp (key, GEOCLUE_WARM_UP_KEY) == 0 ||
+	    strcmp (key, GEOCLUE_FUSE_KEY) == 0) {
+		return;
+	}
+
 	v = g_settings_get_value (settings, key);
 	gvalue = gvariant_value_to_value (v);
 	if (gvalue == NULL) {
@@ -182,6 +192,18 @@ geoclue_get_main_options (void)
         return options;
 }
 
+gboolean
+geoclue_get_warm_up_providers (void)
+{
+	return g_settings_get_boolean (settings, GEOCLUE_WARM_UP_KEY);
+}
+
+gboolean
+geoclue_get_fuse_positions (void)
+{
+	return g_settings_get_boolean (settings, GEOCLUE_FUSE_KEY);
+}
+
 int
 main (int    argc,
       char **argv)
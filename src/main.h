@@ -28,5 +28,7 @@
 #include <glib.h>
 
 GHashTable *geoclue_get_main_options (void);
+gboolean geoclue_get_warm_up_providers (void);
+gboolean geoclue_get_fuse_positions (void);
 
 #endif
@@ -28,8 +28,10 @@
  *  Provider object for GcMaster. Takes care of cacheing 
  *  queried data.
  * 
- *  Should probably start/stop the actual providers as needed
- *  in the future
+ *  Providers are started when the first client subscribes and
+ *  shut down once they have been without clients for LingerTime
+ *  seconds (see the .provider file), so that quick resubscribes
+ *  do not pay the startup cost again.
  *  
  *  Cache could also be used to save "stale" data for situations when 
  *  current data is not available (MasterClient api would have to 
@@ -39,8 +41,6 @@
  * 	figure out what to do if get_* returns GEOCLUE_ERROR_NOT_AVAILABLE.
  * 	Should try again, but when?
  * 
- * 	implement velocity
- * 
  * 	implement other (non-updating) ifaces
  **/
 
@@ -50,6 +50,7 @@
 #include "master-provider.h"
 #include <geoclue/geoclue-position.h>
 #include <geoclue/geoclue-address.h>
+#include <geoclue/geoclue-velocity.h>
 #include <geoclue/geoclue-marshal.h>
 
 typedef enum _GeoclueProvideFlags {
@@ -58,6 +59,19 @@ typedef enum _GeoclueProvideFlags {
 	GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION = 1 << 1,	/* data can be queried on new connection, and cached until connection ends */
 } GeoclueProvideFlags;
 
+/* Providers are started asynchronously: STARTING lasts from creating the
+ * proxies until the provider has answered SetOptions, GetProviderInfo 
+ * and GetStatus. The provider is "running" in both states. */
+typedef enum _GcMasterProviderState {
+	GC_MASTER_PROVIDER_STOPPED,
+	GC_MASTER_PROVIDER_STARTING,
+	GC_MASTER_PROVIDER_READY,
+} GcMasterProviderState;
+
+/* seconds to keep an unused provider running, unless the
+ * .provider file sets LingerTime */
+#define DEFAULT_LINGER_TIME 30
+
 typedef struct _GcPositionCache {
 	int timestamp;
 	GeocluePositionFields fields;
@@ -68,9 +82,23 @@ typedef struct _GcPositionCache {
 	GError *error;
 } GcPositionCache;
 
+/* velocity comes from the same fixes as the position,
+ * so position_cache.accuracy is used for it */
+typedef struct _GcVelocityCache {
+	int timestamp;
+	GeoclueVelocityFields fields;
+	double speed;
+	double direction;
+	double climb;
+	GError *error;
+} GcVelocityCache;
+
+/* details is kept in the compact form and shared by reference with 
+ * the clients. Its GHashTable for D-Bus is built once per update, 
+ * on the first emit or GetAddress */
 typedef struct _GcAddressCache {
 	int timestamp;
-	GHashTable *details;
+	GeoclueAddressDetails *details;
 	GeoclueAccuracy *accuracy;
 	GError *error;
 } GcAddressCache;
@@ -85,6 +113,7 @@ typedef struct _GcMasterProviderPrivate {
 	
 	GList *position_clients; /* list of clients currently using this provider */
 	GList *address_clients;
+	GList *velocity_clients;
 	
 	GeoclueAccuracyLevel expected_accuracy;
 	
@@ -95,6 +124,11 @@ typedef struct _GcMasterProviderPrivate {
 	GeoclueNetworkStatus net_status;
 	
 	GeoclueStatus status; /* cached status from actual provider */
+	GcMasterProviderState state;
+	int pending_updates; /* cache update calls in flight */
+	
+	GcMasterProviderWarmUpFunc warm_up_func;
+	gpointer warm_up_data;
 	
 	GeocluePosition *position;
 	GcPositionCache position_cache;
@@ -102,6 +136,13 @@ typedef struct _GcMasterProviderPrivate {
 	GeoclueAddress *address;
 	GcAddressCache address_cache;
 	
+	GeoclueVelocity *velocity;
+	GcVelocityCache velocity_cache;
+	guint fix_changed_id;
+	
+	int linger_time; /* seconds, negative means never shut down */
+	guint linger_id;
+	guint update_cache_id;
 } GcMasterProviderPrivate;
 
 enum {
@@ -109,6 +150,8 @@ enum {
 	ACCURACY_CHANGED,
 	POSITION_CHANGED,
 	ADDRESS_CHANGED,
+	VELOCITY_CHANGED,
+	FIX_CHANGED,
 	LAST_SIGNAL
 };
 static guint32 signals[LAST_SIGNAL] = {0, };
@@ -153,6 +196,9 @@ gc_master_provider_get_provider (GcMasterProvider *master_provider)
 	if (priv->position) {
 		return GEOCLUE_PROVIDER (priv->position);
 	}
+	if (priv->velocity) {
+		return GEOCLUE_PROVIDER (priv->velocity);
+	}
 	return NULL;
 }
 
@@ -181,8 +227,10 @@ gc_master_provider_handle_new_position_accuracy (GcMasterProvider *provider,
 	                              new_level, new_hor_acc, new_vert_acc);
 	
 	if (old_level != new_level) {
+		/* velocity uses the position accuracy */
 		g_signal_emit (provider, signals[ACCURACY_CHANGED], 0,
-		               GC_IFACE_POSITION, new_level);
+		               GC_IFACE_POSITION | (priv->interfaces & GC_IFACE_VELOCITY),
+		               new_level);
 	}
 }
 
@@ -210,6 +258,33 @@ gc_master_provider_handle_new_address_accuracy (GcMasterProvider *provider,
 	}
 }
 
+static gboolean
+emit_fix_changed (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->fix_changed_id = 0;
+	g_signal_emit (provider, signals[FIX_CHANGED], 0);
+	return FALSE;
+}
+
+/* Providers with both position and velocity send them separately:
+ * changes that arrive together are announced as one "fix-changed" */
+static void
+gc_master_provider_queue_fix_changed (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if ((priv->interfaces & (GC_IFACE_POSITION | GC_IFACE_VELOCITY)) !=
+	    (GC_IFACE_POSITION | GC_IFACE_VELOCITY)) {
+		return;
+	}
+	if (priv->fix_changed_id == 0) {
+		priv->fix_changed_id = g_idle_add ((GSourceFunc)emit_fix_changed,
+		                                   provider);
+	}
+}
+
 static void
 gc_master_provider_set_position (GcMasterProvider      *provider,
                                  GeocluePositionFields  fields,
@@ -239,6 +314,34 @@ gc_master_provider_set_position (GcMasterProvider      *provider,
 		               fields, timestamp, 
 		               latitude, longitude, altitude, 
 		               priv->position_cache.accuracy);
+		gc_master_provider_queue_fix_changed (provider);
+	}
+}
+
+static void
+gc_master_provider_set_velocity (GcMasterProvider      *provider,
+                                 GeoclueVelocityFields  fields,
+                                 int                    timestamp,
+                                 double                 speed,
+                                 double                 direction,
+                                 double                 climb,
+                                 GError                *error)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->velocity_cache.timestamp = timestamp;
+	priv->velocity_cache.fields = fields;
+	priv->velocity_cache.speed = speed;
+	priv->velocity_cache.direction = direction;
+	priv->velocity_cache.climb = climb;
+	
+	copy_error (&priv->velocity_cache.error, error);
+	
+	if (!error) {
+		g_signal_emit (provider, signals[VELOCITY_CHANGED], 0, 
+		               fields, timestamp, 
+		               speed, direction, climb);
+		gc_master_provider_queue_fix_changed (provider);
 	}
 }
 
@@ -253,12 +356,8 @@ gc_master_provider_set_address (GcMasterProvider *provider,
 	
 	priv->address_cache.timestamp = timestamp;
 	
-	g_hash_table_destroy (priv->address_cache.details);
-	if (details) {
-		priv->address_cache.details = geoclue_address_details_copy (details);
-	}else {
-		priv->address_cache.details = geoclue_address_details_new ();
-	}
+	geoclue_address_details_unref (priv->address_cache.details);
+	priv->address_cache.details = geoclue_address_details_from_hash (details);
 	copy_error (&priv->address_cache.error, error);
 	
 	/* emit accuracy-changed if needed, so masterclient can re-choose providers 
@@ -322,6 +421,8 @@ parse_interface_strings (char **strs)
 			ifaces |= GC_IFACE_POSITION;
 		} else if (strcmp (strs[i], GEOCLUE_ADDRESS_INTERFACE_NAME) == 0) {
 			ifaces |= GC_IFACE_ADDRESS;
+		} else if (strcmp (strs[i], GEOCLUE_VELOCITY_INTERFACE_NAME) == 0) {
+			ifaces |= GC_IFACE_VELOCITY;
 		}
 	}
 	return ifaces;
@@ -413,35 +514,37 @@ gc_master_provider_handle_status_change (GcMasterProvider *provider)
 }
 
 
-static void 
-gc_master_provider_update_cache (GcMasterProvider *master_provider)
+static void gc_master_provider_deinitialize (GcMasterProvider *provider);
+
+static void
+gc_master_provider_cache_updated (GcMasterProvider *master_provider)
 {
-	GcMasterProviderPrivate *priv;
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
 	
-	priv = GET_PRIVATE (master_provider);
+	gc_master_provider_handle_status_change (master_provider);
 	
-	if ((!(priv->provides & GEOCLUE_PROVIDE_UPDATES)) ||
-	    (!gc_master_provider_get_provider (master_provider))) {
-		/* non-cacheable provider or provider not running */
-		return;
+	/* connection-cacheable providers are only started to fill the cache */
+	if (priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION) {
+		gc_master_provider_deinitialize (master_provider);
 	}
+}
+
+static void
+update_position_cache_callback (GeocluePosition       *position,
+                                GeocluePositionFields  fields,
+                                int                    timestamp,
+                                double                 lat,
+                                double                 lon,
+                                double                 alt,
+                                GeoclueAccuracy       *accuracy,
+                                GError                *error,
+                                gpointer               userdata)
+{
+	GcMasterProvider *master_provider = userdata;
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
 	
-	g_debug ("%s: Updating cache ", priv->name);
-	priv->master_status = GEOCLUE_STATUS_ACQUIRING;
-	g_signal_emit (master_provider, signals[STATUS_CHANGED], 0, priv->master_status);
-	
-	if (priv->position) {
-		int timestamp;
-		double lat, lon, alt;
-		GeocluePositionFields fields;
-		GeoclueAccuracy *accuracy = NULL;
-		GError *error = NULL;
-		
-		fields = geoclue_position_get_position (priv->position,
-							&timestamp,
-							&lat, &lon, &alt,
-							&accuracy, 
-							&error);
+	/* ignore replies for a provider that has been deinitialized since */
+	if (position == priv->position) {
 		if (error){
 			g_warning ("Error updating position cache: %s", error->message);
 			gc_master_provider_handle_error (master_provider, error);
@@ -450,19 +553,32 @@ gc_master_provider_update_cache (GcMasterProvider *master_provider)
 		                                 fields, timestamp,
 		                                 lat, lon, alt,
 		                                 accuracy, error);
+		if (--priv->pending_updates == 0) {
+			gc_master_provider_cache_updated (master_provider);
+		}
 	}
 	
-	if (priv->address) {
-		int timestamp;
-		GHashTable *details = NULL;
-		GeoclueAccuracy *accuracy = NULL;
-		GError *error = NULL;
-		
-		if (!geoclue_address_get_address (priv->address,
-		                                  &timestamp,
-		                                  &details,
-		                                  &accuracy,
-		                                  &error)) {
+	if (accuracy) {
+		geoclue_accuracy_free (accuracy);
+	}
+	if (error) {
+		g_error_free (error);
+	}
+}
+
+static void
+update_address_cache_callback (GeoclueAddress  *address,
+                               int              timestamp,
+                               GHashTable      *details,
+                               GeoclueAccuracy *accuracy,
+                               GError          *error,
+                               gpointer         userdata)
+{
+	GcMasterProvider *master_provider = userdata;
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	
+	if (address == priv->address) {
+		if (error) {
 			g_warning ("Error updating address cache: %s", error->message);
 			gc_master_provider_handle_error (master_provider, error);
 		}
@@ -471,9 +587,97 @@ gc_master_provider_update_cache (GcMasterProvider *master_provider)
 		                                details,
 		                                accuracy,
 		                                error);
+		if (--priv->pending_updates == 0) {
+			gc_master_provider_cache_updated (master_provider);
+		}
 	}
 	
-	gc_master_provider_handle_status_change (master_provider);
+	if (details) {
+		g_hash_table_destroy (details);
+	}
+	if (accuracy) {
+		geoclue_accuracy_free (accuracy);
+	}
+	if (error) {
+		g_error_free (error);
+	}
+}
+
+static void
+update_velocity_cache_callback (GeoclueVelocity       *velocity,
+                                GeoclueVelocityFields  fields,
+                                int                    timestamp,
+                                double                 speed,
+                                double                 direction,
+                                double                 climb,
+                                GError                *error,
+                                gpointer               userdata)
+{
+	GcMasterProvider *master_provider = userdata;
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	
+	if (velocity == priv->velocity) {
+		if (error) {
+			g_warning ("Error updating velocity cache: %s", error->message);
+			gc_master_provider_handle_error (master_provider, error);
+		}
+		gc_master_provider_set_velocity (master_provider,
+		                                 fields, timestamp,
+		                                 speed, direction, climb,
+		                                 error);
+		if (--priv->pending_updates == 0) {
+			gc_master_provider_cache_updated (master_provider);
+		}
+	}
+	
+	if (error) {
+		g_error_free (error);
+	}
+}
+
+static void 
+gc_master_provider_update_cache (GcMasterProvider *master_provider)
+{
+	GcMasterProviderPrivate *priv;
+	
+	priv = GET_PRIVATE (master_provider);
+	
+	if ((!(priv->provides & GEOCLUE_PROVIDE_UPDATES)) ||
+	    (!gc_master_provider_get_provider (master_provider))) {
+		/* non-cacheable provider or provider not running */
+		gc_master_provider_handle_status_change (master_provider);
+		return;
+	}
+	
+	if (priv->pending_updates > 0) {
+		/* already updating */
+		return;
+	}
+	
+	g_debug ("%s: Updating cache ", priv->name);
+	priv->master_status = GEOCLUE_STATUS_ACQUIRING;
+	g_signal_emit (master_provider, signals[STATUS_CHANGED], 0, priv->master_status);
+	
+	if (priv->position) {
+		priv->pending_updates++;
+		geoclue_position_get_position_async (priv->position,
+		                                     update_position_cache_callback,
+		                                     master_provider);
+	}
+	
+	if (priv->address) {
+		priv->pending_updates++;
+		geoclue_address_get_address_async (priv->address,
+		                                   update_address_cache_callback,
+		                                   master_provider);
+	}
+	
+	if (priv->velocity) {
+		priv->pending_updates++;
+		geoclue_velocity_get_velocity_async (priv->velocity,
+		                                     update_velocity_cache_callback,
+		                                     master_provider);
+	}
 }
 
 /* signal handlers for the actual providers signals */
@@ -507,6 +711,21 @@ position_changed (GeocluePosition      *position,
 	                                 accuracy, NULL);
 }
 
+static void
+velocity_changed (GeoclueVelocity      *velocity,
+                  GeoclueVelocityFields fields,
+                  int                   timestamp,
+                  double                speed,
+                  double                direction,
+                  double                climb,
+                  GcMasterProvider     *provider)
+{
+	gc_master_provider_set_velocity (provider,
+	                                 fields, timestamp,
+	                                 speed, direction, climb,
+	                                 NULL);
+}
+
 static void
 address_changed (GeoclueAddress   *address,
                  int               timestamp,
@@ -537,6 +756,9 @@ finalize (GObject *object)
 	if (priv->address_cache.error) {
 		g_error_free (priv->address_cache.error);
 	}
+	if (priv->velocity_cache.error) {
+		g_error_free (priv->velocity_cache.error);
+	}
 	
 	g_free (priv->name);
 	g_free (priv->description);
@@ -545,6 +767,7 @@ finalize (GObject *object)
 	
 	g_free (priv->position_clients);
 	g_free (priv->address_clients);
+	g_free (priv->velocity_clients);
 	
 	G_OBJECT_CLASS (gc_master_provider_parent_class)->finalize (object);
 }
@@ -554,17 +777,26 @@ dispose (GObject *object)
 {
 	GcMasterProviderPrivate *priv = GET_PRIVATE (object);
 	
-	if (priv->position) {
-		g_object_unref (priv->position);
-		priv->position = NULL;
+	if (priv->linger_id) {
+		g_source_remove (priv->linger_id);
+		priv->linger_id = 0;
+	}
+	if (priv->update_cache_id) {
+		g_source_remove (priv->update_cache_id);
+		priv->update_cache_id = 0;
+	}
+	if (priv->fix_changed_id) {
+		g_source_remove (priv->fix_changed_id);
+		priv->fix_changed_id = 0;
 	}
 	
-	if (priv->address) {
-		g_object_unref (priv->address);
-		priv->address = NULL;
+	/* also ends a warm-up in progress */
+	if (gc_master_provider_is_running (GC_MASTER_PROVIDER (object))) {
+		gc_master_provider_deinitialize (GC_MASTER_PROVIDER (object));
 	}
+	
 	if (priv->address_cache.details) {
-		g_hash_table_destroy (priv->address_cache.details);
+		geoclue_address_details_unref (priv->address_cache.details);
 		priv->address_cache.details = NULL;
 	}
 	
@@ -621,6 +853,26 @@ gc_master_provider_class_init (GcMasterProviderClass *klass)
 						 G_TYPE_INT, 
 						 G_TYPE_POINTER,
 						 G_TYPE_POINTER);
+	signals[VELOCITY_CHANGED] = g_signal_new ("velocity-changed",
+						  G_TYPE_FROM_CLASS (klass),
+						  G_SIGNAL_RUN_FIRST |
+						  G_SIGNAL_NO_RECURSE,
+						  G_STRUCT_OFFSET (GcMasterProviderClass, velocity_changed), 
+						  NULL, NULL,
+						  geoclue_marshal_VOID__INT_INT_DOUBLE_DOUBLE_DOUBLE,
+						  G_TYPE_NONE, 5,
+						  G_TYPE_INT, G_TYPE_INT,
+						  G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE);
+	/* position and/or velocity changed, emitted once per main loop 
+	 * iteration by providers that have both */
+	signals[FIX_CHANGED] = g_signal_new ("fix-changed",
+					     G_TYPE_FROM_CLASS (klass),
+					     G_SIGNAL_RUN_FIRST |
+					     G_SIGNAL_NO_RECURSE,
+					     G_STRUCT_OFFSET (GcMasterProviderClass, fix_changed), 
+					     NULL, NULL,
+					     g_cclosure_marshal_VOID__VOID,
+					     G_TYPE_NONE, 0);
 }
 
 static void
@@ -630,8 +882,13 @@ gc_master_provider_init (GcMasterProvider *provider)
 	
 	priv->position_clients = NULL;
 	priv->address_clients = NULL;
+	priv->velocity_clients = NULL;
 	
 	priv->master_status = GEOCLUE_STATUS_UNAVAILABLE;
+	priv->state = GC_MASTER_PROVIDER_STOPPED;
+	priv->pending_updates = 0;
+	priv->warm_up_func = NULL;
+	priv->warm_up_data = NULL;
 	
 	priv->position = NULL;
 	priv->position_cache.accuracy = 
@@ -641,8 +898,16 @@ gc_master_provider_init (GcMasterProvider *provider)
 	priv->address = NULL;
 	priv->address_cache.accuracy = 
 		geoclue_accuracy_new (GEOCLUE_ACCURACY_LEVEL_NONE, 0 ,0);
-	priv->address_cache.details = geoclue_address_details_new ();
+	priv->address_cache.details = geoclue_address_details_from_hash (NULL);
 	priv->address_cache.error = NULL;
+	
+	priv->velocity = NULL;
+	priv->velocity_cache.fields = GEOCLUE_VELOCITY_FIELDS_NONE;
+	priv->velocity_cache.error = NULL;
+	priv->fix_changed_id = 0;
+	
+	priv->linger_time = DEFAULT_LINGER_TIME;
+	priv->linger_id = 0;
 }
 
 #if DEBUG_INFO
@@ -705,7 +970,7 @@ gc_master_provider_dump_address (GcMasterProvider *provider)
 	}
 	g_print ("       Timestamp: %d\n", time);
 	g_hash_table_foreach (details, (GHFunc)dump_address_key_and_value, NULL);
-	
+	g_hash_table_unref (details);
 }
 
 static void
@@ -765,45 +1030,120 @@ gc_master_provider_dump_provider_details (GcMasterProvider *provider)
 		g_print ("   Interface - Address\n");
 		gc_master_provider_dump_address (provider);
 	}
+	if (priv->interfaces & GC_IFACE_VELOCITY) {
+		g_print ("   Interface - Velocity\n");
+	}
 }
 #endif
 
-static gboolean
-gc_master_provider_initialize_geoclue (GcMasterProvider *master_provider)
+static void
+gc_master_provider_initialize_failed (GcMasterProvider *master_provider,
+                                      const char       *what,
+                                      GError           *error)
 {
 	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
-	GeoclueProvider *geoclue;
-	GError *error = NULL;
 	
-	geoclue = gc_master_provider_get_provider (master_provider);
+	g_warning ("Error %s for %s: %s\n", what, priv->name, error->message);
 	
-	if (!geoclue_provider_set_options (geoclue,
-	                                   geoclue_get_main_options (),
-	                                   &error)) {
-		g_warning ("Error setting provider options: %s\n", error->message);
-		g_error_free (error);
-		return FALSE;
-	}
+	gc_master_provider_deinitialize (master_provider);
+	priv->status = GEOCLUE_STATUS_ERROR;
+	gc_master_provider_handle_status_change (master_provider);
+}
+
+static void
+get_status_callback (GeoclueProvider *geoclue,
+                     GeoclueStatus    status,
+                     GError          *error,
+                     gpointer         userdata)
+{
+	GcMasterProvider *master_provider = userdata;
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
 	
-	/* priv->name has been read from .provider-file earlier...
-	 * could ask the provider anyway, just to be consistent */
-	if (!geoclue_provider_get_provider_info (geoclue, NULL, 
-	                                         &priv->description, &error)) {
-		g_warning ("Error getting provider info: %s\n", error->message);
+	/* ignore replies for a provider that has been deinitialized since */
+	if (geoclue != gc_master_provider_get_provider (master_provider)) {
+		if (error) {
+			g_error_free (error);
+		}
+		return;
+	}
+	if (error) {
+		gc_master_provider_initialize_failed (master_provider,
+		                                      "getting provider status",
+		                                      error);
 		g_error_free (error);
-		return FALSE;
+		return;
 	}
 	
 	g_signal_connect (G_OBJECT (geoclue), "status-changed",
 			  G_CALLBACK (provider_status_changed), master_provider);
+	priv->status = status;
+	priv->state = GC_MASTER_PROVIDER_READY;
+	g_debug ("%s ready", priv->name);
+	
+	/* this will handle the status change */
+	gc_master_provider_update_cache (master_provider);
+#if DEBUG_INFO
+	gc_master_provider_dump_provider_details (master_provider);
+#endif
+}
+
+static void
+get_provider_info_callback (GeoclueProvider *geoclue,
+                            char            *name,
+                            char            *description,
+                            GError          *error,
+                            gpointer         userdata)
+{
+	GcMasterProvider *master_provider = userdata;
+	GcMasterProviderPrivate *priv = GET_PRIVATE (master_provider);
+	
+	if (geoclue != gc_master_provider_get_provider (master_provider)) {
+		/* fall through to free the reply */
+	} else if (error) {
+		gc_master_provider_initialize_failed (master_provider,
+		                                      "getting provider info",
+		                                      error);
+	} else {
+		/* priv->name has been read from .provider-file earlier...
+		 * could ask the provider anyway, just to be consistent */
+		g_free (priv->description);
+		priv->description = description;
+		description = NULL;
+		
+		geoclue_provider_get_status_async (geoclue,
+		                                   get_status_callback,
+		                                   master_provider);
+	}
 	
+	g_free (name);
+	g_free (description);
+	if (error) {
+		g_error_free (error);
+	}
+}
+
+static void
+set_options_callback (GeoclueProvider *geoclue,
+                      GError          *error,
+                      gpointer         userdata)
+{
+	GcMasterProvider *master_provider = userdata;
+	
+	if (geoclue != gc_master_provider_get_provider (master_provider)) {
+		/* fall through to free the reply */
+	} else if (error) {
+		gc_master_provider_initialize_failed (master_provider,
+		                                      "setting provider options",
+		                                      error);
+	} else {
+		geoclue_provider_get_provider_info_async (geoclue,
+		                                          get_provider_info_callback,
+		                                          master_provider);
+	}
 	
-	if (!geoclue_provider_get_status (geoclue, &priv->status, &error)) {
-		g_warning ("Error getting provider status: %s\n", error->message);
+	if (error) {
 		g_error_free (error);
-		return FALSE;
 	}
-	return TRUE;
 }
 
 static gboolean
@@ -834,26 +1174,42 @@ gc_master_provider_initialize_interfaces (GcMasterProvider *provider)
 		g_signal_connect (G_OBJECT (priv->address), "address-changed",
 		                  G_CALLBACK (address_changed), provider);
 	}
-	
-	if (!gc_master_provider_initialize_geoclue (provider)) {
-		return FALSE;
+	if (priv->interfaces & GC_IFACE_VELOCITY) {
+		g_assert (priv->velocity == NULL);
+		
+		priv->velocity = geoclue_velocity_new (priv->service, 
+		                                       priv->path);
+		g_signal_connect (G_OBJECT (priv->velocity), "velocity-changed",
+		                  G_CALLBACK (velocity_changed), provider);
 	}
 	
 	return TRUE;
 }
 
-
+/* Starts the provider. Returns TRUE if the startup was begun: the provider
+ * will be ACQUIRING until it has answered, and then report its real 
+ * status through status-changed. None of this blocks the main loop, 
+ * even if D-Bus needs to activate the provider binary. */
 static gboolean
 gc_master_provider_initialize (GcMasterProvider *provider)
 {
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (priv->state != GC_MASTER_PROVIDER_STOPPED) {
+		return FALSE;
+	}
 	if (!gc_master_provider_initialize_interfaces (provider)) {
 		return FALSE;
 	}
 	
-	gc_master_provider_update_cache (provider);
-#if DEBUG_INFO
-	gc_master_provider_dump_provider_details (provider);
-#endif
+	priv->state = GC_MASTER_PROVIDER_STARTING;
+	priv->status = GEOCLUE_STATUS_ACQUIRING;
+	gc_master_provider_handle_status_change (provider);
+	
+	geoclue_provider_set_options_async (gc_master_provider_get_provider (provider),
+	                                    geoclue_get_main_options (),
+	                                    set_options_callback,
+	                                    provider);
 	return TRUE;
 }
 
@@ -861,6 +1217,11 @@ static void
 gc_master_provider_deinitialize (GcMasterProvider *provider)
 {
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	GcMasterProviderWarmUpFunc warm_up_func;
+	
+	/* any replies still in flight are ignored from now on */
+	priv->state = GC_MASTER_PROVIDER_STOPPED;
+	priv->pending_updates = 0;
 	
 	if (priv->position) {
 		g_object_unref (priv->position);
@@ -870,7 +1231,19 @@ gc_master_provider_deinitialize (GcMasterProvider *provider)
 		g_object_unref (priv->address);
 		priv->address = NULL;
 	}
+	if (priv->velocity) {
+		g_object_unref (priv->velocity);
+		priv->velocity = NULL;
+	}
 	g_debug ("deinited %s", priv->name);
+	
+	/* a warm-up ends when the cache is filled or starting failed,
+	 * either way the provider is deinitialized */
+	warm_up_func = priv->warm_up_func;
+	if (warm_up_func) {
+		priv->warm_up_func = NULL;
+		warm_up_func (provider, priv->warm_up_data);
+	}
 }
 
 static void
@@ -886,26 +1259,41 @@ network_status_changed (gpointer *connectivity,
 	/* update connection-cacheable providers */
 	if (status == GEOCLUE_CONNECTIVITY_ONLINE &&
 	    priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION) {
-		/* intialize to fill cache (this will handle status change) */
-		if (gc_master_provider_initialize (provider)) {
-			gc_master_provider_deinitialize (provider);
-		}
+		/* intialize to fill cache (this will handle status change),
+		 * provider is deinitialized again once the cache is filled */
+		gc_master_provider_initialize (provider);
 	} else {
 		gc_master_provider_handle_status_change (provider);
 	}
 }
 
-/* for updating cache on providers that are not running */
 static gboolean
-update_cache_and_deinit (GcMasterProvider *provider)
+linger_timeout (GcMasterProvider *provider)
 {
-	/* fill cache */
-	if (gc_master_provider_initialize (provider)) {
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->linger_id = 0;
+	if (!priv->position_clients && !priv->address_clients &&
+	    !priv->velocity_clients &&
+	    gc_master_provider_is_running (provider)) {
 		gc_master_provider_deinitialize (provider);
 	}
 	return FALSE;
 }
 
+/* for updating cache on providers that are not running */
+static gboolean
+update_cache_and_deinit (GcMasterProvider *provider)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	priv->update_cache_id = 0;
+	
+	/* fill cache, deinitialized once that is done */
+	gc_master_provider_initialize (provider);
+	return FALSE;
+}
+
 
 /* public methods (for GcMaster and GcMasterClient) */
 
@@ -1006,10 +1394,28 @@ gc_master_provider_new (const char *filename,
 		g_strfreev (interfaces);
 	}
 	
+	if (g_key_file_has_key (keyfile, "Geoclue Provider",
+	                        "LingerTime", NULL)) {
+		priv->linger_time = g_key_file_get_integer (keyfile,
+		                                            "Geoclue Provider",
+		                                            "LingerTime",
+		                                            &error);
+		if (error) {
+			g_warning ("Invalid LingerTime in %s: %s",
+			           filename, error->message);
+			g_clear_error (&error);
+			priv->linger_time = DEFAULT_LINGER_TIME;
+		}
+	}
+	g_key_file_free (keyfile);
+	
 	if (priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION &&
-	    priv->net_status == GEOCLUE_CONNECTIVITY_ONLINE) {
-		/* do this as idle so we can return without waiting for http queries */
-		g_idle_add ((GSourceFunc)update_cache_and_deinit, provider);
+	    priv->net_status == GEOCLUE_CONNECTIVITY_ONLINE &&
+	    !geoclue_get_warm_up_providers ()) {
+		/* do this as idle so we can return without waiting for http queries.
+		 * With warm-up enabled GcMaster does this for all providers */
+		priv->update_cache_id =
+			g_idle_add ((GSourceFunc)update_cache_and_deinit, provider);
 	}
 	return provider;
 }
@@ -1027,6 +1433,12 @@ gc_master_provider_subscribe (GcMasterProvider *provider,
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
 	gboolean started = FALSE;
 	
+	/* a client came back before the provider was shut down */
+	if (priv->linger_id) {
+		g_source_remove (priv->linger_id);
+		priv->linger_id = 0;
+	}
+	
 	/* decide wether to run initialize or not */
 	if (!gc_master_provider_is_running (provider)) {
 		if (!(priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION)) {
@@ -1045,10 +1457,47 @@ gc_master_provider_subscribe (GcMasterProvider *provider,
 			priv->address_clients = g_list_prepend (priv->address_clients, client);
 		}
 	}
+	if (interface & GC_IFACE_VELOCITY) {
+		if (!g_list_find (priv->velocity_clients, client)) {
+			priv->velocity_clients = g_list_prepend (priv->velocity_clients, client);
+		}
+	}
 	
 	return started;
 }
 
+/**
+ * gc_master_provider_warm_up:
+ * @provider: a #GcMasterProvider
+ * @func: function to call once the warm-up has finished, or %NULL
+ * @user_data: data for @func
+ *
+ * Starts a connection-cacheable provider just to fill its cache. 
+ * Returns TRUE if the provider was started: @func will be called once 
+ * the cache has been filled (or starting failed) and the provider was 
+ * shut down again. Returns FALSE if there was nothing to do (provider
+ * is not cacheable, already running or network is not available).
+ */
+gboolean
+gc_master_provider_warm_up (GcMasterProvider           *provider,
+                            GcMasterProviderWarmUpFunc  func,
+                            gpointer                    user_data)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (!(priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION) ||
+	    priv->net_status != GEOCLUE_CONNECTIVITY_ONLINE) {
+		return FALSE;
+	}
+	if (!gc_master_provider_initialize (provider)) {
+		return FALSE;
+	}
+	
+	priv->warm_up_func = func;
+	priv->warm_up_data = user_data;
+	return TRUE;
+}
+
 /* client calls this when it does not intend to use the provider */
 void
 gc_master_provider_unsubscribe (GcMasterProvider *provider,
@@ -1063,18 +1512,52 @@ gc_master_provider_unsubscribe (GcMasterProvider *provider,
 	if (interface & GC_IFACE_ADDRESS) {
 		priv->address_clients = g_list_remove (priv->address_clients, client);
 	}
+	if (interface & GC_IFACE_VELOCITY) {
+		priv->velocity_clients = g_list_remove (priv->velocity_clients, client);
+	}
 	
 	if (!priv->position_clients &&
-	    !priv->address_clients) {
-		/* no one is using this provider, shutdown... */
+	    !priv->address_clients &&
+	    !priv->velocity_clients) {
+		/* no one is using this provider, shutdown after a while
+		 * unless a client shows up again */
 		/* not clearing cached accuracies on purpose */
 		g_debug ("%s without clients", priv->name);
 		
-		/* gc_master_provider_deinitialize (provider); */
+		if (priv->linger_id ||
+		    priv->linger_time < 0 ||
+		    !gc_master_provider_is_running (provider)) {
+			return;
+		}
+		if (priv->linger_time == 0) {
+			gc_master_provider_deinitialize (provider);
+		} else {
+			priv->linger_id = g_timeout_add_seconds (priv->linger_time,
+			                                         (GSourceFunc)linger_timeout,
+			                                         provider);
+		}
 	}
 }
 
 
+/* The gc_master_provider_get_* () functions return the cache and never
+ * block. Providers that do not provide updates have no cache: use the 
+ * _async versions to query them */
+static gboolean
+gc_master_provider_check_cached (GcMasterProvider *provider,
+                                 GError          **error)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (!(priv->provides & GEOCLUE_PROVIDE_UPDATES)) {
+		g_set_error (error, GEOCLUE_ERROR, GEOCLUE_ERROR_NOT_AVAILABLE,
+		             "%s does not provide updates, nothing is cached",
+		             priv->name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 GeocluePositionFields
 gc_master_provider_get_position (GcMasterProvider *provider,
                                  int              *timestamp,
@@ -1089,38 +1572,33 @@ gc_master_provider_get_position (GcMasterProvider *provider,
 	g_assert (priv->position || 
 	          priv->provides & GEOCLUE_PROVIDE_CACHEABLE_ON_CONNECTION);
 	
-	if (priv->provides & GEOCLUE_PROVIDE_UPDATES) {
-		if (timestamp != NULL) {
-			*timestamp = priv->position_cache.timestamp;
-		}
-		if (latitude != NULL) {
-			*latitude = priv->position_cache.latitude;
-		}
-		if (longitude != NULL) {
-			*longitude = priv->position_cache.longitude;
-		}
-		if (altitude != NULL) {
-			*altitude = priv->position_cache.altitude;
-		}
-		if (accuracy != NULL) {
-			*accuracy = geoclue_accuracy_copy (priv->position_cache.accuracy);
-		}
-		if (error != NULL) {
-			g_assert (!*error);
-			copy_error (error, priv->position_cache.error);
-		}
-		return priv->position_cache.fields;
-	} else {
-		return geoclue_position_get_position (priv->position,
-		                                      timestamp,
-		                                      latitude, 
-		                                      longitude, 
-		                                      altitude,
-		                                      accuracy, 
-		                                      error);
+	if (!gc_master_provider_check_cached (provider, error)) {
+		return GEOCLUE_POSITION_FIELDS_NONE;
+	}
+	
+	if (timestamp != NULL) {
+		*timestamp = priv->position_cache.timestamp;
+	}
+	if (latitude != NULL) {
+		*latitude = priv->position_cache.latitude;
+	}
+	if (longitude != NULL) {
+		*longitude = priv->position_cache.longitude;
+	}
+	if (altitude != NULL) {
+		*altitude = priv->position_cache.altitude;
 	}
+	if (accuracy != NULL) {
+		*accuracy = geoclue_accuracy_copy (priv->position_cache.accuracy);
+	}
+	if (error != NULL) {
+		g_assert (!*error);
+		copy_error (error, priv->position_cache.error);
+	}
+	return priv->position_cache.fields;
 }
 
+/* details must be released with g_hash_table_unref () */
 gboolean 
 gc_master_provider_get_address (GcMasterProvider  *provider,
                                 int               *timestamp,
@@ -1129,30 +1607,246 @@ gc_master_provider_get_address (GcMasterProvider  *provider,
                                 GError           **error)
 {
 	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (!gc_master_provider_check_cached (provider, error)) {
+		return FALSE;
+	}
+	
+	if (timestamp != NULL) {
+		*timestamp = priv->address_cache.timestamp;
+	}
+	if (details != NULL) {
+		*details = g_hash_table_ref 
+			(geoclue_address_details_get_hash (priv->address_cache.details));
+	}
+	if (accuracy != NULL) {
+		*accuracy = geoclue_accuracy_copy (priv->address_cache.accuracy);
+	}
+	if (error != NULL) {
+		g_assert (!*error);
+		copy_error (error, priv->address_cache.error);
+	}
+	return (!priv->address_cache.error);
+}
+
+GeoclueVelocityFields
+gc_master_provider_get_velocity (GcMasterProvider *provider,
+                                 int              *timestamp,
+                                 double           *speed,
+                                 double           *direction,
+                                 double           *climb,
+                                 GError          **error)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	
+	if (!gc_master_provider_check_cached (provider, error)) {
+		return GEOCLUE_VELOCITY_FIELDS_NONE;
+	}
+	
+	if (timestamp != NULL) {
+		*timestamp = priv->velocity_cache.timestamp;
+	}
+	if (speed != NULL) {
+		*speed = priv->velocity_cache.speed;
+	}
+	if (direction != NULL) {
+		*direction = priv->velocity_cache.direction;
+	}
+	if (climb != NULL) {
+		*climb = priv->velocity_cache.climb;
+	}
+	if (error != NULL) {
+		g_assert (!*error);
+		copy_error (error, priv->velocity_cache.error);
+	}
+	return priv->velocity_cache.fields;
+}
+
+typedef struct _GcMasterProviderAsyncData {
+	GcMasterProvider *provider;
+	GCallback callback;
+	gpointer userdata;
+} GcMasterProviderAsyncData;
+
+static GcMasterProviderAsyncData *
+async_data_new (GcMasterProvider *provider,
+                GCallback         callback,
+                gpointer          userdata)
+{
+	GcMasterProviderAsyncData *data;
+	
+	data = g_new (GcMasterProviderAsyncData, 1);
+	data->provider = g_object_ref (provider);
+	data->callback = callback;
+	data->userdata = userdata;
+	return data;
+}
+
+static void
+async_data_free (GcMasterProviderAsyncData *data)
+{
+	g_object_unref (data->provider);
+	g_free (data);
+}
+
+static void
+get_position_async_callback (GeocluePosition       *position,
+                             GeocluePositionFields  fields,
+                             int                    timestamp,
+                             double                 latitude,
+                             double                 longitude,
+                             double                 altitude,
+                             GeoclueAccuracy       *accuracy,
+                             GError                *error,
+                             gpointer               userdata)
+{
+	GcMasterProviderAsyncData *data = userdata;
+	
+	(*(GcMasterProviderPositionCallback)data->callback) (data->provider,
+	                                                     fields,
+	                                                     timestamp,
+	                                                     latitude,
+	                                                     longitude,
+	                                                     altitude,
+	                                                     accuracy,
+	                                                     error,
+	                                                     data->userdata);
+	async_data_free (data);
+}
+
+/* Calls callback with the cached position, before returning if the
+ * provider provides updates. Otherwise the provider is queried without
+ * blocking the main loop */
+void
+gc_master_provider_get_position_async (GcMasterProvider                 *provider,
+                                       GcMasterProviderPositionCallback  callback,
+                                       gpointer                          userdata)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	GeocluePositionFields fields;
+	int timestamp;
+	double latitude, longitude, altitude;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+	
 	if (priv->provides & GEOCLUE_PROVIDE_UPDATES) {
-		
-		if (timestamp != NULL) {
-			*timestamp = priv->address_cache.timestamp;
-		}
-		if (details != NULL) {
-			*details = geoclue_address_details_copy (priv->address_cache.details);
-		}
-		if (accuracy != NULL) {
-			*accuracy = geoclue_accuracy_copy (priv->address_cache.accuracy);
-		}
-		if (error != NULL) {
-			g_assert (!*error);
-			copy_error (error, priv->address_cache.error);
-		}
-		return (!priv->address_cache.error);
-	} else {
-		g_assert (priv->address);
-		return geoclue_address_get_address (priv->address,
-		                                    timestamp,
-		                                    details, 
-		                                    accuracy, 
-		                                    error);
+		fields = gc_master_provider_get_position (provider,
+		                                          &timestamp,
+		                                          &latitude, &longitude,
+		                                          &altitude,
+		                                          &accuracy, &error);
+		callback (provider, fields, timestamp,
+		          latitude, longitude, altitude,
+		          accuracy, error, userdata);
+		return;
+	}
+	
+	g_assert (priv->position);
+	geoclue_position_get_position_async (priv->position,
+	                                     get_position_async_callback,
+	                                     async_data_new (provider,
+	                                                     G_CALLBACK (callback),
+	                                                     userdata));
+}
+
+static void
+get_address_async_callback (GeoclueAddress  *address,
+                            int              timestamp,
+                            GHashTable      *details,
+                            GeoclueAccuracy *accuracy,
+                            GError          *error,
+                            gpointer         userdata)
+{
+	GcMasterProviderAsyncData *data = userdata;
+	
+	(*(GcMasterProviderAddressCallback)data->callback) (data->provider,
+	                                                    timestamp,
+	                                                    details,
+	                                                    accuracy,
+	                                                    error,
+	                                                    data->userdata);
+	async_data_free (data);
+}
+
+/* see gc_master_provider_get_position_async () */
+void
+gc_master_provider_get_address_async (GcMasterProvider                *provider,
+                                      GcMasterProviderAddressCallback  callback,
+                                      gpointer                         userdata)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	int timestamp;
+	GHashTable *details = NULL;
+	GeoclueAccuracy *accuracy = NULL;
+	GError *error = NULL;
+	
+	if (priv->provides & GEOCLUE_PROVIDE_UPDATES) {
+		gc_master_provider_get_address (provider, &timestamp,
+		                                &details, &accuracy, &error);
+		callback (provider, timestamp, details, accuracy, error,
+		          userdata);
+		return;
 	}
+	
+	g_assert (priv->address);
+	geoclue_address_get_address_async (priv->address,
+	                                   get_address_async_callback,
+	                                   async_data_new (provider,
+	                                                   G_CALLBACK (callback),
+	                                                   userdata));
+}
+
+static void
+get_velocity_async_callback (GeoclueVelocity       *velocity,
+                             GeoclueVelocityFields  fields,
+                             int                    timestamp,
+                             double                 speed,
+                             double                 direction,
+                             double                 climb,
+                             GError                *error,
+                             gpointer               userdata)
+{
+	GcMasterProviderAsyncData *data = userdata;
+	
+	(*(GcMasterProviderVelocityCallback)data->callback) (data->provider,
+	                                                     fields,
+	                                                     timestamp,
+	                                                     speed,
+	                                                     direction,
+	                                                     climb,
+	                                                     error,
+	                                                     data->userdata);
+	async_data_free (data);
+}
+
+/* see gc_master_provider_get_position_async () */
+void
+gc_master_provider_get_velocity_async (GcMasterProvider                 *provider,
+                                       GcMasterProviderVelocityCallback  callback,
+                                       gpointer                          userdata)
+{
+	GcMasterProviderPrivate *priv = GET_PRIVATE (provider);
+	GeoclueVelocityFields fields;
+	int timestamp;
+	double speed, direction, climb;
+	GError *error = NULL;
+	
+	if (priv->provides & GEOCLUE_PROVIDE_UPDATES) {
+		fields = gc_master_provider_get_velocity (provider,
+		                                          &timestamp,
+		                                          &speed, &direction,
+		                                          &climb, &error);
+		callback (provider, fields, timestamp,
+		          speed, direction, climb, error, userdata);
+		return;
+	}
+	
+	g_assert (priv->velocity);
+	geoclue_velocity_get_velocity_async (priv->velocity,
+	                                     get_velocity_async_callback,
+	                                     async_data_new (provider,
+	                                                     G_CALLBACK (callback),
+	                                                     userdata));
 }
 
 gboolean
@@ -1184,22 +1878,6 @@ gc_master_provider_is_good (GcMasterProvider     *provider,
 	        ((priv->required_resources & (~allowed_resources)) == 0));
 }
 
-void
-gc_master_provider_update_options (GcMasterProvider *provider)
-{
-	GeoclueProvider *geoclue;
-	GError *error = NULL;
-	
-	geoclue = gc_master_provider_get_provider (provider);
-	
-	if (!geoclue_provider_set_options (geoclue,
-	                                   geoclue_get_main_options (),
-	                                   &error)) {
-		g_warning ("Error setting provider options: %s\n", error->message);
-		g_error_free (error);
-	}
-}
-
 GeoclueStatus 
 gc_master_provider_get_status (GcMasterProvider *provider)
 {
@@ -1216,6 +1894,7 @@ gc_master_provider_get_accuracy (GcMasterProvider *provider, GcInterfaceFlags if
 	
 	switch (iface) {
 		case GC_IFACE_POSITION:
+		case GC_IFACE_VELOCITY:
 			geoclue_accuracy_get_details (priv->position_cache.accuracy,
 			                              &acc_level, NULL, NULL);
 			break;
@@ -1276,6 +1955,7 @@ gc_master_provider_compare (GcMasterProvider *a,
 	/* get the current accuracylevels */
 	switch (iface_min_accuracy->interface) {
 		case GC_IFACE_POSITION:
+		case GC_IFACE_VELOCITY:
 			acc_a = priv_a->position_cache.accuracy;
 			acc_b = priv_b->position_cache.accuracy;
 			break;
@@ -29,6 +29,7 @@
 #include <geoclue/geoclue-provider.h>
 #include <geoclue/geoclue-types.h>
 #include <geoclue/geoclue-accuracy.h>
+#include <geoclue/geoclue-address-details.h>
 #include "connectivity.h"
 
 G_BEGIN_DECLS
@@ -69,14 +70,51 @@ typedef struct _GcMasterProviderClass {
 	                           double                longitude,
 	                           double                altitude,
 	                           GeoclueAccuracy      *accuracy);
-	void (* address_changed) (GcMasterProvider *master_provider,
-	                          int               timestamp,
-	                          GHashTable       *details,
-	                          GeoclueAccuracy  *accuracy);
+	void (* address_changed) (GcMasterProvider      *master_provider,
+	                          int                    timestamp,
+	                          GeoclueAddressDetails *details,
+	                          GeoclueAccuracy       *accuracy);
+	void (* velocity_changed) (GcMasterProvider     *master_provider,
+	                           GeoclueVelocityFields fields,
+	                           int                   timestamp,
+	                           double                speed,
+	                           double                direction,
+	                           double                climb);
+	void (* fix_changed) (GcMasterProvider *master_provider);
 } GcMasterProviderClass;
 
 GType gc_master_provider_get_type (void);
 
+typedef void (*GcMasterProviderWarmUpFunc) (GcMasterProvider *provider,
+                                            gpointer          user_data);
+
+/* Callbacks for the gc_master_provider_get_*_async () functions. Like 
+ * with the GeoclueProvider callbacks, the callback owns accuracy, 
+ * error and (to be released with g_hash_table_unref ()) details */
+typedef void (*GcMasterProviderPositionCallback) (GcMasterProvider     *provider,
+                                                  GeocluePositionFields fields,
+                                                  int                   timestamp,
+                                                  double                latitude,
+                                                  double                longitude,
+                                                  double                altitude,
+                                                  GeoclueAccuracy      *accuracy,
+                                                  GError               *error,
+                                                  gpointer              userdata);
+typedef void (*GcMasterProviderAddressCallback) (GcMasterProvider *provider,
+                                                 int               timestamp,
+                                                 GHashTable       *details,
+                                                 GeoclueAccuracy  *accuracy,
+                                                 GError           *error,
+                                                 gpointer          userdata);
+typedef void (*GcMasterProviderVelocityCallback) (GcMasterProvider     *provider,
+                                                  GeoclueVelocityFields fields,
+                                                  int                   timestamp,
+                                                  double                speed,
+                                                  double                direction,
+                                                  double                climb,
+                                                  GError               *error,
+                                                  gpointer              userdata);
+
 GcMasterProvider *gc_master_provider_new (const char *filename,
                                           GeoclueConnectivity *connectivity);
 
@@ -86,6 +124,9 @@ gboolean gc_master_provider_subscribe (GcMasterProvider *provider,
 void gc_master_provider_unsubscribe (GcMasterProvider *provider,
                                      gpointer          client,
                                      GcInterfaceFlags  interface);
+gboolean gc_master_provider_warm_up (GcMasterProvider           *provider,
+                                     GcMasterProviderWarmUpFunc  func,
+                                     gpointer                    user_data);
 
 /* for gc_master_provider_compare */
 typedef struct _GcInterfaceAccuracy {
@@ -105,7 +146,6 @@ gboolean gc_master_provider_is_good (GcMasterProvider     *provider,
 
 void gc_master_provider_network_status_changed (GcMasterProvider *provider,
                                                 GeoclueNetworkStatus status);
-void gc_master_provider_update_options (GcMasterProvider *provider);
 
 char* gc_master_provider_get_name (GcMasterProvider *provider);
 char* gc_master_provider_get_description (GcMasterProvider *provider);
@@ -129,6 +169,23 @@ gboolean gc_master_provider_get_address (GcMasterProvider  *master_provider,
                                          GeoclueAccuracy  **accuracy,
                                          GError           **error);
 
+GeoclueVelocityFields gc_master_provider_get_velocity (GcMasterProvider *master_provider,
+                                                       int              *timestamp,
+                                                       double           *speed,
+                                                       double           *direction,
+                                                       double           *climb,
+                                                       GError          **error);
+
+void gc_master_provider_get_position_async (GcMasterProvider                 *master_provider,
+                                            GcMasterProviderPositionCallback  callback,
+                                            gpointer                          userdata);
+void gc_master_provider_get_address_async (GcMasterProvider                *master_provider,
+                                           GcMasterProviderAddressCallback  callback,
+                                           gpointer                         userdata);
+void gc_master_provider_get_velocity_async (GcMasterProvider                 *master_provider,
+                                            GcMasterProviderVelocityCallback  callback,
+                                            gpointer                          userdata);
+
 
 G_END_DECLS
 
@@ -27,6 +27,8 @@
 
 #include <string.h>
 
+#include <gio/gio.h>
+
 #include "main.h"
 #include "master.h"
 #include "client.h"
@@ -54,32 +56,104 @@ static guint32 signals[LAST_SIGNAL] = {0, };
 G_DEFINE_TYPE (GcMaster, gc_master, G_TYPE_OBJECT);
 
 static GList *providers = NULL;
+/* .provider file basename -> GcMasterProvider in providers */
+static GHashTable *provider_files = NULL;
+static GFileMonitor *provider_monitor = NULL;
+
+/* requirements -> GcCandidates, see gc_master_get_candidates () */
+static GHashTable *candidates = NULL;
+
+/* GcMasterClients that are registered on the bus */
+static GList *clients = NULL;
+
+/* Startup cache warm-up: at most WARM_UP_MAX_PENDING providers are
+ * started at a time. Providers still filling their caches after 
+ * WARM_UP_DEADLINE seconds no longer count against that limit, so slow
+ * ones can't hold up the rest of the queue, which is then worked
+ * through with the same limit */
+#define WARM_UP_MAX_PENDING 4
+#define WARM_UP_DEADLINE 30
 
-static gboolean gc_iface_master_create (GcMaster    *master,
-					const char **object_path,
-					GError     **error);
+typedef struct _GcWarmUp {
+	GList *queue;
+	guint pending;
+	guint deadline_id;
+	guint round; /* incremented at the deadline */
+} GcWarmUp;
+
+static GcWarmUp *warm_up = NULL;
+
+static void gc_iface_master_create (GcMaster              *master,
+				    DBusGMethodInvocation *context);
 
 #include "gc-iface-master-glue.h"
 
-#define GEOCLUE_MASTER_PATH "/org/freedesktop/Geoclue/Master/client"
 static gboolean
-gc_iface_master_create (GcMaster    *master,
-			const char **object_path,
-			GError     **error)
+unref_client (gpointer data)
+{
+	g_object_unref (data);
+	return FALSE;
+}
+
+/* "released" handler: nobody is using the client anymore */
+static void
+client_released (GcMasterClient *client,
+		 GcMaster       *master)
+{
+	g_debug ("master: removing client");
+
+	clients = g_list_remove (clients, client);
+	dbus_g_connection_unregister_g_object (master->connection,
+					       G_OBJECT (client));
+
+	/* may be called from within a method call on the client */
+	g_idle_add (unref_client, client);
+}
+
+static void
+name_owner_changed (DBusGProxy *proxy,
+		    const char *name,
+		    const char *prev_owner,
+		    const char *new_owner,
+		    GcMaster   *master)
+{
+	GList *l, *copy;
+
+	/* only interested in peers leaving the bus */
+	if (strcmp (new_owner, "") != 0 || strcmp (name, prev_owner) != 0) {
+		return;
+	}
+
+	/* the list may change when clients are released */
+	copy = g_list_copy (clients);
+	for (l = copy; l; l = l->next) {
+		gc_master_client_remove_peer (l->data, name);
+	}
+	g_list_free (copy);
+}
+
+#define GEOCLUE_MASTER_PATH "/org/freedesktop/Geoclue/Master/client"
+static void
+gc_iface_master_create (GcMaster              *master,
+			DBusGMethodInvocation *context)
 {
 	static guint32 serial = 0;
 	GcMasterClient *client;
-	char *path;
+	char *path, *sender;
 
+	sender = dbus_g_method_get_sender (context);
 	path = g_strdup_printf ("%s%d", GEOCLUE_MASTER_PATH, serial++);
-	client = g_object_new (GC_TYPE_MASTER_CLIENT, NULL);
+	client = gc_master_client_new (sender);
+	g_free (sender);
+
+	g_signal_connect (client, "released",
+			  G_CALLBACK (client_released), master);
+	clients = g_list_prepend (clients, client);
 	dbus_g_connection_register_g_object (master->connection, path,
 					     G_OBJECT (client));
 	
-	if (object_path) {
-		*object_path = path;
-	}
-	return TRUE;
+	dbus_g_method_return (context, path);
+	g_free (path);
 }
 
 static void
@@ -99,8 +173,10 @@ gc_master_class_init (GcMasterClass *klass)
 						  G_TYPE_HASH_TABLE);
 }
 
+#define PROVIDER_EXTENSION ".provider"
+
 /* Load the provider details out of a keyfile */
-static void
+static GcMasterProvider *
 gc_master_add_new_provider (GcMaster   *master,
                             const char *filename)
 {
@@ -111,15 +187,120 @@ gc_master_add_new_provider (GcMaster   *master,
 	
 	if (!provider) {
 		g_warning ("Loading from %s failed", filename);
-		return;
+		return NULL;
 	}
 	
 	providers = g_list_prepend (providers, provider);
+	g_hash_table_insert (provider_files,
+	                     g_path_get_basename (filename),
+	                     provider);
+	return provider;
 }
 
-/* Scan a directory for .provider files */
-#define PROVIDER_EXTENSION ".provider"
+static void
+gc_master_remove_provider (GcMaster         *master,
+                           GcMasterProvider *provider)
+{
+	GHashTableIter iter;
+	gpointer c;
+	
+	providers = g_list_remove (providers, provider);
+	if (warm_up) {
+		warm_up->queue = g_list_remove (warm_up->queue, provider);
+	}
+	
+	/* requirement groups using the provider choose again */
+	g_hash_table_iter_init (&iter, candidates);
+	while (g_hash_table_iter_next (&iter, NULL, &c)) {
+		gc_candidates_remove (c, provider);
+	}
+	
+	if (master->connectivity) {
+		g_signal_handlers_disconnect_matched (master->connectivity,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0, 0, NULL, NULL,
+		                                      provider);
+	}
+	g_object_unref (provider);
+}
+
+/* A .provider file was added, changed or removed: only that file is
+ * (re)loaded, and only clients that can use the provider notice */
+static void
+provider_dir_changed (GFileMonitor      *monitor,
+                      GFile             *file,
+                      GFile             *other_file,
+                      GFileMonitorEvent  event,
+                      GcMaster          *master)
+{
+	GcMasterProvider *provider;
+	char *basename;
+	
+	if (event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+	    event != G_FILE_MONITOR_EVENT_DELETED) {
+		return;
+	}
+	
+	basename = g_file_get_basename (file);
+	if (!g_str_has_suffix (basename, PROVIDER_EXTENSION)) {
+		g_free (basename);
+		return;
+	}
+	
+	provider = g_hash_table_lookup (provider_files, basename);
+	if (provider) {
+		g_debug ("master: unloading provider %s", basename);
+		g_hash_table_remove (provider_files, basename);
+		gc_master_remove_provider (master, provider);
+	}
+	
+	if (event == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT) {
+		char *fullname;
+		
+		g_debug ("master: loading provider %s", basename);
+		fullname = g_file_get_path (file);
+		provider = gc_master_add_new_provider (master, fullname);
+		g_free (fullname);
+		
+		if (provider) {
+			GHashTableIter iter;
+			gpointer c;
+			
+			if (geoclue_get_warm_up_providers ()) {
+				gc_master_provider_warm_up (provider, NULL, NULL);
+			}
+			
+			/* only requirements the provider meets are affected */
+			g_hash_table_iter_init (&iter, candidates);
+			while (g_hash_table_iter_next (&iter, NULL, &c)) {
+				gc_candidates_add (c, provider);
+			}
+		}
+	}
+	g_free (basename);
+}
 
+static void
+gc_master_monitor_providers (GcMaster *master)
+{
+	GFile *dir;
+	GError *error = NULL;
+	
+	dir = g_file_new_for_path (GEOCLUE_PROVIDERS_DIR);
+	provider_monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE,
+	                                             NULL, &error);
+	g_object_unref (dir);
+	if (provider_monitor == NULL) {
+		g_warning ("Error monitoring %s: %s\n", GEOCLUE_PROVIDERS_DIR,
+			   error->message);
+		g_error_free (error);
+		return;
+	}
+	g_signal_connect (provider_monitor, "changed",
+	                  G_CALLBACK (provider_dir_changed), master);
+}
+
+/* Scan a directory for .provider files */
 static void
 gc_master_load_providers (GcMaster *master)
 {
@@ -127,6 +308,10 @@ gc_master_load_providers (GcMaster *master)
 	GError *error = NULL;
 	const char *filename;
 
+	provider_files = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                        g_free, NULL);
+	candidates = g_hash_table_new (g_direct_hash, g_direct_equal);
+
 	dir = g_dir_open (GEOCLUE_PROVIDERS_DIR, 0, &error);
 	if (dir == NULL) {
 		g_warning ("Error opening %s: %s\n", GEOCLUE_PROVIDERS_DIR,
@@ -163,6 +348,81 @@ gc_master_load_providers (GcMaster *master)
 	g_dir_close (dir);
 }
 
+static void gc_master_warm_up_next (void);
+
+static void
+gc_master_warm_up_finish (void)
+{
+	if (warm_up->deadline_id) {
+		g_source_remove (warm_up->deadline_id);
+	}
+	g_free (warm_up);
+	warm_up = NULL;
+	g_debug ("master: provider warm-up done");
+}
+
+static void
+warm_up_done (GcMasterProvider *provider,
+              gpointer          user_data)
+{
+	/* providers started before the deadline no longer hold a slot */
+	if (!warm_up || GPOINTER_TO_UINT (user_data) != warm_up->round) {
+		return;
+	}
+	warm_up->pending--;
+	gc_master_warm_up_next ();
+}
+
+static gboolean
+warm_up_deadline (gpointer data)
+{
+	g_debug ("master: provider warm-up deadline reached, %d pending, "
+	         "%d queued",
+	         warm_up->pending, g_list_length (warm_up->queue));
+	warm_up->deadline_id = 0;
+	warm_up->round++;
+	warm_up->pending = 0;
+	gc_master_warm_up_next ();
+	return FALSE;
+}
+
+/* start queued providers until the fan-out limit is reached */
+static void
+gc_master_warm_up_next (void)
+{
+	while (warm_up->queue && warm_up->pending < WARM_UP_MAX_PENDING) {
+		GcMasterProvider *provider = warm_up->queue->data;
+
+		warm_up->queue = g_list_delete_link (warm_up->queue,
+		                                     warm_up->queue);
+		if (gc_master_provider_warm_up (provider, warm_up_done,
+		                                GUINT_TO_POINTER (warm_up->round))) {
+			warm_up->pending++;
+		}
+	}
+
+	if (!warm_up->queue && warm_up->pending == 0) {
+		gc_master_warm_up_finish ();
+	}
+}
+
+/* Fill the caches of network providers in parallel, so that the first
+ * clients do not need to wait for a chain of provider activations */
+static void
+gc_master_warm_up_providers (GcMaster *master)
+{
+	if (!providers) {
+		return;
+	}
+
+	warm_up = g_new0 (GcWarmUp, 1);
+	warm_up->queue = g_list_copy (providers);
+	warm_up->deadline_id = g_timeout_add_seconds (WARM_UP_DEADLINE,
+	                                              warm_up_deadline,
+	                                              NULL);
+	gc_master_warm_up_next ();
+}
+
 static void
 gc_master_init (GcMaster *master)
 {
@@ -178,34 +438,67 @@ gc_master_init (GcMaster *master)
 	
 	master->connectivity = geoclue_connectivity_new ();
 
+	if (master->connection) {
+		/* used to notice clients that leave the bus */
+		master->driver = dbus_g_proxy_new_for_name (master->connection,
+		                                            DBUS_SERVICE_DBUS,
+		                                            DBUS_PATH_DBUS,
+		                                            DBUS_INTERFACE_DBUS);
+		dbus_g_proxy_add_signal (master->driver, "NameOwnerChanged",
+		                         G_TYPE_STRING, G_TYPE_STRING,
+		                         G_TYPE_STRING, G_TYPE_INVALID);
+		dbus_g_proxy_connect_signal (master->driver, "NameOwnerChanged",
+		                             G_CALLBACK (name_owner_changed),
+		                             master, NULL);
+	}
+
 	gc_master_load_providers (master);
+	gc_master_monitor_providers (master);
+	if (geoclue_get_warm_up_providers ()) {
+		gc_master_warm_up_providers (master);
+	}
 }
 
 
-GList *
-gc_master_get_providers (GcInterfaceFlags      iface_type,
-                         GeoclueAccuracyLevel  min_accuracy,
-                         gboolean              can_update,
-                         GeoclueResourceFlags  allowed,
-                         GError              **error)
+static void
+candidates_finalized (gpointer  key,
+                      GObject  *where_the_object_was)
 {
-	GList *l, *p = NULL;
+	g_hash_table_remove (candidates, key);
+}
+
+/* Returns a reference to the sorted list of providers that meet the
+ * requirements. Clients with the same requirements share the list.
+ * Position groups created in fusion mode are not shared with those
+ * created without it, so a change of the setting applies to the
+ * clients that set their requirements after it */
+GcCandidates *
+gc_master_get_candidates (GcInterfaceFlags      iface_type,
+                          GeoclueAccuracyLevel  min_accuracy,
+                          gboolean              can_update,
+                          GeoclueResourceFlags  allowed)
+{
+	GcCandidates *c;
+	gboolean fuse;
+	gpointer key;
 	
-	if (providers == NULL) {
-		return NULL;
-	}
+	fuse = (iface_type == GC_IFACE_POSITION &&
+	        geoclue_get_fuse_positions ());
+	key = GUINT_TO_POINTER (iface_type << 24 |
+	                        (min_accuracy & 0xff) << 16 |
+	                        (can_update ? 1 : 0) << 15 |
+	                        (fuse ? 1 : 0) << 14 |
+	                        (allowed & 0x3fff));
 	
-	for (l = providers; l; l = l->next) {
-		GcMasterProvider *provider = l->data;
-		
-		if (gc_master_provider_is_good (provider,
-		                                iface_type, 
-		                                min_accuracy, 
-		                                can_update, 
-		                                allowed)) {
-			p = g_list_prepend (p, provider);
-		}
+	c = g_hash_table_lookup (candidates, key);
+	if (c) {
+		return g_object_ref (c);
 	}
 	
-	return p;
+	c = gc_candidates_new (iface_type, min_accuracy, can_update, allowed,
+	                       fuse, providers);
+	g_hash_table_insert (candidates, key, c);
+	g_object_weak_ref (G_OBJECT (c), candidates_finalized, key);
+	
+	return c;
 }
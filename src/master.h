@@ -32,6 +32,7 @@
 #include <geoclue/geoclue-accuracy.h>
 #include "connectivity.h"
 #include "master-provider.h"
+#include "candidates.h"
 
 #define GC_TYPE_MASTER (gc_master_get_type ())
 #define GC_MASTER(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GC_TYPE_MASTER, GcMaster))
@@ -41,6 +42,7 @@ typedef struct {
 	
 	GMainLoop *loop;
 	DBusGConnection *connection;
+	DBusGProxy *driver;
 	GeoclueConnectivity *connectivity;
 } GcMaster;
 
@@ -51,11 +53,10 @@ typedef struct {
 } GcMasterClass;
 
 GType gc_master_get_type (void);
-GList *gc_master_get_providers (GcInterfaceFlags      iface_type,
-				GeoclueAccuracyLevel  min_accuracy,
-				gboolean              can_update,
-				GeoclueResourceFlags  allowed,
-				GError              **error);
+GcCandidates *gc_master_get_candidates (GcInterfaceFlags      iface_type,
+					GeoclueAccuracyLevel  min_accuracy,
+					gboolean              can_update,
+					GeoclueResourceFlags  allowed);
 
 #endif
 	
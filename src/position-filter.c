@@ -0,0 +1,260 @@
+/*
+ * Geoclue
+ * position-filter.c - Fusion of position estimates from several providers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * GcPositionFilter combines the positions of several providers into
+ * one estimate with a Kalman filter. The error of a position is taken
+ * to be the same in all horizontal directions, so the filter state is
+ * the position and a single variance in square metres, and a position
+ * of accuracy a (in metres) is weighted by 1/a^2.
+ *
+ * Between positions the device is assumed to move at FILTER_SPEED: the
+ * variance of the estimate grows with the time since the last position,
+ * so a fresh coarse position does replace an old precise one. Altitude
+ * is filtered the same way, separately.
+ **/
+
+#include <config.h>
+
+#include <math.h>
+
+#include "position-filter.h"
+
+/* metres per second */
+#define FILTER_SPEED 10.0
+#define FILTER_CLIMB 2.0
+
+/* metres, for altitudes that come without vertical accuracy */
+#define DEFAULT_VERTICAL_ACCURACY 50.0
+
+/* Horizontal accuracy in metres of each accuracy level, used for
+ * positions that only come with a level */
+static const double level_accuracy[] = {
+	0.0,		/* NONE */
+	300000.0,	/* COUNTRY */
+	50000.0,	/* REGION */
+	5000.0,		/* LOCALITY */
+	1000.0,		/* POSTALCODE */
+	250.0,		/* STREET */
+	50.0		/* DETAILED */
+};
+
+struct _GcPositionFilter {
+	gboolean has_position;
+	int timestamp;
+	double latitude;
+	double longitude;
+	double variance;
+
+	gboolean has_altitude;
+	int altitude_timestamp;
+	double altitude;
+	double altitude_variance;
+};
+
+GcPositionFilter *
+gc_position_filter_new (void)
+{
+	return g_new0 (GcPositionFilter, 1);
+}
+
+void
+gc_position_filter_free (GcPositionFilter *filter)
+{
+	g_free (filter);
+}
+
+static double
+get_horizontal_accuracy (GeoclueAccuracy *accuracy)
+{
+	GeoclueAccuracyLevel level;
+	double horizontal;
+
+	if (accuracy == NULL) {
+		return 0.0;
+	}
+	geoclue_accuracy_get_details (accuracy, &level, &horizontal, NULL);
+	if (horizontal > 0.0) {
+		return horizontal;
+	}
+	if (level <= GEOCLUE_ACCURACY_LEVEL_NONE ||
+	    level > GEOCLUE_ACCURACY_LEVEL_DETAILED) {
+		return 0.0;
+	}
+	return level_accuracy[level];
+}
+
+static GeoclueAccuracyLevel
+get_accuracy_level (double horizontal)
+{
+	GeoclueAccuracyLevel level;
+
+	for (level = GEOCLUE_ACCURACY_LEVEL_DETAILED;
+	     level > GEOCLUE_ACCURACY_LEVEL_COUNTRY;
+	     level--) {
+		if (horizontal <= level_accuracy[level]) {
+			break;
+		}
+	}
+	return level;
+}
+
+/* Grows variance for the movement possible in the time from
+ * *last_timestamp to timestamp, and moves *last_timestamp forward.
+ * Positions older than the estimate are used as if they were current */
+static double
+predict_variance (double  variance,
+                  int    *last_timestamp,
+                  int     timestamp,
+                  double  speed)
+{
+	double dt;
+
+	if (timestamp <= *last_timestamp) {
+		return variance;
+	}
+	dt = timestamp - *last_timestamp;
+	*last_timestamp = timestamp;
+	return variance + (speed * dt) * (speed * dt);
+}
+
+/* Returns TRUE if the position was used */
+gboolean
+gc_position_filter_update (GcPositionFilter      *filter,
+                           GeocluePositionFields  fields,
+                           int                    timestamp,
+                           double                 latitude,
+                           double                 longitude,
+                           double                 altitude,
+                           GeoclueAccuracy       *accuracy)
+{
+	double horizontal, vertical, measured, gain, delta;
+
+	if (!(fields & GEOCLUE_POSITION_FIELDS_LATITUDE &&
+	      fields & GEOCLUE_POSITION_FIELDS_LONGITUDE)) {
+		return FALSE;
+	}
+	horizontal = get_horizontal_accuracy (accuracy);
+	if (horizontal <= 0.0) {
+		return FALSE;
+	}
+	measured = horizontal * horizontal;
+
+	if (!filter->has_position) {
+		filter->has_position = TRUE;
+		filter->timestamp = timestamp;
+		filter->latitude = latitude;
+		filter->longitude = longitude;
+		filter->variance = measured;
+	} else {
+		filter->variance = predict_variance (filter->variance,
+		                                     &filter->timestamp,
+		                                     timestamp,
+		                                     FILTER_SPEED);
+		gain = filter->variance / (filter->variance + measured);
+
+		/* with one variance for both axes the gain is the same
+		 * for both, and can be applied to degrees directly */
+		filter->latitude += gain * (latitude - filter->latitude);
+		delta = longitude - filter->longitude;
+		if (delta > 180.0) {
+			delta -= 360.0;
+		} else if (delta < -180.0) {
+			delta += 360.0;
+		}
+		filter->longitude += gain * delta;
+		if (filter->longitude > 180.0) {
+			filter->longitude -= 360.0;
+		} else if (filter->longitude < -180.0) {
+			filter->longitude += 360.0;
+		}
+		filter->variance = (1.0 - gain) * filter->variance;
+	}
+
+	if (!(fields & GEOCLUE_POSITION_FIELDS_ALTITUDE)) {
+		return TRUE;
+	}
+	geoclue_accuracy_get_details (accuracy, NULL, NULL, &vertical);
+	if (vertical <= 0.0) {
+		vertical = DEFAULT_VERTICAL_ACCURACY;
+	}
+	measured = vertical * vertical;
+
+	if (!filter->has_altitude) {
+		filter->has_altitude = TRUE;
+		filter->altitude_timestamp = timestamp;
+		filter->altitude = altitude;
+		filter->altitude_variance = measured;
+	} else {
+		filter->altitude_variance = predict_variance (filter->altitude_variance,
+		                                              &filter->altitude_timestamp,
+		                                              timestamp,
+		                                              FILTER_CLIMB);
+		gain = filter->altitude_variance / (filter->altitude_variance + measured);
+		filter->altitude += gain * (altitude - filter->altitude);
+		filter->altitude_variance = (1.0 - gain) * filter->altitude_variance;
+	}
+	return TRUE;
+}
+
+/* Returns the current estimate like gc_master_provider_get_position(),
+ * GEOCLUE_POSITION_FIELDS_NONE if no position has been used yet */
+GeocluePositionFields
+gc_position_filter_get_position (GcPositionFilter *filter,
+                                 int              *timestamp,
+                                 double           *latitude,
+                                 double           *longitude,
+                                 double           *altitude,
+                                 GeoclueAccuracy **accuracy)
+{
+	GeocluePositionFields fields = GEOCLUE_POSITION_FIELDS_NONE;
+	double horizontal = 0.0, vertical = 0.0;
+
+	if (filter->has_position) {
+		fields = GEOCLUE_POSITION_FIELDS_LATITUDE |
+		         GEOCLUE_POSITION_FIELDS_LONGITUDE;
+		horizontal = sqrt (filter->variance);
+	}
+	if (filter->has_altitude) {
+		fields |= GEOCLUE_POSITION_FIELDS_ALTITUDE;
+		vertical = sqrt (filter->altitude_variance);
+	}
+
+	if (timestamp != NULL) {
+		*timestamp = filter->timestamp;
+	}
+	if (latitude != NULL) {
+		*latitude = filter->latitude;
+	}
+	if (longitude != NULL) {
+		*longitude = filter->longitude;
+	}
+	if (altitude != NULL) {
+		*altitude = filter->altitude;
+	}
+	if (accuracy != NULL) {
+		*accuracy = geoclue_accuracy_new (filter->has_position ?
+		                                  get_accuracy_level (horizontal) :
+		                                  GEOCLUE_ACCURACY_LEVEL_NONE,
+		                                  horizontal, vertical);
+	}
+	return fields;
+}
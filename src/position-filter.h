@@ -0,0 +1,53 @@
+/*
+ * Geoclue
+ * position-filter.h - Fusion of position estimates from several providers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef _POSITION_FILTER_H_
+#define _POSITION_FILTER_H_
+
+#include <glib.h>
+#include <geoclue/geoclue-types.h>
+#include <geoclue/geoclue-accuracy.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GcPositionFilter GcPositionFilter;
+
+GcPositionFilter *gc_position_filter_new (void);
+void gc_position_filter_free (GcPositionFilter *filter);
+
+gboolean gc_position_filter_update (GcPositionFilter      *filter,
+                                    GeocluePositionFields  fields,
+                                    int                    timestamp,
+                                    double                 latitude,
+                                    double                 longitude,
+                                    double                 altitude,
+                                    GeoclueAccuracy       *accuracy);
+
+GeocluePositionFields gc_position_filter_get_position (GcPositionFilter *filter,
+                                                      int              *timestamp,
+                                                      double           *latitude,
+                                                      double           *longitude,
+                                                      double           *altitude,
+                                                      GeoclueAccuracy **accuracy);
+
+G_END_DECLS
+
+#endif